@@ -0,0 +1,241 @@
+#include "arvore_diretorio.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAU ARVORE_DIRETORIO_GRAU
+#define MAX_CHAVES ARVORE_DIRETORIO_MAX_CHAVES
+
+struct NoArvoreDiretorio {
+    int folha;
+    int quantidade;
+    uint64_t chaves[MAX_CHAVES];
+    NoArvoreDiretorio *filhos[MAX_CHAVES + 1];
+};
+
+static NoArvoreDiretorio *novo_no(int folha) {
+    NoArvoreDiretorio *no = calloc(1, sizeof(NoArvoreDiretorio));
+    if (no) {
+        no->folha = folha;
+    }
+    return no;
+}
+
+static void liberar_no(NoArvoreDiretorio *no) {
+    if (!no) {
+        return;
+    }
+    if (!no->folha) {
+        for (int i = 0; i <= no->quantidade; i++) {
+            liberar_no(no->filhos[i]);
+        }
+    }
+    free(no);
+}
+
+void arvore_diretorio_destruir(ArvoreDiretorio *arvore) {
+    liberar_no(arvore->raiz);
+    memset(arvore, 0, sizeof(ArvoreDiretorio));
+}
+
+static int posicao(const NoArvoreDiretorio *no, uint64_t chave) {
+    int inicio = 0, fim = no->quantidade;
+    while (inicio < fim) {
+        int meio = (inicio + fim) / 2;
+        if (no->chaves[meio] < chave) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+    return inicio;
+}
+
+static int dividir_filho(NoArvoreDiretorio *pai, int i) {
+    NoArvoreDiretorio *cheio = pai->filhos[i];
+    NoArvoreDiretorio *novo = novo_no(cheio->folha);
+    if (!novo) {
+        return -ENOMEM;
+    }
+    novo->quantidade = GRAU - 1;
+    memcpy(novo->chaves, cheio->chaves + GRAU, (GRAU - 1) * sizeof(uint64_t));
+    if (!cheio->folha) {
+        memcpy(novo->filhos, cheio->filhos + GRAU, GRAU * sizeof(NoArvoreDiretorio *));
+    }
+    cheio->quantidade = GRAU - 1;
+    memmove(pai->filhos + i + 2, pai->filhos + i + 1, (pai->quantidade - i) * sizeof(NoArvoreDiretorio *));
+    pai->filhos[i + 1] = novo;
+    memmove(pai->chaves + i + 1, pai->chaves + i, (pai->quantidade - i) * sizeof(uint64_t));
+    pai->chaves[i] = cheio->chaves[GRAU - 1];
+    pai->quantidade++;
+    return 0;
+}
+
+int arvore_diretorio_inserir(ArvoreDiretorio *arvore, uint64_t chave) {
+    if (!arvore->raiz) {
+        arvore->raiz = novo_no(1);
+        if (!arvore->raiz) {
+            return -ENOMEM;
+        }
+    }
+    if (arvore->raiz->quantidade == MAX_CHAVES) {
+        NoArvoreDiretorio *raiz = novo_no(0);
+        if (!raiz) {
+            return -ENOMEM;
+        }
+        raiz->filhos[0] = arvore->raiz;
+        if (dividir_filho(raiz, 0) < 0) {
+            free(raiz);
+            return -ENOMEM;
+        }
+        arvore->raiz = raiz;
+    }
+    NoArvoreDiretorio *no = arvore->raiz;
+    while (!no->folha) {
+        int i = posicao(no, chave);
+        if (no->filhos[i]->quantidade == MAX_CHAVES) {
+            if (dividir_filho(no, i) < 0) {
+                return -ENOMEM;
+            }
+            if (chave > no->chaves[i]) {
+                i++;
+            }
+        }
+        no = no->filhos[i];
+    }
+    int i = posicao(no, chave);
+    memmove(no->chaves + i + 1, no->chaves + i, (no->quantidade - i) * sizeof(uint64_t));
+    no->chaves[i] = chave;
+    no->quantidade++;
+    arvore->quantidade++;
+    return 0;
+}
+
+static void emprestar_esquerda(NoArvoreDiretorio *no, int i) {
+    NoArvoreDiretorio *filho = no->filhos[i];
+    NoArvoreDiretorio *irmao = no->filhos[i - 1];
+    memmove(filho->chaves + 1, filho->chaves, filho->quantidade * sizeof(uint64_t));
+    if (!filho->folha) {
+        memmove(filho->filhos + 1, filho->filhos, (filho->quantidade + 1) * sizeof(NoArvoreDiretorio *));
+        filho->filhos[0] = irmao->filhos[irmao->quantidade];
+    }
+    filho->chaves[0] = no->chaves[i - 1];
+    no->chaves[i - 1] = irmao->chaves[irmao->quantidade - 1];
+    irmao->quantidade--;
+    filho->quantidade++;
+}
+
+static void emprestar_direita(NoArvoreDiretorio *no, int i) {
+    NoArvoreDiretorio *filho = no->filhos[i];
+    NoArvoreDiretorio *irmao = no->filhos[i + 1];
+    filho->chaves[filho->quantidade] = no->chaves[i];
+    if (!filho->folha) {
+        filho->filhos[filho->quantidade + 1] = irmao->filhos[0];
+        memmove(irmao->filhos, irmao->filhos + 1, irmao->quantidade * sizeof(NoArvoreDiretorio *));
+    }
+    no->chaves[i] = irmao->chaves[0];
+    memmove(irmao->chaves, irmao->chaves + 1, (irmao->quantidade - 1) * sizeof(uint64_t));
+    irmao->quantidade--;
+    filho->quantidade++;
+}
+
+static void fundir(NoArvoreDiretorio *no, int i) {
+    NoArvoreDiretorio *esquerda = no->filhos[i];
+    NoArvoreDiretorio *direita = no->filhos[i + 1];
+    esquerda->chaves[esquerda->quantidade] = no->chaves[i];
+    memcpy(esquerda->chaves + esquerda->quantidade + 1, direita->chaves, direita->quantidade * sizeof(uint64_t));
+    if (!esquerda->folha) {
+        memcpy(esquerda->filhos + esquerda->quantidade + 1, direita->filhos,
+               (direita->quantidade + 1) * sizeof(NoArvoreDiretorio *));
+    }
+    esquerda->quantidade += direita->quantidade + 1;
+    memmove(no->chaves + i, no->chaves + i + 1, (no->quantidade - i - 1) * sizeof(uint64_t));
+    memmove(no->filhos + i + 1, no->filhos + i + 2, (no->quantidade - i - 1) * sizeof(NoArvoreDiretorio *));
+    no->quantidade--;
+    free(direita);
+}
+
+static int remover_de_no(NoArvoreDiretorio *no, uint64_t chave) {
+    for (;;) {
+        int i = posicao(no, chave);
+        if (i < no->quantidade && no->chaves[i] == chave) {
+            if (no->folha) {
+                memmove(no->chaves + i, no->chaves + i + 1, (no->quantidade - i - 1) * sizeof(uint64_t));
+                no->quantidade--;
+                return 0;
+            }
+            NoArvoreDiretorio *esquerda = no->filhos[i];
+            NoArvoreDiretorio *direita = no->filhos[i + 1];
+            if (esquerda->quantidade >= GRAU) {
+                NoArvoreDiretorio *atual = esquerda;
+                while (!atual->folha) {
+                    atual = atual->filhos[atual->quantidade];
+                }
+                chave = atual->chaves[atual->quantidade - 1];
+                no->chaves[i] = chave;
+                no = esquerda;
+            } else if (direita->quantidade >= GRAU) {
+                NoArvoreDiretorio *atual = direita;
+                while (!atual->folha) {
+                    atual = atual->filhos[0];
+                }
+                chave = atual->chaves[0];
+                no->chaves[i] = chave;
+                no = direita;
+            } else {
+                fundir(no, i);
+                no = esquerda;
+            }
+            continue;
+        }
+        if (no->folha) {
+            return -ENOENT;
+        }
+        if (no->filhos[i]->quantidade < GRAU) {
+            if (i > 0 && no->filhos[i - 1]->quantidade >= GRAU) {
+                emprestar_esquerda(no, i);
+            } else if (i < no->quantidade && no->filhos[i + 1]->quantidade >= GRAU) {
+                emprestar_direita(no, i);
+            } else if (i < no->quantidade) {
+                fundir(no, i);
+            } else {
+                fundir(no, i - 1);
+                i--;
+            }
+        }
+        no = no->filhos[i];
+    }
+}
+
+int arvore_diretorio_remover(ArvoreDiretorio *arvore, uint64_t chave) {
+    if (!arvore->raiz) {
+        return -ENOENT;
+    }
+    int resultado = remover_de_no(arvore->raiz, chave);
+    if (arvore->raiz->quantidade == 0) {
+        NoArvoreDiretorio *antiga = arvore->raiz;
+        arvore->raiz = antiga->folha ? NULL : antiga->filhos[0];
+        free(antiga);
+    }
+    if (resultado == 0) {
+        arvore->quantidade--;
+    }
+    return resultado;
+}
+
+int arvore_diretorio_proxima(const ArvoreDiretorio *arvore, uint64_t minimo, uint64_t *chave) {
+    const NoArvoreDiretorio *no = arvore->raiz;
+    int encontrada = 0;
+    while (no) {
+        int i = posicao(no, minimo);
+        if (i < no->quantidade) {
+            *chave = no->chaves[i];
+            encontrada = 1;
+            if (no->chaves[i] == minimo) {
+                break;
+            }
+        }
+        no = no->folha ? NULL : no->filhos[i];
+    }
+    return encontrada ? 0 : -ENOENT;
+}
@@ -0,0 +1,23 @@
+#ifndef ARVORE_DIRETORIO_H
+#define ARVORE_DIRETORIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARVORE_DIRETORIO_GRAU 16
+#define ARVORE_DIRETORIO_MAX_CHAVES (2 * ARVORE_DIRETORIO_GRAU - 1)
+
+typedef struct NoArvoreDiretorio NoArvoreDiretorio;
+
+typedef struct {
+    NoArvoreDiretorio *raiz;
+    size_t quantidade;
+    uint32_t subdiretorios;
+} ArvoreDiretorio;
+
+void arvore_diretorio_destruir(ArvoreDiretorio *arvore);
+int arvore_diretorio_inserir(ArvoreDiretorio *arvore, uint64_t chave);
+int arvore_diretorio_remover(ArvoreDiretorio *arvore, uint64_t chave);
+int arvore_diretorio_proxima(const ArvoreDiretorio *arvore, uint64_t minimo, uint64_t *chave);
+
+#endif
@@ -0,0 +1,294 @@
+#include "libbmpfs.h"
+#include "estatisticas.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_LADOS_PADRAO "2048,4096"
+#define BENCH_BLOCOS_PADRAO "1024,4096,16384"
+#define BENCH_MAXIMO_VALORES 8
+#define BENCH_TAMANHO_SEQUENCIAL (64u * 1024)
+#define BENCH_TAMANHO_ALEATORIO 4096u
+#define BENCH_OPERACOES_ALEATORIAS 16384
+#define BENCH_TAMANHO_ANEXO (16u * 1024)
+#define BENCH_ARQUIVOS_ANEXO 8
+#define BENCH_ARQUIVOS_PEQUENOS 2000
+#define BENCH_CICLOS_METADADOS 4000
+
+typedef struct {
+    SerieLatencia serie;
+    uint64_t bytes;
+    uint64_t inicio;
+} Medicao;
+
+static uint64_t semente = 0x9e3779b97f4a7c15ULL;
+static int falhas;
+
+static uint64_t aleatorio(void) {
+    semente ^= semente << 13;
+    semente ^= semente >> 7;
+    semente ^= semente << 17;
+    return semente;
+}
+
+static void preencher(uint8_t *buffer, size_t tamanho) {
+    for (size_t i = 0; i < tamanho; i++) {
+        buffer[i] = (uint8_t)(aleatorio() >> 56);
+    }
+}
+
+static void iniciar(Medicao *medicao) {
+    memset(medicao, 0, sizeof(Medicao));
+    medicao->inicio = estatisticas_relogio();
+}
+
+static void registrar(Medicao *medicao, uint64_t inicio, int64_t resultado, int64_t esperado) {
+    estatisticas_registrar(&medicao->serie, estatisticas_relogio() - inicio, resultado != esperado);
+    if (resultado != esperado) {
+        falhas++;
+    } else if (resultado > 0) {
+        medicao->bytes += (uint64_t)resultado;
+    }
+}
+
+static void verificar(const char *operacao, int resultado) {
+    if (resultado < 0) {
+        fprintf(stderr, "%s falhou: %s\n", operacao, strerror(-resultado));
+        falhas++;
+    }
+}
+
+static void relatar(const char *carga, const Medicao *medicao) {
+    double segundos = (double)(estatisticas_relogio() - medicao->inicio) / 1e9;
+    const SerieLatencia *serie = &medicao->serie;
+    printf("  %-18s %8llu %10.1f %11.0f %9.1f %9.1f %9.1f %9.1f\n", carga, (unsigned long long)serie->chamadas,
+           medicao->bytes ? (double)medicao->bytes / (1024.0 * 1024.0) / segundos : 0.0,
+           (double)serie->chamadas / segundos, estatisticas_percentil(serie, 0.5) / 1e3,
+           estatisticas_percentil(serie, 0.99) / 1e3, estatisticas_percentil(serie, 0.999) / 1e3,
+           serie->ns_maximo / 1e3);
+}
+
+static void sequencial(const uint8_t *dados, uint8_t *lidos, size_t tamanho) {
+    Medicao medicao;
+    verificar("criar /seq", bmpfs_criar("/seq", 0644));
+    iniciar(&medicao);
+    for (size_t offset = 0; offset < tamanho; offset += BENCH_TAMANHO_SEQUENCIAL) {
+        uint64_t inicio = estatisticas_relogio();
+        registrar(&medicao, inicio, bmpfs_escrever("/seq", dados + offset, BENCH_TAMANHO_SEQUENCIAL, offset),
+                  BENCH_TAMANHO_SEQUENCIAL);
+    }
+    verificar("sincronizar /seq", bmpfs_sincronizar("/seq"));
+    relatar("escrita_sequencial", &medicao);
+    iniciar(&medicao);
+    for (size_t offset = 0; offset < tamanho; offset += BENCH_TAMANHO_SEQUENCIAL) {
+        uint64_t inicio = estatisticas_relogio();
+        registrar(&medicao, inicio, bmpfs_ler("/seq", lidos + offset, BENCH_TAMANHO_SEQUENCIAL, offset),
+                  BENCH_TAMANHO_SEQUENCIAL);
+    }
+    relatar("leitura_sequencial", &medicao);
+    if (memcmp(dados, lidos, tamanho) != 0) {
+        fprintf(stderr, "Conteúdo lido de /seq difere do escrito\n");
+        falhas++;
+    }
+}
+
+static void aleatorio_es(const uint8_t *dados, uint8_t *lidos, size_t tamanho) {
+    Medicao medicao;
+    size_t posicoes = tamanho / BENCH_TAMANHO_ALEATORIO;
+    iniciar(&medicao);
+    for (int i = 0; i < BENCH_OPERACOES_ALEATORIAS; i++) {
+        off_t offset = (off_t)(aleatorio() % posicoes) * BENCH_TAMANHO_ALEATORIO;
+        uint64_t inicio = estatisticas_relogio();
+        registrar(&medicao, inicio, bmpfs_ler("/seq", lidos, BENCH_TAMANHO_ALEATORIO, offset),
+                  BENCH_TAMANHO_ALEATORIO);
+    }
+    relatar("leitura_aleatoria", &medicao);
+    iniciar(&medicao);
+    for (int i = 0; i < BENCH_OPERACOES_ALEATORIAS; i++) {
+        off_t offset = (off_t)(aleatorio() % posicoes) * BENCH_TAMANHO_ALEATORIO;
+        uint64_t inicio = estatisticas_relogio();
+        registrar(&medicao, inicio, bmpfs_escrever("/seq", dados + offset, BENCH_TAMANHO_ALEATORIO, offset),
+                  BENCH_TAMANHO_ALEATORIO);
+    }
+    verificar("sincronizar /seq", bmpfs_sincronizar("/seq"));
+    relatar("escrita_aleatoria", &medicao);
+    verificar("excluir /seq", bmpfs_excluir("/seq"));
+}
+
+static void anexos(const uint8_t *dados, size_t tamanho) {
+    Medicao medicao;
+    char caminho[64];
+    for (int arquivo = 0; arquivo < BENCH_ARQUIVOS_ANEXO; arquivo++) {
+        snprintf(caminho, sizeof(caminho), "/anexo%d", arquivo);
+        verificar("criar anexo", bmpfs_criar(caminho, 0644));
+    }
+    size_t por_arquivo = tamanho / BENCH_ARQUIVOS_ANEXO / BENCH_TAMANHO_ANEXO * BENCH_TAMANHO_ANEXO;
+    iniciar(&medicao);
+    for (size_t offset = 0; offset < por_arquivo; offset += BENCH_TAMANHO_ANEXO) {
+        for (int arquivo = 0; arquivo < BENCH_ARQUIVOS_ANEXO; arquivo++) {
+            snprintf(caminho, sizeof(caminho), "/anexo%d", arquivo);
+            uint64_t inicio = estatisticas_relogio();
+            registrar(&medicao, inicio, bmpfs_escrever(caminho, dados + offset, BENCH_TAMANHO_ANEXO, offset),
+                      BENCH_TAMANHO_ANEXO);
+        }
+    }
+    verificar("sincronizar", bmpfs_sincronizar(NULL));
+    relatar("anexo_intercalado", &medicao);
+    for (int arquivo = 0; arquivo < BENCH_ARQUIVOS_ANEXO; arquivo++) {
+        snprintf(caminho, sizeof(caminho), "/anexo%d", arquivo);
+        verificar("excluir anexo", bmpfs_excluir(caminho));
+    }
+}
+
+static void arquivos_pequenos(const uint8_t *dados, size_t blocos) {
+    Medicao medicao;
+    char caminho[64];
+    int quantidade = blocos / 4 < BENCH_ARQUIVOS_PEQUENOS ? (int)(blocos / 4) : BENCH_ARQUIVOS_PEQUENOS;
+    verificar("criar /pequenos", bmpfs_criar_diretorio("/pequenos", 0755));
+    iniciar(&medicao);
+    for (int i = 0; i < quantidade; i++) {
+        snprintf(caminho, sizeof(caminho), "/pequenos/p%d", i);
+        size_t tamanho = 64 + aleatorio() % 4032;
+        uint64_t inicio = estatisticas_relogio();
+        int resultado = bmpfs_criar(caminho, 0644);
+        registrar(&medicao, inicio, resultado < 0 ? resultado : bmpfs_escrever(caminho, dados, tamanho, 0),
+                  (int64_t)tamanho);
+    }
+    verificar("sincronizar", bmpfs_sincronizar(NULL));
+    relatar("criacao_pequenos", &medicao);
+    iniciar(&medicao);
+    for (int i = 0; i < quantidade; i++) {
+        snprintf(caminho, sizeof(caminho), "/pequenos/p%d", i);
+        uint64_t inicio = estatisticas_relogio();
+        registrar(&medicao, inicio, bmpfs_excluir(caminho), 0);
+    }
+    verificar("remover /pequenos", bmpfs_remover_diretorio("/pequenos"));
+    relatar("exclusao_pequenos", &medicao);
+}
+
+static void metadados(const uint8_t *dados) {
+    Medicao medicao;
+    char origem[64], destino[64];
+    struct stat st;
+    verificar("criar /meta", bmpfs_criar_diretorio("/meta", 0755));
+    iniciar(&medicao);
+    for (int i = 0; i < BENCH_CICLOS_METADADOS; i++) {
+        snprintf(origem, sizeof(origem), "/meta/a%d", i % 64);
+        snprintf(destino, sizeof(destino), "/meta/b%d", i % 64);
+        uint64_t inicio = estatisticas_relogio();
+        int resultado = bmpfs_criar(origem, 0644);
+        if (resultado == 0 && bmpfs_escrever(origem, dados, 1000, 0) != 1000) {
+            resultado = -EIO;
+        }
+        if (resultado == 0) {
+            resultado = bmpfs_consultar(origem, &st);
+        }
+        if (resultado == 0) {
+            resultado = bmpfs_renomear(origem, destino);
+        }
+        if (resultado == 0) {
+            resultado = bmpfs_truncar(destino, 100);
+        }
+        if (resultado == 0) {
+            resultado = bmpfs_excluir(destino);
+        }
+        registrar(&medicao, inicio, resultado, 0);
+    }
+    verificar("remover /meta", bmpfs_remover_diretorio("/meta"));
+    relatar("ciclo_metadados", &medicao);
+}
+
+static int ler_lista(const char *texto, unsigned long *valores) {
+    int quantidade = 0;
+    while (*texto && quantidade < BENCH_MAXIMO_VALORES) {
+        char *fim;
+        valores[quantidade] = strtoul(texto, &fim, 10);
+        if (fim == texto || valores[quantidade] == 0 || (*fim != ',' && *fim != '\0')) {
+            return -EINVAL;
+        }
+        quantidade++;
+        texto = *fim ? fim + 1 : fim;
+    }
+    return quantidade ? quantidade : -EINVAL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *diretorio = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    const char *lados_texto = BENCH_LADOS_PADRAO, *blocos_texto = BENCH_BLOCOS_PADRAO;
+    OpcoesMontagemBmpfs montagem;
+    bmpfs_opcoes_montagem_padrao(&montagem);
+    uint32_t bits_lsb = 0;
+    int opcao;
+    while ((opcao = getopt(argc, argv, "d:l:b:s:mc:")) != -1) {
+        switch (opcao) {
+            case 'd': diretorio = optarg; break;
+            case 'l': lados_texto = optarg; break;
+            case 'b': blocos_texto = optarg; break;
+            case 's': bits_lsb = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'm': montagem.usar_mmap = 1; break;
+            case 'c': montagem.cache_mb = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Uso: %s [-d diretório] [-l lados,...] [-b blocos,...] [-s bits_lsb] [-m] [-c cache_mb]\n", argv[0]);
+                return 1;
+        }
+    }
+    unsigned long lados[BENCH_MAXIMO_VALORES], blocos[BENCH_MAXIMO_VALORES];
+    int num_lados = ler_lista(lados_texto, lados);
+    int num_blocos = ler_lista(blocos_texto, blocos);
+    if (num_lados < 0 || num_blocos < 0) {
+        fprintf(stderr, "Listas de lados e blocos devem ser números positivos separados por vírgula\n");
+        return 1;
+    }
+    char imagem[4096];
+    snprintf(imagem, sizeof(imagem), "%s/bench_bmpfs_%d.bmp", diretorio, (int)getpid());
+    for (int l = 0; l < num_lados; l++) {
+        size_t capacidade = (size_t)lados[l] * lados[l] * 3 / (bits_lsb ? 8 / bits_lsb : 1);
+        size_t tamanho = capacidade / 4 / BENCH_TAMANHO_SEQUENCIAL * BENCH_TAMANHO_SEQUENCIAL;
+        uint8_t *dados = malloc(tamanho + BENCH_TAMANHO_SEQUENCIAL);
+        uint8_t *lidos = malloc(tamanho + BENCH_TAMANHO_SEQUENCIAL);
+        if (!dados || !lidos || tamanho == 0) {
+            fprintf(stderr, "Imagem de lado %lu pequena demais ou sem memória para os buffers\n", lados[l]);
+            free(dados);
+            free(lidos);
+            return 1;
+        }
+        preencher(dados, tamanho + BENCH_TAMANHO_SEQUENCIAL);
+        for (int b = 0; b < num_blocos; b++) {
+            OpcoesFormatacaoBmpfs formatacao;
+            bmpfs_opcoes_formatacao_padrao(&formatacao);
+            formatacao.tamanho_bloco = (uint32_t)blocos[b];
+            formatacao.bits_lsb = bits_lsb;
+            int resultado = bmpfs_formatar(imagem, lados[l], lados[l], &formatacao);
+            if (resultado == 0) {
+                resultado = bmpfs_abrir(imagem, &montagem);
+            }
+            if (resultado < 0) {
+                fprintf(stderr, "Falha ao preparar imagem %lux%lu com blocos de %lu: %s\n", lados[l], lados[l],
+                        blocos[b], strerror(-resultado));
+                unlink(imagem);
+                falhas++;
+                continue;
+            }
+            printf("Imagem %lux%lu (%zu MB), blocos de %lu bytes%s%s\n", lados[l], lados[l], capacidade >> 20,
+                   blocos[b], bits_lsb ? ", LSB" : "", montagem.usar_mmap ? ", mmap" : "");
+            printf("  %-18s %8s %10s %11s %9s %9s %9s %9s\n", "carga", "ops", "MB/s", "ops/s", "p50 µs", "p99 µs",
+                   "p99.9 µs", "máx µs");
+            sequencial(dados, lidos, tamanho);
+            aleatorio_es(dados, lidos, tamanho);
+            anexos(dados, tamanho);
+            arquivos_pequenos(dados, capacidade / blocos[b]);
+            metadados(dados);
+            verificar("fechar", bmpfs_fechar());
+            unlink(imagem);
+        }
+        free(dados);
+        free(lidos);
+    }
+    if (falhas) {
+        fprintf(stderr, "%d operações falharam\n", falhas);
+        return 1;
+    }
+    return 0;
+}
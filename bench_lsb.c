@@ -0,0 +1,84 @@
+#include "lsb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_TAMANHO_PADRAO (16u * 1024 * 1024)
+#define BENCH_REPETICOES 8
+
+static double agora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void preencher(uint8_t *buffer, size_t tamanho, uint64_t semente) {
+    for (size_t i = 0; i < tamanho; i++) {
+        semente = semente * 6364136223846793005ULL + 1442695040888963407ULL;
+        buffer[i] = (uint8_t)(semente >> 56);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t tamanho = argc > 1 ? strtoull(argv[1], NULL, 10) * 1024 * 1024 : BENCH_TAMANHO_PADRAO;
+    if (tamanho == 0) {
+        fprintf(stderr, "Uso: %s [MB de payload]\n", argv[0]);
+        return 1;
+    }
+    uint8_t *dados = malloc(tamanho);
+    uint8_t *lidos = malloc(tamanho);
+    uint8_t *original = malloc(lsb_tamanho_portadora(tamanho, 1));
+    uint8_t *referencia = malloc(lsb_tamanho_portadora(tamanho, 1));
+    uint8_t *portadora = malloc(lsb_tamanho_portadora(tamanho, 1));
+    if (!dados || !lidos || !original || !referencia || !portadora) {
+        fprintf(stderr, "Falha ao alocar buffers de %zu bytes\n", tamanho);
+        return 1;
+    }
+    preencher(dados, tamanho, 1);
+    preencher(original, lsb_tamanho_portadora(tamanho, 1), 2);
+    const KernelLSB *escalar = &kernels_lsb[num_kernels_lsb - 1];
+    printf("Payload de %zu MB, kernel padrão: %s\n", tamanho / (1024 * 1024), lsb_melhor_kernel()->nome);
+    printf("%-8s %4s %14s %14s\n", "kernel", "bits", "embutir GB/s", "extrair GB/s");
+    int falhas = 0;
+    for (unsigned int bits = 1; bits <= 4; bits *= 2) {
+        size_t tamanho_portadora = lsb_tamanho_portadora(tamanho, bits);
+        memcpy(referencia, original, tamanho_portadora);
+        escalar->embutir(referencia, dados, tamanho, bits);
+        for (size_t k = 0; k < num_kernels_lsb; k++) {
+            const KernelLSB *kernel = &kernels_lsb[k];
+            if (!kernel->suportado()) {
+                printf("%-8s %4u %14s %14s\n", kernel->nome, bits, "-", "-");
+                continue;
+            }
+            double melhor_embutir = 1e30, melhor_extrair = 1e30;
+            for (int r = 0; r < BENCH_REPETICOES; r++) {
+                memcpy(portadora, original, tamanho_portadora);
+                double inicio = agora();
+                kernel->embutir(portadora, dados, tamanho, bits);
+                double meio = agora();
+                kernel->extrair(lidos, portadora, tamanho, bits);
+                double fim = agora();
+                if (meio - inicio < melhor_embutir) {
+                    melhor_embutir = meio - inicio;
+                }
+                if (fim - meio < melhor_extrair) {
+                    melhor_extrair = fim - meio;
+                }
+            }
+            if (memcmp(portadora, referencia, tamanho_portadora) != 0 || memcmp(lidos, dados, tamanho) != 0) {
+                printf("%-8s %4u: resultado difere do kernel escalar\n", kernel->nome, bits);
+                falhas++;
+                continue;
+            }
+            printf("%-8s %4u %14.2f %14.2f\n", kernel->nome, bits, tamanho / melhor_embutir / 1e9,
+                   tamanho / melhor_extrair / 1e9);
+        }
+    }
+    free(dados);
+    free(lidos);
+    free(original);
+    free(referencia);
+    free(portadora);
+    return falhas ? 1 : 0;
+}
@@ -4,60 +4,57 @@
 #include <string.h>
 #include <errno.h>
 #include <stdint.h>
+#include <unistd.h>
 
-int criar_arquivo_bmp(const char *nome, size_t larg, size_t alt) {
-    FILE *f = fopen(nome, "wb");
-    if (!f) return -errno;
+size_t calcular_tamanho_pixels(const InfoCabecalhoBMP *info) {
+    size_t larg = info->largura < 0 ? -(int64_t)info->largura : info->largura;
+    size_t alt = info->altura < 0 ? -(int64_t)info->altura : info->altura;
+    size_t tam_linha = ((larg * info->bits_por_pixel + 31) / 32) * 4;
+    return tam_linha * alt;
+}
 
-    size_t tam_linha = (larg * 3 + 3) & ~3;
-    size_t tam_pixels = tam_linha * alt;
-    size_t tam_arquivo = sizeof(CabeçalhoBMP) + sizeof(InfoCabecalhoBMP) + tam_pixels;
+int criar_arquivo_bmp(const char *nome, size_t larg, size_t alt, uint16_t bpp) {
+    if (bpp != 16 && bpp != 24 && bpp != 32) return -EINVAL;
+    if (larg == 0 || alt == 0 || larg > INT32_MAX || alt > INT32_MAX) return -EINVAL;
 
-    CabeçalhoBMP cab = {
-        .assinatura = 0x4D42,
-        .tamanho_arquivo = tam_arquivo,
-        .reservado1 = 0,
-        .reservado2 = 0,
-        .deslocamento_dados = sizeof(CabeçalhoBMP) + sizeof(InfoCabecalhoBMP)
-    };
+    FILE *f = fopen(nome, "wb");
+    if (!f) return -errno;
 
     InfoCabecalhoBMP info = {
         .tamanho_cabecalho = sizeof(InfoCabecalhoBMP),
         .largura = larg,
         .altura = alt,
         .planos = 1,
-        .bits_por_pixel = 24,
+        .bits_por_pixel = bpp,
         .compressao = 0,
-        .tamanho_imagem = tam_pixels,
+        .tamanho_imagem = 0,
         .pixels_por_m_x = 2835,
         .pixels_por_m_y = 2835,
         .cores_usadas = 0,
         .cores_importantes = 0
     };
 
-    if (fwrite(&cab, sizeof(CabeçalhoBMP), 1, f) != 1 ||
-        fwrite(&info, sizeof(InfoCabecalhoBMP), 1, f) != 1) {
-        fclose(f);
-        return -EIO;
-    }
-
-    unsigned char *pixels = calloc(1, tam_pixels);
-    if (!pixels) {
-        fclose(f);
-        return -ENOMEM;
-    }
+    size_t tam_pixels = calcular_tamanho_pixels(&info);
+    size_t tam_arquivo = sizeof(CabeçalhoBMP) + sizeof(InfoCabecalhoBMP) + tam_pixels;
+    if (tam_pixels <= UINT32_MAX) info.tamanho_imagem = tam_pixels;
 
-    size_t escrito = fwrite(pixels, 1, tam_pixels, f);
-    free(pixels);
+    CabeçalhoBMP cab = {
+        .assinatura = 0x4D42,
+        .tamanho_arquivo = tam_arquivo <= UINT32_MAX ? tam_arquivo : 0,
+        .reservado1 = 0,
+        .reservado2 = 0,
+        .deslocamento_dados = sizeof(CabeçalhoBMP) + sizeof(InfoCabecalhoBMP)
+    };
 
-    if (escrito != tam_pixels) {
+    if (escrever_cabecalho_bmp(f, &cab, &info) < 0 || fflush(f) != 0) {
         fclose(f);
         return -EIO;
     }
 
-    if (fflush(f) != 0) {
+    if (ftruncate(fileno(f), tam_arquivo) != 0) {
+        int erro = errno;
         fclose(f);
-        return -EIO;
+        return -erro;
     }
 
     fclose(f);
@@ -31,7 +31,8 @@ typedef struct {
 } InfoCabecalhoBMP;
 #pragma pack(pop)
 
-int criar_arquivo_bmp(const char *nome, size_t larg, size_t alt);
+size_t calcular_tamanho_pixels(const InfoCabecalhoBMP *info);
+int criar_arquivo_bmp(const char *nome, size_t larg, size_t alt, uint16_t bpp);
 int ler_cabecalho_bmp(FILE *f, CabeçalhoBMP *cab, InfoCabecalhoBMP *info);
 int escrever_cabecalho_bmp(FILE *f, const CabeçalhoBMP *cab, const InfoCabecalhoBMP *info);
 
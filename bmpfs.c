@@ -1,788 +1,4576 @@
 #include "bmpfs.h"
 #include "bmp.h"
+#include "espaco_livre.h"
+#include "indice_nomes.h"
 #include <errno.h>
 #include <fcntl.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <time.h>
 #include <limits.h>
+#include <pthread.h>
 
-static void registrar_debug(const char *formato, ...) {
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+#ifndef SEEK_DATA
+#define SEEK_DATA 3
+#define SEEK_HOLE 4
+#endif
+
+#ifndef FALLOC_FL_KEEP_SIZE
+#define FALLOC_FL_KEEP_SIZE 0x01
+#define FALLOC_FL_PUNCH_HOLE 0x02
+#endif
+
+static void emitir_log(int nivel, const char *formato, ...) {
+    static const char *nomes[] = {"erro", "aviso", "info", "debug"};
     va_list args;
     va_start(args, formato);
+    flockfile(stderr);
+    fprintf(stderr, "bmpfs[%s]: ", nomes[nivel]);
     vfprintf(stderr, formato, args);
+    funlockfile(stderr);
     va_end(args);
 }
 
+#define registrar_log(nivel, ...) \
+    do { \
+        if ((nivel) <= BMPFS_NIVEL_LOG_MAXIMO && (nivel) <= (int)config_bmpfs.nivel_log) { \
+            emitir_log((nivel), __VA_ARGS__); \
+        } \
+    } while (0)
+#define registrar_erro(...) registrar_log(BMPFS_LOG_ERRO, __VA_ARGS__)
+#define registrar_aviso(...) registrar_log(BMPFS_LOG_AVISO, __VA_ARGS__)
+#define registrar_info(...) registrar_log(BMPFS_LOG_INFO, __VA_ARGS__)
+#define registrar_debug(...) registrar_log(BMPFS_LOG_DEBUG, __VA_ARGS__)
+
 struct config_bmpfs config_bmpfs;
 estado_bmpfs estado_sistema_bmpfs;
 
 struct fuse_opt opcoes_bmpfs[] = {
     BMPFS_OPT("imagem=%s", configuracao_caminho_imagem),
+    BMPFS_OPT("atraso_metadados=%u", atraso_metadados_ms),
+    BMPFS_OPT("cache_mb=%u", cache_mb),
+    BMPFS_OPT("profundidade_io=%u", profundidade_io),
+    BMPFS_OPT("mmap", usar_mmap),
+    BMPFS_OPT("desfragmentar=%u", desfragmentacao_mb_s),
+    BMPFS_OPT("ocioso_desfragmentacao=%u", ocioso_desfragmentacao_s),
+    BMPFS_OPT("log=%u", nivel_log),
+    BMPFS_OPT("baixo_nivel", baixo_nivel),
     FUSE_OPT_END
 };
 
-static size_t calcular_tamanho_metadados(estado_bmpfs *estado) {
-    size_t total_blocos = estado->tamanho_dados / estado->tamanho_bloco;
-    size_t tamanho_bitmap = total_blocos;
-    size_t tamanho_metadados_arquivo = estado->max_arquivos * sizeof(MetadadosArquivo);
-    return tamanho_bitmap + tamanho_metadados_arquivo;
+static pthread_key_t chave_buffers_thread;
+static pthread_once_t buffers_thread_iniciados = PTHREAD_ONCE_INIT;
+
+static void liberar_buffers_thread(void *dados) {
+    BuffersThread *buffers = dados;
+    for (int i = 0; i < BMPFS_NUM_BUFFERS_THREAD; i++) {
+        free(buffers->buffers[i]);
+    }
+    free(buffers);
 }
 
-static int ler_metadados(estado_bmpfs *estado) {
-    size_t tamanho_metadados = calcular_tamanho_metadados(estado);
-    char *buffer = malloc(tamanho_metadados);
-    if (!buffer) {
-        registrar_debug("Falha ao alocar buffer para metadados\n");
-        return -ENOMEM;
+static void criar_chave_buffers_thread(void) {
+    pthread_key_create(&chave_buffers_thread, liberar_buffers_thread);
+}
+
+static size_t capacidade_buffer_thread(void) {
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    size_t capacidade = BMPFS_TAMANHO_BUFFER_THREAD - BMPFS_TAMANHO_BUFFER_THREAD % tamanho_bloco;
+    return capacidade > tamanho_bloco ? capacidade : tamanho_bloco;
+}
+
+static char *obter_buffer_thread(int qual) {
+    pthread_once(&buffers_thread_iniciados, criar_chave_buffers_thread);
+    BuffersThread *buffers = pthread_getspecific(chave_buffers_thread);
+    if (!buffers) {
+        buffers = calloc(1, sizeof(BuffersThread));
+        if (!buffers || pthread_setspecific(chave_buffers_thread, buffers) != 0) {
+            free(buffers);
+            return NULL;
+        }
     }
-    if (fseek(estado->arquivo_bmp, estado->cabecalho.deslocamento_dados, SEEK_SET) != 0) {
-        registrar_debug("Falha ao buscar área de metadados\n");
-        free(buffer);
-        return -EIO;
+    if (!buffers->buffers[qual]) {
+        void *buffer;
+        if (posix_memalign(&buffer, BMPFS_ALINHAMENTO_BUFFER, capacidade_buffer_thread()) != 0) {
+            return NULL;
+        }
+        buffers->buffers[qual] = buffer;
     }
-    size_t bytes_lidos = fread(buffer, 1, tamanho_metadados, estado->arquivo_bmp);
-    if (bytes_lidos != tamanho_metadados) {
-        registrar_debug("Falha ao ler área de metadados: lidos %zu bytes, esperados %zu bytes\n", bytes_lidos, tamanho_metadados);
-        free(buffer);
-        return -EIO;
+    return buffers->buffers[qual];
+}
+
+static int ler_posicional(int fd, void *buffer, size_t tamanho, off_t offset) {
+    char *destino = buffer;
+    while (tamanho > 0) {
+        ssize_t lidos = pread(fd, destino, tamanho, offset);
+        if (lidos < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -EIO;
+        }
+        if (lidos == 0) {
+            return -EIO;
+        }
+        destino += lidos;
+        tamanho -= lidos;
+        offset += lidos;
     }
-    size_t tamanho_bitmap = estado->tamanho_dados / estado->tamanho_bloco;
-    memcpy(estado->bitmap, buffer, tamanho_bitmap);
-    memcpy(estado->arquivos, buffer + tamanho_bitmap, estado->max_arquivos * sizeof(MetadadosArquivo));
-    free(buffer);
     return 0;
 }
 
-static int escrever_metadados(estado_bmpfs *estado) {
-    size_t tamanho_metadados = calcular_tamanho_metadados(estado);
-    char *buffer = malloc(tamanho_metadados);
-    if (!buffer) {
-        registrar_debug("Falha ao alocar buffer para metadados\n");
+static int escrever_posicional(int fd, const void *buffer, size_t tamanho, off_t offset) {
+    const char *origem = buffer;
+    while (tamanho > 0) {
+        ssize_t escritos = pwrite(fd, origem, tamanho, offset);
+        if (escritos < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -EIO;
+        }
+        if (escritos == 0) {
+            return -EIO;
+        }
+        origem += escritos;
+        tamanho -= escritos;
+        offset += escritos;
+    }
+    return 0;
+}
+
+static size_t calcular_tamanho_bitmap(estado_bmpfs *estado) {
+    return (estado->superbloco.total_blocos + 7) / 8;
+}
+
+static void *reservar_vetor(size_t capacidade, size_t tamanho_item) {
+    void *vetor = mmap(NULL, capacidade * tamanho_item, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return vetor == MAP_FAILED ? NULL : vetor;
+}
+
+static int ativar_vetor(void *vetor, size_t quantidade, size_t tamanho_item) {
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t tamanho = (quantidade * tamanho_item + pagina - 1) / pagina * pagina;
+    if (tamanho > 0 && mprotect(vetor, tamanho, PROT_READ | PROT_WRITE) != 0) {
         return -ENOMEM;
     }
-    size_t tamanho_bitmap = estado->tamanho_dados / estado->tamanho_bloco;
-    memcpy(buffer, estado->bitmap, tamanho_bitmap);
-    memcpy(buffer + tamanho_bitmap, estado->arquivos, estado->max_arquivos * sizeof(MetadadosArquivo));
-    if (fseek(estado->arquivo_bmp, estado->cabecalho.deslocamento_dados, SEEK_SET) != 0) {
-        registrar_debug("Falha ao buscar área de metadados para escrita\n");
-        free(buffer);
-        return -EIO;
+    return 0;
+}
+
+static void liberar_vetor(void *vetor, size_t capacidade, size_t tamanho_item) {
+    if (vetor) {
+        munmap(vetor, capacidade * tamanho_item);
     }
-    size_t bytes_escritos = fwrite(buffer, 1, tamanho_metadados, estado->arquivo_bmp);
-    if (bytes_escritos != tamanho_metadados) {
-        registrar_debug("Falha ao escrever área de metadados: escritos %zu bytes, esperados %zu bytes\n", bytes_escritos, tamanho_metadados);
-        free(buffer);
-        return -EIO;
+}
+
+static int carregar_superbloco(estado_bmpfs *estado) {
+    off_t base = (off_t)estado->cabecalho.deslocamento_dados;
+    int resultado = formato_ler_superbloco(estado->descritor_bmp, base, estado->tamanho_dados, &estado->superbloco);
+    if (resultado == -EINVAL) {
+        registrar_erro("Imagem não formatada; execute mkfs.bmpfs antes de montar\n");
+        return resultado;
+    } else if (resultado < 0) {
+        registrar_erro("Superbloco inválido ou de versão não suportada: %d\n", resultado);
+        return resultado;
     }
-    if (fflush(estado->arquivo_bmp) != 0) {
-        registrar_debug("Falha ao flush dos metadados no disco\n");
-        free(buffer);
-        return -EIO;
+    resultado = journal_abrir(&estado->journal, &estado->fila_io, base, estado->superbloco.offset_journal,
+                              estado->superbloco.tamanho_journal, estado->superbloco.identificador,
+                              estado->superbloco.bits_lsb);
+    if (resultado < 0) {
+        registrar_erro("Falha ao reproduzir journal de metadados: %d\n", resultado);
+        return resultado;
     }
-    free(buffer);
-    return 0;
+    resultado = formato_ler_superbloco(estado->descritor_bmp, base, estado->tamanho_dados, &estado->superbloco);
+    if (resultado < 0) {
+        registrar_erro("Superbloco inválido após reproduzir o journal: %d\n", resultado);
+        journal_fechar(&estado->journal);
+    }
+    return resultado;
 }
 
-static int validar_caminho(const char *caminho) {
-    if (!caminho || strlen(caminho) >= 256) {
-        return -ENAMETOOLONG;
+static int ler_area_metadados(estado_bmpfs *estado, void *destino, size_t tamanho, uint64_t deslocamento) {
+    off_t base = (off_t)estado->cabecalho.deslocamento_dados;
+    unsigned int bits = estado->superbloco.bits_lsb;
+    if (bits) {
+        return lsb_ler_portadora(estado->descritor_bmp, destino, tamanho,
+                                 base + (off_t)lsb_tamanho_portadora(deslocamento, bits), bits);
     }
-    if (caminho[0] == '/') {
-        caminho++;
+    return ler_posicional(estado->descritor_bmp, destino, tamanho, base + (off_t)deslocamento);
+}
+
+static int ler_metadados(estado_bmpfs *estado) {
+    off_t base = (off_t)estado->cabecalho.deslocamento_dados;
+    SuperblocoBMPFS *superbloco = &estado->superbloco;
+    size_t tamanho_bitmap = calcular_tamanho_bitmap(estado);
+    size_t tamanho_entradas = superbloco->max_arquivos * sizeof(MetadadosArquivo);
+    if (ler_area_metadados(estado, estado->bitmap, tamanho_bitmap, superbloco->offset_bitmap) < 0 ||
+        ler_area_metadados(estado, estado->arquivos, tamanho_entradas, superbloco->offset_tabela) < 0) {
+        registrar_erro("Falha ao ler área de metadados: esperados %zu bytes (errno: %d - %s)\n",
+                       tamanho_bitmap + tamanho_entradas, errno, strerror(errno));
+        return -EIO;
     }
-    if (strchr(caminho, '/')) {
-        return -EINVAL;
+    size_t tamanho_grupo = superbloco->entradas_por_grupo * sizeof(MetadadosArquivo);
+    for (uint32_t grupo = 0; grupo < superbloco->num_grupos_inodes; grupo++) {
+        size_t inicio = superbloco->max_arquivos + (size_t)grupo * superbloco->entradas_por_grupo;
+        if (ler_posicional(estado->descritor_bmp, &estado->arquivos[inicio], tamanho_grupo,
+                           base + formato_deslocamento_entrada(superbloco, inicio)) < 0) {
+            registrar_erro("Falha ao ler grupo %u da tabela de arquivos (errno: %d - %s)\n",
+                           grupo, errno, strerror(errno));
+            return -EIO;
+        }
     }
     return 0;
 }
 
-static int caminho_para_indice_metadados(const char *caminho) {
-    int validacao = validar_caminho(caminho);
-    if (validacao < 0) {
-        return validacao;
+static void ajustar_sujos(estado_bmpfs *estado, int64_t registros, size_t tamanho) {
+    __atomic_add_fetch(&estado->bytes_sujos, registros * (int64_t)(sizeof(RegistroJournal) + tamanho),
+                       __ATOMIC_RELAXED);
+}
+
+static void marcar_bits_sujos(estado_bmpfs *estado, uint64_t *palavra, uint64_t bits, size_t tamanho) {
+    uint64_t anteriores = __atomic_fetch_or(palavra, bits, __ATOMIC_RELEASE);
+    ajustar_sujos(estado, __builtin_popcountll(bits & ~anteriores), tamanho);
+}
+
+static void marcar_arquivo_sujo(estado_bmpfs *estado, size_t idx) {
+    marcar_bits_sujos(estado, &estado->arquivos_sujos[idx / 64], UINT64_C(1) << (idx % 64), sizeof(MetadadosArquivo));
+}
+
+static void marcar_pagina_suja(estado_bmpfs *estado, size_t pagina) {
+    marcar_bits_sujos(estado, &estado->paginas_bitmap_sujas[pagina / 64], UINT64_C(1) << (pagina % 64),
+                   BMPFS_PAGINA_BITMAP);
+}
+
+static void marcar_bitmap_sujo(estado_bmpfs *estado, size_t bloco_inicio, size_t num_blocos) {
+    size_t primeira = (bloco_inicio / 8) / BMPFS_PAGINA_BITMAP;
+    size_t ultima = ((bloco_inicio + num_blocos - 1) / 8) / BMPFS_PAGINA_BITMAP;
+    for (size_t pagina = primeira; pagina <= ultima; pagina++) {
+        marcar_pagina_suja(estado, pagina);
     }
-    const char *nome = caminho;
-    if (caminho[0] == '/') {
-        nome++;
+}
+
+static void marcar_tudo_sujo(estado_bmpfs *estado) {
+    size_t num_paginas = (calcular_tamanho_bitmap(estado) + BMPFS_PAGINA_BITMAP - 1) / BMPFS_PAGINA_BITMAP;
+    for (size_t pagina = 0; pagina < num_paginas; pagina++) {
+        marcar_pagina_suja(estado, pagina);
     }
-    for (size_t i = 0; i < estado_sistema_bmpfs.max_arquivos; i++) {
-        if (estado_sistema_bmpfs.arquivos[i].nome_arquivo[0] != '\0' &&
-            strcmp(estado_sistema_bmpfs.arquivos[i].nome_arquivo, nome) == 0) {
-            return i;
-        }
+    size_t num_arquivos = __atomic_load_n(&estado->max_arquivos, __ATOMIC_ACQUIRE);
+    for (size_t idx = 0; idx < num_arquivos; idx++) {
+        marcar_arquivo_sujo(estado, idx);
     }
-    return -ENOENT;
+    __atomic_store_n(&estado->superbloco_sujo, 1, __ATOMIC_RELEASE);
 }
 
-static uint32_t encontrar_blocos_livres(size_t num_blocos) {
-    if (num_blocos == 0) {
-        return 0;
+static int cabe_na_transacao(estado_bmpfs *estado, size_t tamanho) {
+    if (tamanho <= journal_espaco_transacao(&estado->journal)) {
+        return 1;
     }
-    size_t total_blocos = estado_sistema_bmpfs.tamanho_dados / estado_sistema_bmpfs.tamanho_bloco;
-    size_t consecutivos = 0;
-    uint32_t bloco_inicio = 0;
-    for (size_t i = 0; i < total_blocos; i++) {
-        if (estado_sistema_bmpfs.bitmap[i] == 0) {
-            if (consecutivos == 0) {
-                bloco_inicio = i;
+    return estado->journal.registros_transacao == 0 ? -E2BIG : 0;
+}
+
+static int registrar_paginas_bitmap(estado_bmpfs *estado) {
+    size_t tamanho_bitmap = calcular_tamanho_bitmap(estado);
+    size_t num_paginas = (tamanho_bitmap + BMPFS_PAGINA_BITMAP - 1) / BMPFS_PAGINA_BITMAP;
+    for (size_t palavra = 0; palavra < (num_paginas + 63) / 64; palavra++) {
+        uint64_t bits = __atomic_exchange_n(&estado->paginas_bitmap_sujas[palavra], 0, __ATOMIC_ACQ_REL);
+        ajustar_sujos(estado, -__builtin_popcountll(bits), BMPFS_PAGINA_BITMAP);
+        while (bits) {
+            size_t pagina = palavra * 64 + __builtin_ctzll(bits);
+            size_t inicio = pagina * BMPFS_PAGINA_BITMAP;
+            size_t tamanho = tamanho_bitmap - inicio < BMPFS_PAGINA_BITMAP ? tamanho_bitmap - inicio : BMPFS_PAGINA_BITMAP;
+            int cabe = cabe_na_transacao(estado, tamanho);
+            if (cabe <= 0) {
+                marcar_bits_sujos(estado, &estado->paginas_bitmap_sujas[palavra], bits, BMPFS_PAGINA_BITMAP);
+                return cabe < 0 ? cabe : 1;
             }
-            consecutivos++;
-            if (consecutivos >= num_blocos) {
-                return bloco_inicio;
+            pthread_mutex_lock(&estado->trava_alocador);
+            int resultado = journal_adicionar(&estado->journal, estado->superbloco.offset_bitmap + inicio,
+                                              estado->bitmap + inicio, tamanho);
+            pthread_mutex_unlock(&estado->trava_alocador);
+            if (resultado < 0) {
+                return resultado;
             }
-        } else {
-            consecutivos = 0;
+            bits &= bits - 1;
         }
     }
-    return UINT32_MAX;
+    return 0;
 }
 
-static int ler_blocos(uint32_t bloco_inicio, size_t num_blocos, char *buffer) {
-    if (!buffer || !estado_sistema_bmpfs.arquivo_bmp) {
-        return -EINVAL;
-    }
-    size_t tamanho_metadados = calcular_tamanho_metadados(&estado_sistema_bmpfs);
-    size_t offset = estado_sistema_bmpfs.cabecalho.deslocamento_dados + tamanho_metadados +
-                    (bloco_inicio * estado_sistema_bmpfs.tamanho_bloco);
-    if (fseek(estado_sistema_bmpfs.arquivo_bmp, offset, SEEK_SET) != 0) {
-        registrar_debug("Falha ao buscar blocos para leitura (errno: %d - %s)\n", errno, strerror(errno));
-        return -EIO;
-    }
-    size_t bytes_lidos = fread(buffer, 1, estado_sistema_bmpfs.tamanho_bloco * num_blocos, estado_sistema_bmpfs.arquivo_bmp);
-    if (bytes_lidos != estado_sistema_bmpfs.tamanho_bloco * num_blocos) {
-        registrar_debug("Falha ao ler blocos: lidos %zu bytes, esperados %zu bytes\n", bytes_lidos, estado_sistema_bmpfs.tamanho_bloco * num_blocos);
-        return -EIO;
+static int registrar_entradas_sujas(estado_bmpfs *estado) {
+    size_t num_arquivos = __atomic_load_n(&estado->max_arquivos, __ATOMIC_ACQUIRE);
+    for (size_t palavra = 0; palavra < (num_arquivos + 63) / 64; palavra++) {
+        uint64_t bits = __atomic_exchange_n(&estado->arquivos_sujos[palavra], 0, __ATOMIC_ACQ_REL);
+        ajustar_sujos(estado, -__builtin_popcountll(bits), sizeof(MetadadosArquivo));
+        while (bits) {
+            size_t primeiro = __builtin_ctzll(bits);
+            uint64_t restantes = ~(bits >> primeiro);
+            size_t sequencia = restantes ? (size_t)__builtin_ctzll(restantes) : 64 - primeiro;
+            size_t cabem = journal_espaco_transacao(&estado->journal) /
+                           (sizeof(RegistroJournal) + sizeof(MetadadosArquivo));
+            if (cabem == 0) {
+                marcar_bits_sujos(estado, &estado->arquivos_sujos[palavra], bits, sizeof(MetadadosArquivo));
+                return estado->journal.registros_transacao == 0 ? -E2BIG : 1;
+            }
+            if (sequencia > cabem) {
+                sequencia = cabem;
+            }
+            uint64_t mascara = (sequencia == 64 ? ~UINT64_C(0) : ((UINT64_C(1) << sequencia) - 1)) << primeiro;
+            size_t idx = palavra * 64 + primeiro;
+            for (size_t i = idx; i < idx + sequencia; i++) {
+                pthread_rwlock_rdlock(&estado->travas_arquivos[i]);
+            }
+            int resultado = 0;
+            for (size_t i = idx; resultado == 0 && i < idx + sequencia;) {
+                size_t contiguas = formato_entradas_contiguas(&estado->superbloco, i);
+                if (contiguas > idx + sequencia - i) {
+                    contiguas = idx + sequencia - i;
+                }
+                resultado = journal_adicionar(&estado->journal, formato_deslocamento_entrada(&estado->superbloco, i),
+                                              &estado->arquivos[i], contiguas * sizeof(MetadadosArquivo));
+                i += contiguas;
+            }
+            for (size_t i = idx; i < idx + sequencia; i++) {
+                pthread_rwlock_unlock(&estado->travas_arquivos[i]);
+            }
+            if (resultado < 0) {
+                return resultado;
+            }
+            bits &= ~mascara;
+        }
     }
     return 0;
 }
 
-static int escrever_blocos(uint32_t bloco_inicio, size_t num_blocos, const char *buffer) {
-    if (!buffer || !estado_sistema_bmpfs.arquivo_bmp) {
-        return -EINVAL;
+static int confirmar_transacao(estado_bmpfs *estado, int sincronizar, int datasync) {
+    LoteIO lote;
+    fila_io_lote(&lote, &estado->fila_io);
+    int incompleta = 0;
+    int resultado = registrar_paginas_bitmap(estado);
+    if (resultado > 0) {
+        incompleta = 1;
+    } else if (resultado == 0) {
+        resultado = registrar_entradas_sujas(estado);
+        incompleta = resultado > 0;
     }
-    size_t tamanho_metadados = calcular_tamanho_metadados(&estado_sistema_bmpfs);
-    size_t offset = estado_sistema_bmpfs.cabecalho.deslocamento_dados + tamanho_metadados +
-                    (bloco_inicio * estado_sistema_bmpfs.tamanho_bloco);
-    if (fseek(estado_sistema_bmpfs.arquivo_bmp, offset, SEEK_SET) != 0) {
-        registrar_debug("Falha ao buscar blocos para escrita (errno: %d - %s)\n", errno, strerror(errno));
-        return -EIO;
+    if (resultado > 0) {
+        resultado = 0;
     }
-    size_t bytes_escritos = fwrite(buffer, 1, estado_sistema_bmpfs.tamanho_bloco * num_blocos, estado_sistema_bmpfs.arquivo_bmp);
-    if (bytes_escritos != estado_sistema_bmpfs.tamanho_bloco * num_blocos) {
-        registrar_debug("Falha ao escrever blocos: escritos %zu bytes, esperados %zu bytes\n", bytes_escritos, estado_sistema_bmpfs.tamanho_bloco * num_blocos);
-        return -EIO;
+    if (resultado == 0 && __atomic_load_n(&estado->superbloco_sujo, __ATOMIC_ACQUIRE)) {
+        resultado = cabe_na_transacao(estado, sizeof(SuperblocoBMPFS));
+        if (resultado == 0) {
+            incompleta = 1;
+        } else if (resultado > 0) {
+            resultado = 0;
+            if (__atomic_exchange_n(&estado->superbloco_sujo, 0, __ATOMIC_ACQ_REL)) {
+                pthread_mutex_lock(&estado->trava_alocador);
+                resultado = journal_adicionar(&estado->journal, 0, &estado->superbloco, sizeof(SuperblocoBMPFS));
+                pthread_mutex_unlock(&estado->trava_alocador);
+            }
+        }
+    }
+    if (resultado == 0) {
+        resultado = cache_blocos_descarregar_em_lote(&estado->cache_blocos, &lote);
+        if (resultado < 0) {
+            registrar_erro("Falha ao descarregar blocos sujos do cache: %d\n", resultado);
+        }
+    }
+    if (resultado == 0 && __atomic_exchange_n(&estado->dados_pendentes, 0, __ATOMIC_ACQ_REL)) {
+        resultado = fila_io_sincronizar(&lote, 1);
+    }
+    if (resultado == 0) {
+        resultado = journal_confirmar_em_lote(&estado->journal, &lote);
+    } else {
+        journal_descartar(&estado->journal);
     }
-    if (fflush(estado_sistema_bmpfs.arquivo_bmp) != 0) {
-        registrar_debug("Falha ao flush dos blocos no disco (errno: %d - %s)\n", errno, strerror(errno));
+    if (resultado == 0 && sincronizar && !incompleta) {
+        resultado = fila_io_sincronizar(&lote, datasync);
+    }
+    int resultado_lote = fila_io_executar(&lote);
+    if (resultado == 0) {
+        resultado = resultado_lote;
+    }
+    if (resultado < 0) {
+        __atomic_store_n(&estado->dados_pendentes, 1, __ATOMIC_RELEASE);
+        marcar_tudo_sujo(estado);
+    }
+    estatisticas_contar(resultado < 0 ? ESTATISTICAS_FALHAS_METADADOS : ESTATISTICAS_CONFIRMACOES_METADADOS, 1);
+    return resultado < 0 ? resultado : incompleta;
+}
+
+static void liberar_blocos(uint32_t bloco_inicio, size_t num_blocos);
+
+static int liberar_extents_pendentes(estado_bmpfs *estado) {
+    size_t quantidade = estado->num_extents_pendentes;
+    for (size_t i = 0; i < quantidade; i++) {
+        ExtentArquivo *extent = &estado->extents_pendentes[i];
+        cache_blocos_invalidar(&estado->cache_blocos, extent->bloco_inicio, extent->num_blocos);
+        liberar_blocos(extent->bloco_inicio, extent->num_blocos);
+    }
+    estado->num_extents_pendentes = 0;
+    return quantidade > 0;
+}
+
+static int confirmar_metadados(estado_bmpfs *estado, int sincronizar, int datasync) {
+    pthread_mutex_lock(&estado->trava_metadados);
+    int resultado;
+    do {
+        do {
+            resultado = confirmar_transacao(estado, sincronizar, datasync);
+        } while (resultado > 0);
+    } while (resultado == 0 && liberar_extents_pendentes(estado));
+    pthread_mutex_unlock(&estado->trava_metadados);
+    if (resultado < 0) {
+        registrar_erro("Falha ao confirmar metadados sujos no journal: %d\n", resultado);
         return -EIO;
     }
     return 0;
 }
 
-static int getattr_bmpfs(const char *caminho, struct stat *stbuf,
-                         struct fuse_file_info *fi) {
-    (void) fi;
-    memset(stbuf, 0, sizeof(struct stat));
-    if (strcmp(caminho, "/") == 0) {
-        stbuf->st_mode = S_IFDIR | 0755;
-        stbuf->st_nlink = 2;
-        stbuf->st_uid = getuid();
-        stbuf->st_gid = getgid();
-        stbuf->st_atime = time(NULL);
-        stbuf->st_mtime = stbuf->st_atime;
-        stbuf->st_ctime = stbuf->st_atime;
+static int escrever_metadados(estado_bmpfs *estado) {
+    return confirmar_metadados(estado, 0, 0);
+}
+
+static int limite_sujos_atingido(estado_bmpfs *estado) {
+    return __atomic_load_n(&estado->bytes_sujos, __ATOMIC_RELAXED) >= (int64_t)(estado->journal.tamanho_log / 4);
+}
+
+static int agendar_metadados(estado_bmpfs *estado) {
+    if (estado->atraso_metadados_ms > 0 && !limite_sujos_atingido(estado)) {
         return 0;
     }
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+    pthread_mutex_lock(&estado->trava_confirmacao);
+    uint64_t geracao = ++estado->geracao_pedida;
+    while (estado->geracao_confirmada < geracao) {
+        if (estado->confirmacao_em_andamento) {
+            pthread_cond_wait(&estado->sinal_confirmacao, &estado->trava_confirmacao);
+            continue;
+        }
+        estado->confirmacao_em_andamento = 1;
+        uint64_t alvo = estado->geracao_pedida;
+        pthread_mutex_unlock(&estado->trava_confirmacao);
+        int resultado = escrever_metadados(estado);
+        pthread_mutex_lock(&estado->trava_confirmacao);
+        estado->geracao_confirmada = alvo;
+        estado->resultado_confirmacao = resultado;
+        estado->confirmacao_em_andamento = 0;
+        pthread_cond_broadcast(&estado->sinal_confirmacao);
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    stbuf->st_mode = meta->modo;
-    stbuf->st_nlink = meta->eh_diretorio ? 2 : 1;
-    stbuf->st_size = meta->tamanho;
-    stbuf->st_uid = meta->uid;
-    stbuf->st_gid = meta->gid;
-    stbuf->st_atime = meta->acessado;
-    stbuf->st_mtime = meta->modificado;
-    stbuf->st_ctime = meta->criado;
-    stbuf->st_blocks = (meta->tamanho + 511) / 512;
-    stbuf->st_blksize = estado_sistema_bmpfs.tamanho_bloco;
-    return 0;
+    int resultado = estado->resultado_confirmacao;
+    pthread_mutex_unlock(&estado->trava_confirmacao);
+    return resultado;
 }
 
-static int criar_diretorio(const char *caminho, mode_t modo) {
-    registrar_debug("Criando diretório: %s\n", caminho);
-    int validacao = validar_caminho(caminho);
-    if (validacao < 0) {
-        registrar_debug("Validação de caminho falhou: %d\n", validacao);
-        return validacao;
+static void checkpoint_metadados(estado_bmpfs *estado, uint64_t *ultima_seq) {
+    pthread_mutex_lock(&estado->trava_metadados);
+    Journal *journal = &estado->journal;
+    if (journal->pendentes &&
+        (journal->proxima_seq == *ultima_seq || journal->bytes_pendentes > journal->tamanho_log / 2)) {
+        if (journal_checkpoint(journal) < 0) {
+            registrar_erro("Falha no checkpoint do journal de metadados\n");
+        } else {
+            estatisticas_contar(ESTATISTICAS_CHECKPOINTS_JOURNAL, 1);
+        }
     }
-    if (caminho_para_indice_metadados(caminho) >= 0) {
-        registrar_debug("Diretório já existe\n");
-        return -EEXIST;
+    *ultima_seq = journal->proxima_seq;
+    pthread_mutex_unlock(&estado->trava_metadados);
+}
+
+static void calcular_prazo(struct timespec *limite, unsigned int intervalo_ms) {
+    clock_gettime(CLOCK_REALTIME, limite);
+    limite->tv_sec += intervalo_ms / 1000;
+    limite->tv_nsec += (long)(intervalo_ms % 1000) * 1000000L;
+    if (limite->tv_nsec >= 1000000000L) {
+        limite->tv_sec++;
+        limite->tv_nsec -= 1000000000L;
     }
-    int idx = -1;
-    for (size_t i = 0; i < estado_sistema_bmpfs.max_arquivos; i++) {
-        if (estado_sistema_bmpfs.arquivos[i].nome_arquivo[0] == '\0') {
-            idx = i;
-            break;
+}
+
+static void *executar_escritor_metadados(void *argumento) {
+    estado_bmpfs *estado = argumento;
+    unsigned int intervalo = estado->atraso_metadados_ms ? estado->atraso_metadados_ms : BMPFS_ATRASO_METADADOS_PADRAO;
+    uint64_t ultima_seq = 0;
+    pthread_mutex_lock(&estado->trava_escritor);
+    while (!estado->encerrando_escritor) {
+        struct timespec limite;
+        calcular_prazo(&limite, intervalo);
+        pthread_cond_timedwait(&estado->sinal_escritor, &estado->trava_escritor, &limite);
+        pthread_mutex_unlock(&estado->trava_escritor);
+        if (estado->atraso_metadados_ms > 0) {
+            escrever_metadados(estado);
         }
+        checkpoint_metadados(estado, &ultima_seq);
+        pthread_mutex_lock(&estado->trava_escritor);
     }
-    if (idx < 0) {
-        registrar_debug("Nenhum slot de metadados livre\n");
+    pthread_mutex_unlock(&estado->trava_escritor);
+    return NULL;
+}
+
+static int iniciar_escritor_metadados(estado_bmpfs *estado) {
+    size_t tamanho_bitmap = calcular_tamanho_bitmap(estado);
+    size_t num_paginas = (tamanho_bitmap + BMPFS_PAGINA_BITMAP - 1) / BMPFS_PAGINA_BITMAP;
+    estado->paginas_bitmap_sujas = calloc((num_paginas + 63) / 64, sizeof(uint64_t));
+    estado->arquivos_sujos = calloc((estado->capacidade_inodes + 63) / 64, sizeof(uint64_t));
+    if (!estado->paginas_bitmap_sujas || !estado->arquivos_sujos) {
+        free(estado->paginas_bitmap_sujas);
+        free(estado->arquivos_sujos);
+        estado->paginas_bitmap_sujas = NULL;
+        estado->arquivos_sujos = NULL;
         return -ENOMEM;
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    const char *nome_diretorio = caminho;
-    if (caminho[0] == '/') {
-        nome_diretorio++;
-    }
-    strncpy(meta->nome_arquivo, nome_diretorio, sizeof(meta->nome_arquivo) - 1);
-    meta->nome_arquivo[sizeof(meta->nome_arquivo) - 1] = '\0';
-    meta->tamanho = 0;
-    meta->criado = time(NULL);
-    meta->modificado = meta->criado;
-    meta->acessado = meta->criado;
-    meta->primeiro_bloco = UINT32_MAX;
-    meta->num_blocos = 0;
-    meta->modo = S_IFDIR | (modo & 0777);
-    meta->uid = getuid();
-    meta->gid = getgid();
-    meta->eh_diretorio = 1;
-    registrar_debug("Diretório criado com sucesso: %s (idx: %d)\n", caminho, idx);
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após criação do diretório\n");
-        return -EIO;
+    pthread_mutex_init(&estado->trava_escritor, NULL);
+    pthread_cond_init(&estado->sinal_escritor, NULL);
+    pthread_mutex_init(&estado->trava_confirmacao, NULL);
+    pthread_cond_init(&estado->sinal_confirmacao, NULL);
+    estado->geracao_pedida = 0;
+    estado->geracao_confirmada = 0;
+    estado->confirmacao_em_andamento = 0;
+    estado->resultado_confirmacao = 0;
+    estado->bytes_sujos = 0;
+    estado->dados_pendentes = 0;
+    estado->encerrando_escritor = 0;
+    estado->escritor_ativo = 0;
+    if (pthread_create(&estado->thread_escritor, NULL, executar_escritor_metadados, estado) != 0) {
+        registrar_aviso("Falha ao iniciar escritor de metadados; usando escrita síncrona\n");
+        estado->atraso_metadados_ms = 0;
+        return 0;
     }
+    estado->escritor_ativo = 1;
     return 0;
 }
 
-static int criar_bmpfs(const char *caminho, mode_t modo,
-                       struct fuse_file_info *fi) {
-    (void) fi;
-    registrar_debug("Criando arquivo: %s\n", caminho);
-    int validacao = validar_caminho(caminho);
-    if (validacao < 0) {
-        registrar_debug("Validação de caminho falhou: %d\n", validacao);
-        return validacao;
+static void parar_escritor_metadados(estado_bmpfs *estado) {
+    if (!estado->arquivos_sujos) {
+        return;
     }
-    if (caminho_para_indice_metadados(caminho) >= 0) {
-        registrar_debug("Arquivo já existe\n");
-        return -EEXIST;
+    if (estado->escritor_ativo) {
+        pthread_mutex_lock(&estado->trava_escritor);
+        estado->encerrando_escritor = 1;
+        pthread_cond_signal(&estado->sinal_escritor);
+        pthread_mutex_unlock(&estado->trava_escritor);
+        pthread_join(estado->thread_escritor, NULL);
+        estado->escritor_ativo = 0;
     }
-    int idx = -1;
-    for (size_t i = 0; i < estado_sistema_bmpfs.max_arquivos; i++) {
-        if (estado_sistema_bmpfs.arquivos[i].nome_arquivo[0] == '\0') {
-            idx = i;
-            break;
-        }
+    if (escrever_metadados(estado) < 0) {
+        registrar_aviso("Falha ao escrever metadados na destruição\n");
     }
-    if (idx < 0) {
-        registrar_debug("Nenhum slot de metadados livre\n");
-        return -ENOMEM;
+    journal_fechar(&estado->journal);
+    free(estado->extents_pendentes);
+    estado->extents_pendentes = NULL;
+    estado->num_extents_pendentes = 0;
+    pthread_cond_destroy(&estado->sinal_confirmacao);
+    pthread_mutex_destroy(&estado->trava_confirmacao);
+    pthread_cond_destroy(&estado->sinal_escritor);
+    pthread_mutex_destroy(&estado->trava_escritor);
+    free(estado->paginas_bitmap_sujas);
+    free(estado->arquivos_sujos);
+    estado->paginas_bitmap_sujas = NULL;
+    estado->arquivos_sujos = NULL;
+}
+
+static uint32_t hash_entrada(uint32_t pai, const char *nome) {
+    return indice_nomes_hash(nome) ^ (pai * UINT32_C(2654435761));
+}
+
+static int comparar_nome_slot(void *contexto, int32_t slot, const char *nome) {
+    uint32_t pai = *(const uint32_t *)contexto;
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[slot];
+    return meta->pai != pai || strcmp(meta->nome_arquivo, nome) != 0;
+}
+
+static int32_t buscar_entrada(uint32_t pai, const char *nome) {
+    int32_t idx = indice_nomes_buscar(&estado_sistema_bmpfs.indice_nomes, hash_entrada(pai, nome), nome,
+                                      comparar_nome_slot, &pai);
+    return idx >= 0 ? idx : -ENOENT;
+}
+
+static ArvoreDiretorio *diretorio_do_slot(uint32_t slot) {
+    return slot == BMPFS_PAI_RAIZ ? &estado_sistema_bmpfs.diretorio_raiz : &estado_sistema_bmpfs.diretorios[slot];
+}
+
+static int eh_diretorio_slot(uint32_t slot) {
+    return slot == BMPFS_PAI_RAIZ || estado_sistema_bmpfs.arquivos[slot].eh_diretorio;
+}
+
+static int resolver_caminho(const char *caminho, size_t comprimento, uint32_t *slot) {
+    char copia[CACHE_DENTRIES_MAX_CAMINHO];
+    int armazenavel = comprimento < sizeof(copia);
+    if (armazenavel) {
+        memcpy(copia, caminho, comprimento);
+        copia[comprimento] = '\0';
+        int32_t em_cache = cache_dentries_buscar(&estado_sistema_bmpfs.cache_dentries, copia);
+        if (em_cache >= 0) {
+            *slot = em_cache;
+            return 0;
+        }
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    const char *nome_arquivo = caminho;
-    if (caminho[0] == '/') {
-        nome_arquivo++;
+    uint32_t atual = BMPFS_PAI_RAIZ;
+    size_t posicao = 0;
+    while (posicao < comprimento) {
+        while (posicao < comprimento && caminho[posicao] == '/') {
+            posicao++;
+        }
+        if (posicao == comprimento) {
+            break;
+        }
+        size_t fim = posicao;
+        while (fim < comprimento && caminho[fim] != '/') {
+            fim++;
+        }
+        char nome[sizeof(((MetadadosArquivo *)0)->nome_arquivo)];
+        if (fim - posicao >= sizeof(nome)) {
+            return -ENAMETOOLONG;
+        }
+        if (!eh_diretorio_slot(atual)) {
+            return -ENOTDIR;
+        }
+        memcpy(nome, caminho + posicao, fim - posicao);
+        nome[fim - posicao] = '\0';
+        int32_t encontrado = buscar_entrada(atual, nome);
+        if (encontrado < 0) {
+            return encontrado;
+        }
+        atual = encontrado;
+        posicao = fim;
     }
-    strncpy(meta->nome_arquivo, nome_arquivo, sizeof(meta->nome_arquivo) - 1);
-    meta->nome_arquivo[sizeof(meta->nome_arquivo) - 1] = '\0';
-    meta->tamanho = 0;
-    meta->criado = time(NULL);
-    meta->modificado = meta->criado;
-    meta->acessado = meta->criado;
-    meta->primeiro_bloco = UINT32_MAX;
-    meta->num_blocos = 0;
-    meta->modo = S_IFREG | (modo & 0777);
-    meta->uid = getuid();
-    meta->gid = getgid();
-    meta->eh_diretorio = 0;
-    registrar_debug("Arquivo criado com sucesso: %s (idx: %d)\n", caminho, idx);
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após criação do arquivo\n");
-        return -EIO;
+    if (armazenavel && atual != BMPFS_PAI_RAIZ) {
+        cache_dentries_inserir(&estado_sistema_bmpfs.cache_dentries, copia, atual);
     }
+    *slot = atual;
     return 0;
 }
 
-static int excluir_bmpfs(const char *caminho) {
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+static int separar_caminho(const char *caminho, uint32_t *pai, const char **nome) {
+    if (!caminho || caminho[0] != '/') {
+        return -EINVAL;
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (meta->eh_diretorio) {
-        registrar_debug("Não é possível excluir um diretório: %s\n", caminho);
-        return -EISDIR;
+    const char *barra = strrchr(caminho, '/');
+    *nome = barra + 1;
+    size_t comprimento_nome = strlen(*nome);
+    if (comprimento_nome == 0) {
+        return -EINVAL;
     }
-    for (uint32_t i = 0; i < meta->num_blocos; i++) {
-        estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
+    if (comprimento_nome >= sizeof(((MetadadosArquivo *)0)->nome_arquivo)) {
+        return -ENAMETOOLONG;
     }
-    memset(meta, 0, sizeof(MetadadosArquivo));
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após exclusão do arquivo\n");
-        return -EIO;
+    int resultado = resolver_caminho(caminho, barra - caminho, pai);
+    if (resultado < 0) {
+        return resultado;
     }
-    registrar_debug("Arquivo excluído com sucesso: %s (idx: %d)\n", caminho, idx);
-    return 0;
+    return eh_diretorio_slot(*pai) ? 0 : -ENOTDIR;
 }
 
-static int ler_bmpfs(const char *caminho, char *buf, size_t tamanho, off_t offset,
-                     struct fuse_file_info *fi) {
-    (void) fi;
-    if (!buf) {
+static int caminho_para_indice_metadados(const char *caminho) {
+    if (!caminho || caminho[0] != '/') {
         return -EINVAL;
     }
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
-    }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (meta->eh_diretorio) {
-        return -EISDIR;
+    uint32_t slot;
+    int resultado = resolver_caminho(caminho, strlen(caminho), &slot);
+    if (resultado < 0) {
+        return resultado;
     }
-    meta->acessado = time(NULL);
-    if (offset < 0) {
-        return -EINVAL;
+    return slot == BMPFS_PAI_RAIZ ? -EISDIR : (int)slot;
+}
+
+static void registrar_atividade(void) {
+    time_t agora = time(NULL);
+    if (__atomic_load_n(&estado_sistema_bmpfs.ultima_atividade, __ATOMIC_RELAXED) != agora) {
+        __atomic_store_n(&estado_sistema_bmpfs.ultima_atividade, agora, __ATOMIC_RELAXED);
     }
-    if ((uint64_t)offset >= meta->tamanho) {
-        return 0;
+}
+
+static void travar_slot(int idx, int escrita) {
+    if (escrita) {
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    } else {
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
     }
-    if ((uint64_t)(offset + tamanho) > meta->tamanho) {
-        tamanho = meta->tamanho - offset;
+}
+
+static int travar_arquivo_por_caminho(const char *caminho, int escrita) {
+    registrar_atividade();
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    int idx = caminho_para_indice_metadados(caminho);
+    if (idx >= 0) {
+        travar_slot(idx, escrita);
     }
-    uint32_t bloco_inicio = meta->primeiro_bloco + (offset / estado_sistema_bmpfs.tamanho_bloco);
-    size_t deslocamento_bloco = offset % estado_sistema_bmpfs.tamanho_bloco;
-    size_t blocos_para_ler = (tamanho + deslocamento_bloco + estado_sistema_bmpfs.tamanho_bloco - 1) / estado_sistema_bmpfs.tamanho_bloco;
-    char *buffer_temp = malloc(blocos_para_ler * estado_sistema_bmpfs.tamanho_bloco);
-    if (!buffer_temp) {
-        return -ENOMEM;
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    return idx;
+}
+
+static int slot_ativo(uint64_t slot) {
+    return slot < estado_sistema_bmpfs.max_arquivos && estado_sistema_bmpfs.arquivos[slot].nome_arquivo[0] != '\0';
+}
+
+static int travar_arquivo_por_indice(uint64_t slot, int escrita) {
+    registrar_atividade();
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    int idx = slot_ativo(slot) ? (int)slot : -ENOENT;
+    if (idx >= 0) {
+        travar_slot(idx, escrita);
     }
-    int resultado_leitura = ler_blocos(bloco_inicio, blocos_para_ler, buffer_temp);
-    if (resultado_leitura < 0) {
-        free(buffer_temp);
-        return resultado_leitura;
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    return idx;
+}
+
+static void destravar_arquivo(int idx) {
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+}
+
+static uint32_t alocar_extent(size_t desejados, size_t *obtidos) {
+    pthread_mutex_lock(&estado_sistema_bmpfs.trava_alocador);
+    uint32_t bloco_inicio = indice_livre_alocar(&estado_sistema_bmpfs.indice_livre, desejados, obtidos);
+    if (bloco_inicio != UINT32_MAX) {
+        bitmap_marcar(estado_sistema_bmpfs.bitmap, bloco_inicio, *obtidos, 1);
+        marcar_bitmap_sujo(&estado_sistema_bmpfs, bloco_inicio, *obtidos);
     }
-    memcpy(buf, buffer_temp + deslocamento_bloco, tamanho);
-    free(buffer_temp);
-    registrar_debug("Lido %zu bytes do arquivo: %s (offset: %ld)\n", tamanho, caminho, offset);
-    return (int)tamanho;
+    pthread_mutex_unlock(&estado_sistema_bmpfs.trava_alocador);
+    return bloco_inicio;
 }
 
-static int escrever_bmpfs(const char *caminho, const char *buf, size_t tamanho,
-                          off_t offset, struct fuse_file_info *fi) {
-    (void) fi;
-    registrar_debug("Escrevendo no arquivo: %s (tamanho: %zu, offset: %ld)\n", caminho, tamanho, offset);
-    if (!buf) {
-        registrar_debug("Buffer inválido\n");
-        return -EINVAL;
+static size_t estender_extent(ExtentArquivo *extent, size_t desejados) {
+    uint32_t fim = extent->bloco_inicio + extent->num_blocos;
+    pthread_mutex_lock(&estado_sistema_bmpfs.trava_alocador);
+    size_t obtidos = indice_livre_estender(&estado_sistema_bmpfs.indice_livre, fim, desejados);
+    if (obtidos > 0) {
+        bitmap_marcar(estado_sistema_bmpfs.bitmap, fim, obtidos, 1);
+        marcar_bitmap_sujo(&estado_sistema_bmpfs, fim, obtidos);
     }
-    int idx = caminho_para_indice_metadados(caminho);
+    pthread_mutex_unlock(&estado_sistema_bmpfs.trava_alocador);
+    extent->num_blocos += obtidos;
+    return obtidos;
+}
+
+static void liberar_blocos(uint32_t bloco_inicio, size_t num_blocos) {
+    if (num_blocos == 0) {
+        return;
+    }
+    pthread_mutex_lock(&estado_sistema_bmpfs.trava_alocador);
+    bitmap_marcar(estado_sistema_bmpfs.bitmap, bloco_inicio, num_blocos, 0);
+    marcar_bitmap_sujo(&estado_sistema_bmpfs, bloco_inicio, num_blocos);
+    if (indice_livre_devolver(&estado_sistema_bmpfs.indice_livre, bloco_inicio, num_blocos) < 0) {
+        registrar_erro("Falha ao indexar %zu blocos livres a partir de %u\n", num_blocos, bloco_inicio);
+    }
+    pthread_mutex_unlock(&estado_sistema_bmpfs.trava_alocador);
+}
+
+static off_t offset_bloco(uint32_t bloco) {
+    return (off_t)estado_sistema_bmpfs.cabecalho.deslocamento_dados + estado_sistema_bmpfs.superbloco.offset_dados +
+           ((off_t)bloco * estado_sistema_bmpfs.tamanho_bloco * formato_fator_portadora(&estado_sistema_bmpfs.superbloco));
+}
+
+static int mapear_imagem(estado_bmpfs *estado) {
+    struct stat st;
+    if (fstat(estado->descritor_bmp, &st) == -1) {
+        return -errno;
+    }
+    if (estado->mapeamento && (size_t)st.st_size == estado->tamanho_mapeamento) {
+        return 0;
+    }
+    if (estado->mapeamento) {
+        munmap(estado->mapeamento, estado->tamanho_mapeamento);
+        estado->mapeamento = NULL;
+        estado->tamanho_mapeamento = 0;
+    }
+    void *mapeamento = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, estado->descritor_bmp, 0);
+    if (mapeamento == MAP_FAILED) {
+        return -errno;
+    }
+    madvise(mapeamento, st.st_size, MADV_WILLNEED);
+    estado->mapeamento = mapeamento;
+    estado->tamanho_mapeamento = st.st_size;
+    registrar_info("Imagem mapeada em memória: %zu bytes\n", estado->tamanho_mapeamento);
+    return 0;
+}
+
+static void desmapear_imagem(estado_bmpfs *estado) {
+    if (!estado->mapeamento) {
+        return;
+    }
+    munmap(estado->mapeamento, estado->tamanho_mapeamento);
+    estado->mapeamento = NULL;
+    estado->tamanho_mapeamento = 0;
+    pthread_rwlock_destroy(&estado->trava_mapeamento);
+}
+
+static int acessar_mapeamento(off_t offset, char *buffer, size_t tamanho, int escrita) {
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_mapeamento);
+    if ((size_t)offset + tamanho > estado_sistema_bmpfs.tamanho_mapeamento) {
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_mapeamento);
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_mapeamento);
+        int resultado = 0;
+        if (escrita && (size_t)offset + tamanho > estado_sistema_bmpfs.tamanho_mapeamento &&
+            ftruncate(estado_sistema_bmpfs.descritor_bmp, offset + (off_t)tamanho) == -1) {
+            resultado = -errno;
+        }
+        if (resultado == 0) {
+            resultado = mapear_imagem(&estado_sistema_bmpfs);
+        }
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_mapeamento);
+        if (resultado < 0) {
+            registrar_erro("Falha ao remapear imagem: %d\n", resultado);
+            return resultado;
+        }
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_mapeamento);
+        if ((size_t)offset + tamanho > estado_sistema_bmpfs.tamanho_mapeamento) {
+            pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_mapeamento);
+            return -EIO;
+        }
+    }
+    if (escrita) {
+        memcpy(estado_sistema_bmpfs.mapeamento + offset, buffer, tamanho);
+    } else {
+        memcpy(buffer, estado_sistema_bmpfs.mapeamento + offset, tamanho);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_mapeamento);
+    return 0;
+}
+
+static int acessar_portadora(uint32_t bloco_inicio, size_t num_blocos, char *buffer, int escrita) {
+    unsigned int bits = estado_sistema_bmpfs.superbloco.bits_lsb;
+    char *portadora = obter_buffer_thread(BMPFS_BUFFER_PORTADORA);
+    if (!portadora) {
+        return -ENOMEM;
+    }
+    size_t por_vez = capacidade_buffer_thread() / lsb_tamanho_portadora(1, bits);
+    size_t tamanho = estado_sistema_bmpfs.tamanho_bloco * num_blocos;
+    off_t offset = offset_bloco(bloco_inicio);
+    for (size_t feitos = 0; feitos < tamanho; feitos += por_vez) {
+        size_t parte = tamanho - feitos < por_vez ? tamanho - feitos : por_vez;
+        size_t tamanho_portadora = lsb_tamanho_portadora(parte, bits);
+        off_t offset_portadora = offset + (off_t)lsb_tamanho_portadora(feitos, bits);
+        if (ler_posicional(estado_sistema_bmpfs.descritor_bmp, portadora, tamanho_portadora, offset_portadora) < 0) {
+            registrar_erro("Falha ao ler pixels portadores (errno: %d - %s)\n", errno, strerror(errno));
+            return -EIO;
+        }
+        if (!escrita) {
+            lsb_extrair((uint8_t *)buffer + feitos, (const uint8_t *)portadora, parte, bits);
+            continue;
+        }
+        lsb_embutir((uint8_t *)portadora, (const uint8_t *)buffer + feitos, parte, bits);
+        if (escrever_posicional(estado_sistema_bmpfs.descritor_bmp, portadora, tamanho_portadora, offset_portadora) < 0) {
+            registrar_erro("Falha ao escrever pixels portadores (errno: %d - %s)\n", errno, strerror(errno));
+            return -EIO;
+        }
+    }
+    return 0;
+}
+
+static int ler_blocos(uint32_t bloco_inicio, size_t num_blocos, char *buffer) {
+    if (!buffer || estado_sistema_bmpfs.descritor_bmp < 0) {
+        return -EINVAL;
+    }
+    size_t tamanho = estado_sistema_bmpfs.tamanho_bloco * num_blocos;
+    if (estado_sistema_bmpfs.mapeamento) {
+        return acessar_mapeamento(offset_bloco(bloco_inicio), buffer, tamanho, 0);
+    }
+    if (estado_sistema_bmpfs.superbloco.bits_lsb) {
+        return acessar_portadora(bloco_inicio, num_blocos, buffer, 0);
+    }
+    if (cache_blocos_ler(&estado_sistema_bmpfs.cache_blocos, bloco_inicio, num_blocos, buffer) < 0) {
+        registrar_erro("Falha ao ler blocos: esperados %zu bytes (errno: %d - %s)\n", tamanho, errno, strerror(errno));
+        return -EIO;
+    }
+    return 0;
+}
+
+static int escrever_blocos(uint32_t bloco_inicio, size_t num_blocos, const char *buffer) {
+    if (!buffer || estado_sistema_bmpfs.descritor_bmp < 0) {
+        return -EINVAL;
+    }
+    __atomic_store_n(&estado_sistema_bmpfs.dados_pendentes, 1, __ATOMIC_RELEASE);
+    size_t tamanho = estado_sistema_bmpfs.tamanho_bloco * num_blocos;
+    if (estado_sistema_bmpfs.mapeamento) {
+        return acessar_mapeamento(offset_bloco(bloco_inicio), (char *)buffer, tamanho, 1);
+    }
+    if (estado_sistema_bmpfs.superbloco.bits_lsb) {
+        return acessar_portadora(bloco_inicio, num_blocos, (char *)buffer, 1);
+    }
+    if (cache_blocos_escrever(&estado_sistema_bmpfs.cache_blocos, bloco_inicio, num_blocos, buffer) < 0) {
+        registrar_erro("Falha ao escrever blocos: esperados %zu bytes (errno: %d - %s)\n", tamanho, errno, strerror(errno));
+        return -EIO;
+    }
+    return 0;
+}
+
+static size_t extents_por_bloco(void) {
+    return (estado_sistema_bmpfs.tamanho_bloco - sizeof(CabecalhoBlocoExtents)) / sizeof(ExtentArquivo);
+}
+
+static int extents_continuos(const ExtentArquivo *anterior, uint32_t bloco_inicio, uint32_t sinalizadores) {
+    if (anterior->bloco_inicio == BMPFS_BURACO || bloco_inicio == BMPFS_BURACO) {
+        return anterior->bloco_inicio == bloco_inicio;
+    }
+    return anterior->sinalizadores == sinalizadores && anterior->bloco_inicio + anterior->num_blocos == bloco_inicio;
+}
+
+static int extent_sem_dados(const ExtentArquivo *extent) {
+    return extent->bloco_inicio == BMPFS_BURACO || (extent->sinalizadores & BMPFS_EXTENT_NAO_ESCRITO);
+}
+
+static int reservar_extents(ListaExtents *lista, uint32_t adicionais) {
+    if (lista->quantidade + adicionais <= lista->capacidade) {
+        return 0;
+    }
+    uint32_t nova_capacidade = lista->capacidade ? lista->capacidade : BMPFS_EXTENTS_INLINE;
+    while (nova_capacidade < lista->quantidade + adicionais) {
+        nova_capacidade *= 2;
+    }
+    ExtentArquivo *itens = realloc(lista->itens, nova_capacidade * sizeof(ExtentArquivo));
+    if (!itens) {
+        return -ENOMEM;
+    }
+    lista->itens = itens;
+    uint32_t *inicios = realloc(lista->inicios, nova_capacidade * sizeof(uint32_t));
+    if (!inicios) {
+        return -ENOMEM;
+    }
+    lista->inicios = inicios;
+    lista->capacidade = nova_capacidade;
+    return 0;
+}
+
+static void recalcular_inicios(ListaExtents *lista, uint32_t primeiro) {
+    for (uint32_t i = primeiro; i < lista->quantidade; i++) {
+        lista->inicios[i] = i > 0 ? lista->inicios[i - 1] + lista->itens[i - 1].num_blocos : 0;
+    }
+}
+
+static int adicionar_extent(ListaExtents *lista, uint32_t bloco_inicio, uint32_t num_blocos, uint32_t sinalizadores) {
+    if (lista->quantidade > 0) {
+        ExtentArquivo *ultimo = &lista->itens[lista->quantidade - 1];
+        if (extents_continuos(ultimo, bloco_inicio, sinalizadores)) {
+            ultimo->num_blocos += num_blocos;
+            return 0;
+        }
+    }
+    if (reservar_extents(lista, 1) < 0) {
+        return -ENOMEM;
+    }
+    lista->itens[lista->quantidade].bloco_inicio = bloco_inicio;
+    lista->itens[lista->quantidade].num_blocos = num_blocos;
+    lista->itens[lista->quantidade].sinalizadores = bloco_inicio == BMPFS_BURACO ? 0 : sinalizadores;
+    lista->quantidade++;
+    recalcular_inicios(lista, lista->quantidade - 1);
+    return 0;
+}
+
+static int gravar_extents(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    size_t por_bloco = extents_por_bloco();
+    size_t excedentes = lista->quantidade > BMPFS_EXTENTS_INLINE ? lista->quantidade - BMPFS_EXTENTS_INLINE : 0;
+    size_t blocos_necessarios = (excedentes + por_bloco - 1) / por_bloco;
+    if (blocos_necessarios > lista->num_blocos_cadeia) {
+        uint32_t *cadeia = realloc(lista->blocos_cadeia, blocos_necessarios * sizeof(uint32_t));
+        if (!cadeia) {
+            return -ENOMEM;
+        }
+        lista->blocos_cadeia = cadeia;
+        while (lista->num_blocos_cadeia < blocos_necessarios) {
+            size_t obtidos;
+            uint32_t bloco = alocar_extent(1, &obtidos);
+            if (bloco == UINT32_MAX) {
+                registrar_aviso("Nenhum bloco livre para a lista de extents\n");
+                return -ENOSPC;
+            }
+            lista->blocos_cadeia[lista->num_blocos_cadeia++] = bloco;
+        }
+    }
+    while (lista->num_blocos_cadeia > blocos_necessarios) {
+        liberar_blocos(lista->blocos_cadeia[--lista->num_blocos_cadeia], 1);
+    }
+    memset(meta->extents, 0, sizeof(meta->extents));
+    if (lista->quantidade > 0) {
+        memcpy(meta->extents, lista->itens,
+               (lista->quantidade < BMPFS_EXTENTS_INLINE ? lista->quantidade : BMPFS_EXTENTS_INLINE) * sizeof(ExtentArquivo));
+    }
+    meta->num_extents = lista->quantidade;
+    meta->bloco_extents = blocos_necessarios ? lista->blocos_cadeia[0] : UINT32_MAX;
+    if (blocos_necessarios == 0) {
+        return 0;
+    }
+    char *buffer = obter_buffer_thread(BMPFS_BUFFER_BLOCOS);
+    if (!buffer) {
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < blocos_necessarios; i++) {
+        memset(buffer, 0, estado_sistema_bmpfs.tamanho_bloco);
+        CabecalhoBlocoExtents *cabecalho = (CabecalhoBlocoExtents *)buffer;
+        size_t primeiro = BMPFS_EXTENTS_INLINE + i * por_bloco;
+        size_t quantidade = lista->quantidade - primeiro < por_bloco ? lista->quantidade - primeiro : por_bloco;
+        cabecalho->proximo_bloco = i + 1 < blocos_necessarios ? lista->blocos_cadeia[i + 1] : UINT32_MAX;
+        cabecalho->quantidade = quantidade;
+        memcpy(buffer + sizeof(CabecalhoBlocoExtents), &lista->itens[primeiro], quantidade * sizeof(ExtentArquivo));
+        int resultado = escrever_blocos(lista->blocos_cadeia[i], 1, buffer);
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return 0;
+}
+
+static int carregar_extents(estado_bmpfs *estado, int idx) {
+    MetadadosArquivo *meta = &estado->arquivos[idx];
+    ListaExtents *lista = &estado->extents[idx];
+    size_t total_blocos = estado->superbloco.total_blocos;
+    if (meta->em_linha) {
+        return meta->num_extents == 0 && meta->num_blocos == 0 && meta->tamanho <= BMPFS_TAMANHO_INLINE ? 0 : -EIO;
+    }
+    size_t inline_usados = meta->num_extents < BMPFS_EXTENTS_INLINE ? meta->num_extents : BMPFS_EXTENTS_INLINE;
+    for (size_t i = 0; i < inline_usados; i++) {
+        if (adicionar_extent(lista, meta->extents[i].bloco_inicio, meta->extents[i].num_blocos,
+                             meta->extents[i].sinalizadores) < 0) {
+            return -ENOMEM;
+        }
+    }
+    if (meta->num_extents <= BMPFS_EXTENTS_INLINE) {
+        return 0;
+    }
+    char *buffer = obter_buffer_thread(BMPFS_BUFFER_BLOCOS);
+    if (!buffer) {
+        return -ENOMEM;
+    }
+    uint32_t bloco = meta->bloco_extents;
+    while (bloco != UINT32_MAX && lista->quantidade < meta->num_extents) {
+        if (bloco >= total_blocos || ler_blocos(bloco, 1, buffer) < 0) {
+            return -EIO;
+        }
+        uint32_t *cadeia = realloc(lista->blocos_cadeia, (lista->num_blocos_cadeia + 1) * sizeof(uint32_t));
+        if (!cadeia) {
+            return -ENOMEM;
+        }
+        lista->blocos_cadeia = cadeia;
+        lista->blocos_cadeia[lista->num_blocos_cadeia++] = bloco;
+        CabecalhoBlocoExtents *cabecalho = (CabecalhoBlocoExtents *)buffer;
+        ExtentArquivo *extents = (ExtentArquivo *)(buffer + sizeof(CabecalhoBlocoExtents));
+        for (uint32_t i = 0; i < cabecalho->quantidade && i < extents_por_bloco(); i++) {
+            if (reservar_extents(lista, 1) < 0) {
+                return -ENOMEM;
+            }
+            lista->itens[lista->quantidade++] = extents[i];
+        }
+        bloco = cabecalho->proximo_bloco;
+    }
+    if (lista->quantidade != meta->num_extents) {
+        registrar_erro("Lista de extents inconsistente para %s\n", meta->nome_arquivo);
+        return -EIO;
+    }
+    recalcular_inicios(lista, 0);
+    return 0;
+}
+
+static void descartar_extents(ListaExtents *lista) {
+    free(lista->itens);
+    free(lista->inicios);
+    free(lista->blocos_cadeia);
+    memset(lista, 0, sizeof(ListaExtents));
+}
+
+static uint32_t buscar_extent(const ListaExtents *lista, uint32_t bloco_logico) {
+    uint32_t inicio = 0;
+    uint32_t fim = lista->quantidade;
+    while (inicio < fim) {
+        uint32_t meio = inicio + (fim - inicio) / 2;
+        if ((uint64_t)lista->inicios[meio] + lista->itens[meio].num_blocos <= bloco_logico) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+    return inicio;
+}
+
+static int localizar_bloco(ListaExtents *lista, uint32_t bloco_logico, uint32_t *bloco_fisico, size_t *contiguos) {
+    uint32_t i = buscar_extent(lista, bloco_logico);
+    if (i == lista->quantidade) {
+        return -EIO;
+    }
+    uint32_t deslocamento = bloco_logico - lista->inicios[i];
+    *bloco_fisico = extent_sem_dados(&lista->itens[i]) ? BMPFS_BURACO : lista->itens[i].bloco_inicio + deslocamento;
+    *contiguos = lista->itens[i].num_blocos - deslocamento;
+    return 0;
+}
+
+static int localizar_bloco_reservado(ListaExtents *lista, uint32_t bloco_logico, uint32_t *bloco_fisico,
+                                     size_t *contiguos) {
+    uint32_t i = buscar_extent(lista, bloco_logico);
+    if (i == lista->quantidade || lista->itens[i].bloco_inicio == BMPFS_BURACO) {
+        return -EIO;
+    }
+    uint32_t deslocamento = bloco_logico - lista->inicios[i];
+    *bloco_fisico = lista->itens[i].bloco_inicio + deslocamento;
+    *contiguos = lista->itens[i].num_blocos - deslocamento;
+    return 0;
+}
+
+static int ler_blocos_arquivo(int idx, uint32_t bloco_logico, size_t num_blocos, char *buffer) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    while (num_blocos > 0) {
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        if (localizar_bloco(lista, bloco_logico, &bloco_fisico, &contiguos) < 0) {
+            return -EIO;
+        }
+        size_t quantidade = contiguos < num_blocos ? contiguos : num_blocos;
+        if (bloco_fisico == BMPFS_BURACO) {
+            memset(buffer, 0, quantidade * estado_sistema_bmpfs.tamanho_bloco);
+        } else {
+            int resultado = ler_blocos(bloco_fisico, quantidade, buffer);
+            if (resultado < 0) {
+                return resultado;
+            }
+        }
+        buffer += quantidade * estado_sistema_bmpfs.tamanho_bloco;
+        bloco_logico += quantidade;
+        num_blocos -= quantidade;
+    }
+    return 0;
+}
+
+static int ler_intervalo(int idx, uint64_t offset, size_t tamanho, char *buf) {
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    char *bloco_temp = NULL;
+    size_t copiados = 0;
+    while (copiados < tamanho) {
+        uint64_t posicao = offset + copiados;
+        uint32_t bloco_logico = posicao / tamanho_bloco;
+        size_t dentro_bloco = posicao % tamanho_bloco;
+        int resultado;
+        if (dentro_bloco != 0 || tamanho - copiados < tamanho_bloco) {
+            if (!bloco_temp && !(bloco_temp = obter_buffer_thread(BMPFS_BUFFER_BLOCOS))) {
+                return -ENOMEM;
+            }
+            resultado = ler_blocos_arquivo(idx, bloco_logico, 1, bloco_temp);
+            size_t quantidade = tamanho_bloco - dentro_bloco;
+            if (quantidade > tamanho - copiados) {
+                quantidade = tamanho - copiados;
+            }
+            if (resultado == 0) {
+                memcpy(buf + copiados, bloco_temp + dentro_bloco, quantidade);
+            }
+            copiados += quantidade;
+        } else {
+            size_t num_blocos = (tamanho - copiados) / tamanho_bloco;
+            resultado = ler_blocos_arquivo(idx, bloco_logico, num_blocos, buf + copiados);
+            copiados += num_blocos * tamanho_bloco;
+        }
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return 0;
+}
+
+static int ler_arquivo_mapeado(int idx, uint64_t offset, size_t tamanho, char *buf) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    size_t copiados = 0;
+    while (copiados < tamanho) {
+        uint64_t posicao = offset + copiados;
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        if (localizar_bloco(lista, posicao / tamanho_bloco, &bloco_fisico, &contiguos) < 0) {
+            return -EIO;
+        }
+        size_t dentro_bloco = posicao % tamanho_bloco;
+        size_t quantidade = contiguos * tamanho_bloco - dentro_bloco;
+        if (quantidade > tamanho - copiados) {
+            quantidade = tamanho - copiados;
+        }
+        if (bloco_fisico == BMPFS_BURACO) {
+            memset(buf + copiados, 0, quantidade);
+        } else {
+            int resultado = acessar_mapeamento(offset_bloco(bloco_fisico) + dentro_bloco, buf + copiados, quantidade, 0);
+            if (resultado < 0) {
+                return resultado;
+            }
+        }
+        copiados += quantidade;
+    }
+    return 0;
+}
+
+static int montar_vetor_arquivo(int idx, uint64_t offset, size_t tamanho, int escrita, struct fuse_bufvec **vetor) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    struct fuse_bufvec *resultado_vetor = malloc(sizeof(struct fuse_bufvec) + lista->quantidade * sizeof(struct fuse_buf));
+    if (!resultado_vetor) {
+        return -ENOMEM;
+    }
+    resultado_vetor->count = 0;
+    resultado_vetor->idx = 0;
+    resultado_vetor->off = 0;
+    size_t percorridos = 0;
+    while (percorridos < tamanho) {
+        uint64_t posicao = offset + percorridos;
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        int localizado = escrita ? localizar_bloco_reservado(lista, posicao / tamanho_bloco, &bloco_fisico, &contiguos)
+                                 : localizar_bloco(lista, posicao / tamanho_bloco, &bloco_fisico, &contiguos);
+        if (localizado < 0 || bloco_fisico == BMPFS_BURACO) {
+            free(resultado_vetor);
+            return -EIO;
+        }
+        size_t dentro_bloco = posicao % tamanho_bloco;
+        size_t quantidade = contiguos * tamanho_bloco - dentro_bloco;
+        if (quantidade > tamanho - percorridos) {
+            quantidade = tamanho - percorridos;
+        }
+        size_t num_blocos = (dentro_bloco + quantidade + tamanho_bloco - 1) / tamanho_bloco;
+        if (escrita) {
+            cache_blocos_invalidar(&estado_sistema_bmpfs.cache_blocos, bloco_fisico, num_blocos);
+        } else if (cache_blocos_descarregar_intervalo(&estado_sistema_bmpfs.cache_blocos, bloco_fisico, num_blocos) < 0) {
+            free(resultado_vetor);
+            return -EIO;
+        }
+        struct fuse_buf *segmento = &resultado_vetor->buf[resultado_vetor->count++];
+        memset(segmento, 0, sizeof(struct fuse_buf));
+        segmento->size = quantidade;
+        segmento->flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+        segmento->fd = estado_sistema_bmpfs.descritor_bmp;
+        segmento->pos = offset_bloco(bloco_fisico) + dentro_bloco;
+        percorridos += quantidade;
+    }
+    *vetor = resultado_vetor;
+    return 0;
+}
+
+static int intervalo_tem_buracos(ListaExtents *lista, uint32_t bloco_logico, size_t num_blocos) {
+    while (num_blocos > 0) {
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        if (localizar_bloco(lista, bloco_logico, &bloco_fisico, &contiguos) < 0 || bloco_fisico == BMPFS_BURACO) {
+            return 1;
+        }
+        size_t quantidade = contiguos < num_blocos ? contiguos : num_blocos;
+        bloco_logico += quantidade;
+        num_blocos -= quantidade;
+    }
+    return 0;
+}
+
+static void compactar_extents(ListaExtents *lista) {
+    uint32_t destino = 0;
+    for (uint32_t i = 0; i < lista->quantidade; i++) {
+        if (lista->itens[i].num_blocos == 0) {
+            continue;
+        }
+        if (destino > 0 &&
+            extents_continuos(&lista->itens[destino - 1], lista->itens[i].bloco_inicio, lista->itens[i].sinalizadores)) {
+            lista->itens[destino - 1].num_blocos += lista->itens[i].num_blocos;
+        } else {
+            lista->itens[destino++] = lista->itens[i];
+        }
+    }
+    lista->quantidade = destino;
+    recalcular_inicios(lista, 0);
+}
+
+static int substituir_trecho(ListaExtents *lista, uint32_t posicao, uint32_t deslocamento, uint32_t quantidade,
+                             uint32_t bloco_inicio, uint32_t sinalizadores) {
+    if (reservar_extents(lista, 2) < 0) {
+        return -ENOMEM;
+    }
+    ExtentArquivo *extent = &lista->itens[posicao];
+    ExtentArquivo original = *extent;
+    memmove(extent + 3, extent + 1, (lista->quantidade - posicao - 1) * sizeof(ExtentArquivo));
+    extent[0].num_blocos = deslocamento;
+    extent[1].bloco_inicio = bloco_inicio;
+    extent[1].num_blocos = quantidade;
+    extent[1].sinalizadores = bloco_inicio == BMPFS_BURACO ? 0 : sinalizadores;
+    extent[2] = original;
+    extent[2].num_blocos = original.num_blocos - deslocamento - quantidade;
+    if (original.bloco_inicio != BMPFS_BURACO) {
+        extent[2].bloco_inicio = original.bloco_inicio + deslocamento + quantidade;
+    }
+    lista->quantidade += 2;
+    compactar_extents(lista);
+    return 0;
+}
+
+static int preencher_buraco(ListaExtents *lista, uint32_t posicao, uint32_t deslocamento, size_t desejados,
+                            uint32_t sinalizadores) {
+    ExtentArquivo *anterior = posicao > 0 ? &lista->itens[posicao - 1] : NULL;
+    if (deslocamento == 0 && anterior && anterior->bloco_inicio != BMPFS_BURACO &&
+        anterior->sinalizadores == sinalizadores) {
+        size_t estendidos = estender_extent(anterior, desejados);
+        if (estendidos > 0) {
+            lista->itens[posicao].num_blocos -= estendidos;
+            compactar_extents(lista);
+            return 0;
+        }
+    }
+    size_t obtidos;
+    uint32_t bloco_inicio = alocar_extent(desejados, &obtidos);
+    if (bloco_inicio == UINT32_MAX) {
+        registrar_aviso("Nenhum bloco livre disponível\n");
+        return -ENOSPC;
+    }
+    if (substituir_trecho(lista, posicao, deslocamento, obtidos, bloco_inicio, sinalizadores) < 0) {
+        liberar_blocos(bloco_inicio, obtidos);
+        return -ENOMEM;
+    }
+    registrar_debug("Blocos alocados a partir de: %u (%zu blocos)\n", bloco_inicio, obtidos);
+    return 0;
+}
+
+static int preencher_intervalo(int idx, uint32_t bloco_logico, size_t num_blocos, uint32_t sinalizadores) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    uint32_t i = buscar_extent(lista, bloco_logico);
+    uint32_t inicio = i < lista->quantidade ? lista->inicios[i] : 0;
+    int alterado = 0;
+    int resultado = 0;
+    while (num_blocos > 0 && i < lista->quantidade) {
+        ExtentArquivo *extent = &lista->itens[i];
+        if (bloco_logico >= inicio + extent->num_blocos) {
+            inicio += extent->num_blocos;
+            i++;
+            continue;
+        }
+        uint32_t deslocamento = bloco_logico - inicio;
+        size_t quantidade = extent->num_blocos - deslocamento;
+        if (quantidade > num_blocos) {
+            quantidade = num_blocos;
+        }
+        if (extent->bloco_inicio == BMPFS_BURACO) {
+            resultado = preencher_buraco(lista, i, deslocamento, quantidade, sinalizadores);
+        } else if ((extent->sinalizadores & BMPFS_EXTENT_NAO_ESCRITO) && !(sinalizadores & BMPFS_EXTENT_NAO_ESCRITO)) {
+            resultado = substituir_trecho(lista, i, deslocamento, quantidade, extent->bloco_inicio + deslocamento,
+                                          sinalizadores);
+        } else {
+            bloco_logico += quantidade;
+            num_blocos -= quantidade;
+            continue;
+        }
+        if (resultado < 0) {
+            break;
+        }
+        alterado = 1;
+        i = buscar_extent(lista, bloco_logico);
+        inicio = i < lista->quantidade ? lista->inicios[i] : 0;
+    }
+    if (alterado) {
+        int resultado_gravacao = gravar_extents(idx);
+        if (resultado == 0) {
+            resultado = resultado_gravacao;
+        }
+    }
+    return resultado;
+}
+
+static int perfurar_intervalo(int idx, uint32_t bloco_logico, size_t num_blocos) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    uint32_t i = buscar_extent(lista, bloco_logico);
+    uint32_t inicio = i < lista->quantidade ? lista->inicios[i] : 0;
+    int alterado = 0;
+    int resultado = 0;
+    while (num_blocos > 0 && i < lista->quantidade) {
+        ExtentArquivo *extent = &lista->itens[i];
+        if (bloco_logico >= inicio + extent->num_blocos) {
+            inicio += extent->num_blocos;
+            i++;
+            continue;
+        }
+        uint32_t deslocamento = bloco_logico - inicio;
+        size_t quantidade = extent->num_blocos - deslocamento;
+        if (quantidade > num_blocos) {
+            quantidade = num_blocos;
+        }
+        if (extent->bloco_inicio == BMPFS_BURACO) {
+            bloco_logico += quantidade;
+            num_blocos -= quantidade;
+            continue;
+        }
+        uint32_t bloco_fisico = extent->bloco_inicio + deslocamento;
+        resultado = substituir_trecho(lista, i, deslocamento, quantidade, BMPFS_BURACO, 0);
+        if (resultado < 0) {
+            break;
+        }
+        liberar_blocos(bloco_fisico, quantidade);
+        alterado = 1;
+        i = buscar_extent(lista, bloco_logico);
+        inicio = i < lista->quantidade ? lista->inicios[i] : 0;
+    }
+    if (alterado) {
+        int resultado_gravacao = gravar_extents(idx);
+        if (resultado == 0) {
+            resultado = resultado_gravacao;
+        }
+    }
+    return resultado;
+}
+
+static int escrever_blocos_arquivo(int idx, uint32_t bloco_logico, size_t num_blocos, const char *buffer) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    int resultado_preenchimento = preencher_intervalo(idx, bloco_logico, num_blocos, 0);
+    if (resultado_preenchimento < 0) {
+        return resultado_preenchimento;
+    }
+    while (num_blocos > 0) {
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        if (localizar_bloco(lista, bloco_logico, &bloco_fisico, &contiguos) < 0) {
+            return -EIO;
+        }
+        size_t quantidade = contiguos < num_blocos ? contiguos : num_blocos;
+        int resultado = escrever_blocos(bloco_fisico, quantidade, buffer);
+        if (resultado < 0) {
+            return resultado;
+        }
+        buffer += quantidade * estado_sistema_bmpfs.tamanho_bloco;
+        bloco_logico += quantidade;
+        num_blocos -= quantidade;
+    }
+    return 0;
+}
+
+static int encolher_arquivo(int idx, size_t novos_blocos) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    while (meta->num_blocos > novos_blocos && lista->quantidade > 0) {
+        ExtentArquivo *ultimo = &lista->itens[lista->quantidade - 1];
+        size_t excesso = meta->num_blocos - novos_blocos;
+        int buraco = ultimo->bloco_inicio == BMPFS_BURACO;
+        if (ultimo->num_blocos <= excesso) {
+            if (!buraco) {
+                liberar_blocos(ultimo->bloco_inicio, ultimo->num_blocos);
+            }
+            meta->num_blocos -= ultimo->num_blocos;
+            lista->quantidade--;
+        } else {
+            if (!buraco) {
+                liberar_blocos(ultimo->bloco_inicio + ultimo->num_blocos - excesso, excesso);
+            }
+            ultimo->num_blocos -= excesso;
+            meta->num_blocos -= excesso;
+        }
+    }
+    return gravar_extents(idx);
+}
+
+static int crescer_arquivo(int idx, size_t novos_blocos, uint32_t sinalizadores) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    size_t blocos_originais = meta->num_blocos;
+    size_t faltam = novos_blocos - meta->num_blocos;
+    ExtentArquivo *ultimo = lista->quantidade > 0 ? &lista->itens[lista->quantidade - 1] : NULL;
+    if (ultimo && ultimo->bloco_inicio != BMPFS_BURACO && ultimo->sinalizadores == sinalizadores) {
+        size_t obtidos = estender_extent(ultimo, faltam);
+        meta->num_blocos += obtidos;
+        faltam -= obtidos;
+    }
+    while (faltam > 0) {
+        size_t obtidos;
+        uint32_t bloco_inicio = alocar_extent(faltam, &obtidos);
+        if (bloco_inicio == UINT32_MAX) {
+            registrar_aviso("Nenhum bloco livre disponível\n");
+            encolher_arquivo(idx, blocos_originais);
+            return -ENOSPC;
+        }
+        if (adicionar_extent(lista, bloco_inicio, obtidos, sinalizadores) < 0) {
+            liberar_blocos(bloco_inicio, obtidos);
+            encolher_arquivo(idx, blocos_originais);
+            return -ENOMEM;
+        }
+        registrar_debug("Blocos alocados a partir de: %u (%zu blocos)\n", bloco_inicio, obtidos);
+        meta->num_blocos += obtidos;
+        faltam -= obtidos;
+    }
+    int resultado = gravar_extents(idx);
+    if (resultado < 0) {
+        encolher_arquivo(idx, blocos_originais);
+    }
+    return resultado;
+}
+
+static int crescer_esparso(int idx, size_t novos_blocos) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t blocos_originais = meta->num_blocos;
+    if (adicionar_extent(&estado_sistema_bmpfs.extents[idx], BMPFS_BURACO, novos_blocos - meta->num_blocos, 0) < 0) {
+        return -ENOMEM;
+    }
+    meta->num_blocos = novos_blocos;
+    int resultado = gravar_extents(idx);
+    if (resultado < 0) {
+        encolher_arquivo(idx, blocos_originais);
+    }
+    return resultado;
+}
+
+static int escrever_bloco_parcial(int idx, uint32_t bloco_logico, size_t dentro_bloco, const char *buf,
+                                  size_t quantidade, size_t tamanho_antigo) {
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    uint64_t inicio_bloco = (uint64_t)bloco_logico * tamanho_bloco;
+    uint32_t bloco_fisico;
+    size_t contiguos;
+    int buraco = localizar_bloco(&estado_sistema_bmpfs.extents[idx], bloco_logico, &bloco_fisico, &contiguos) == 0 &&
+                 bloco_fisico == BMPFS_BURACO;
+    if (buraco) {
+        int resultado_preenchimento = preencher_intervalo(idx, bloco_logico, 1, 0);
+        if (resultado_preenchimento < 0) {
+            return resultado_preenchimento;
+        }
+    }
+    char *bloco_temp = obter_buffer_thread(BMPFS_BUFFER_BLOCOS);
+    if (!bloco_temp) {
+        return -ENOMEM;
+    }
+    if (!buraco && inicio_bloco < tamanho_antigo) {
+        int resultado_leitura = ler_blocos_arquivo(idx, bloco_logico, 1, bloco_temp);
+        if (resultado_leitura < 0) {
+            registrar_erro("Falha ao ler bloco para escrita parcial: %d\n", resultado_leitura);
+            return resultado_leitura;
+        }
+        if (tamanho_antigo - inicio_bloco < tamanho_bloco) {
+            size_t validos = tamanho_antigo - inicio_bloco;
+            memset(bloco_temp + validos, 0, tamanho_bloco - validos);
+        }
+    } else {
+        memset(bloco_temp, 0, tamanho_bloco);
+    }
+    if (buf) {
+        memcpy(bloco_temp + dentro_bloco, buf, quantidade);
+    } else {
+        memset(bloco_temp + dentro_bloco, 0, quantidade);
+    }
+    return escrever_blocos_arquivo(idx, bloco_logico, 1, bloco_temp);
+}
+
+static int zerar_cauda_arquivo(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    uint32_t bloco_logico = meta->tamanho / tamanho_bloco;
+    size_t dentro_bloco = meta->tamanho % tamanho_bloco;
+    uint32_t bloco_fisico;
+    size_t contiguos;
+    if (meta->em_linha || dentro_bloco == 0 ||
+        localizar_bloco(&estado_sistema_bmpfs.extents[idx], bloco_logico, &bloco_fisico, &contiguos) < 0 ||
+        bloco_fisico == BMPFS_BURACO) {
+        return 0;
+    }
+    return escrever_bloco_parcial(idx, bloco_logico, dentro_bloco, NULL, 0, meta->tamanho);
+}
+
+static int zerar_trecho_arquivo(int idx, uint64_t inicio, uint64_t fim) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    if (fim > meta->tamanho) {
+        fim = meta->tamanho;
+    }
+    while (inicio < fim) {
+        uint32_t bloco_logico = inicio / tamanho_bloco;
+        size_t dentro_bloco = inicio % tamanho_bloco;
+        size_t quantidade = tamanho_bloco - dentro_bloco < fim - inicio ? tamanho_bloco - dentro_bloco : fim - inicio;
+        uint32_t bloco_fisico;
+        size_t contiguos;
+        if (localizar_bloco(&estado_sistema_bmpfs.extents[idx], bloco_logico, &bloco_fisico, &contiguos) == 0 &&
+            bloco_fisico != BMPFS_BURACO) {
+            int resultado = escrever_bloco_parcial(idx, bloco_logico, dentro_bloco, NULL, quantidade, meta->tamanho);
+            if (resultado < 0) {
+                return resultado;
+            }
+        }
+        inicio += quantidade;
+    }
+    return 0;
+}
+
+static int materializar_inline(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    char dados[BMPFS_TAMANHO_INLINE];
+    memcpy(dados, meta->dados_inline, sizeof(dados));
+    memset(meta->dados_inline, 0, sizeof(meta->dados_inline));
+    meta->em_linha = 0;
+    int resultado = 0;
+    if (meta->tamanho > 0) {
+        resultado = crescer_arquivo(idx, 1, 0);
+        if (resultado == 0) {
+            resultado = escrever_bloco_parcial(idx, 0, 0, dados, meta->tamanho, 0);
+        }
+        if (resultado < 0) {
+            encolher_arquivo(idx, 0);
+            memcpy(meta->dados_inline, dados, sizeof(dados));
+            meta->em_linha = 1;
+            registrar_erro("Falha ao mover dados em linha de %s para blocos: %d\n", meta->nome_arquivo, resultado);
+        }
+    }
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    return resultado;
+}
+
+static int escrever_intervalo(int idx, const char *buf, size_t tamanho, off_t offset) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    size_t novo_tamanho = (size_t)offset + tamanho;
+    if (meta->em_linha && novo_tamanho <= BMPFS_TAMANHO_INLINE) {
+        memcpy(meta->dados_inline + offset, buf, tamanho);
+        if (novo_tamanho > meta->tamanho) {
+            meta->tamanho = novo_tamanho;
+        }
+        meta->modificado = time(NULL);
+        marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+        return 0;
+    }
+    if (meta->em_linha) {
+        int resultado_conversao = materializar_inline(idx);
+        if (resultado_conversao < 0) {
+            return resultado_conversao;
+        }
+    }
+    size_t tamanho_antigo = meta->tamanho;
+    size_t primeiro_bloco = (size_t)offset / tamanho_bloco;
+    size_t novos_blocos = (novo_tamanho + tamanho_bloco - 1) / tamanho_bloco;
+    registrar_debug("Blocos necessários: %zu (atual: %u)\n", novos_blocos, meta->num_blocos);
+    if (primeiro_bloco > tamanho_antigo / tamanho_bloco) {
+        int resultado_cauda = zerar_cauda_arquivo(idx);
+        if (resultado_cauda < 0) {
+            return resultado_cauda;
+        }
+    }
+    if (primeiro_bloco > meta->num_blocos) {
+        int resultado_buraco = crescer_esparso(idx, primeiro_bloco);
+        if (resultado_buraco < 0) {
+            return resultado_buraco;
+        }
+    }
+    if (novos_blocos > meta->num_blocos) {
+        int resultado_crescimento = crescer_arquivo(idx, novos_blocos, 0);
+        if (resultado_crescimento < 0) {
+            return resultado_crescimento;
+        }
+    }
+    size_t escritos = 0;
+    while (escritos < tamanho) {
+        uint64_t posicao = (uint64_t)offset + escritos;
+        uint32_t bloco_logico = posicao / tamanho_bloco;
+        size_t dentro_bloco = posicao % tamanho_bloco;
+        int resultado;
+        if (dentro_bloco != 0 || tamanho - escritos < tamanho_bloco) {
+            size_t quantidade = tamanho_bloco - dentro_bloco;
+            if (quantidade > tamanho - escritos) {
+                quantidade = tamanho - escritos;
+            }
+            resultado = escrever_bloco_parcial(idx, bloco_logico, dentro_bloco, buf + escritos, quantidade, tamanho_antigo);
+            escritos += quantidade;
+        } else {
+            size_t num_blocos = (tamanho - escritos) / tamanho_bloco;
+            resultado = escrever_blocos_arquivo(idx, bloco_logico, num_blocos, buf + escritos);
+            escritos += num_blocos * tamanho_bloco;
+        }
+        if (resultado < 0) {
+            registrar_erro("Falha ao escrever blocos: %d\n", resultado);
+            return resultado;
+        }
+    }
+    if (novo_tamanho > meta->tamanho) {
+        meta->tamanho = novo_tamanho;
+    }
+    meta->modificado = time(NULL);
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    return 0;
+}
+
+static int acumular_buffer_escrita(BufferEscrita *buffer, const char *buf, size_t tamanho, off_t offset) {
+    if (buffer->tamanho == 0) {
+        buffer->offset = offset;
+    }
+    if (buffer->tamanho + tamanho > buffer->capacidade) {
+        size_t capacidade = buffer->capacidade ? buffer->capacidade : 64 * 1024;
+        while (capacidade < buffer->tamanho + tamanho) {
+            capacidade *= 2;
+        }
+        char *dados = realloc(buffer->dados, capacidade);
+        if (!dados) {
+            return -ENOMEM;
+        }
+        buffer->dados = dados;
+        buffer->capacidade = capacidade;
+    }
+    memcpy(buffer->dados + buffer->tamanho, buf, tamanho);
+    buffer->tamanho += tamanho;
+    return 0;
+}
+
+static int descarregar_buffer_escrita(int idx) {
+    BufferEscrita *buffer = &estado_sistema_bmpfs.buffers_escrita[idx];
+    if (buffer->tamanho == 0) {
+        return 0;
+    }
+    int resultado = escrever_intervalo(idx, buffer->dados, buffer->tamanho, buffer->offset);
+    estatisticas_contar(ESTATISTICAS_DESCARGAS_BUFFER, 1);
+    if (resultado < 0) {
+        registrar_erro("Falha ao descarregar %zu bytes do buffer de escrita: %d\n", buffer->tamanho, resultado);
+    }
+    buffer->tamanho = 0;
+    return resultado;
+}
+
+static void liberar_buffer_escrita(int idx) {
+    BufferEscrita *buffer = &estado_sistema_bmpfs.buffers_escrita[idx];
+    free(buffer->dados);
+    memset(buffer, 0, sizeof(BufferEscrita));
+}
+
+static int descarregar_travado(int idx, int liberar) {
+    if (idx < 0) {
+        return idx;
+    }
+    int pendente = estado_sistema_bmpfs.buffers_escrita[idx].tamanho > 0;
+    int resultado = descarregar_buffer_escrita(idx);
+    if (liberar) {
+        liberar_buffer_escrita(idx);
+    }
+    destravar_arquivo(idx);
+    if (pendente && agendar_metadados(&estado_sistema_bmpfs) < 0 && resultado == 0) {
+        resultado = -EIO;
+    }
+    return resultado;
+}
+
+static int descarregar_arquivo(const char *caminho, int liberar) {
+    return descarregar_travado(travar_arquivo_por_caminho(caminho, 1), liberar);
+}
+
+static int descarregar_indice(uint64_t slot, int liberar) {
+    return descarregar_travado(travar_arquivo_por_indice(slot, 1), liberar);
+}
+
+static int travar_arquivo_descarregado(const char *caminho) {
+    int idx = travar_arquivo_por_caminho(caminho, 0);
+    if (idx < 0 || estado_sistema_bmpfs.buffers_escrita[idx].tamanho == 0) {
+        return idx;
+    }
+    destravar_arquivo(idx);
+    int resultado = descarregar_arquivo(caminho, 0);
+    if (resultado < 0) {
+        return resultado;
+    }
+    return travar_arquivo_por_caminho(caminho, 0);
+}
+
+static int travar_indice_descarregado(uint64_t slot) {
+    int idx = travar_arquivo_por_indice(slot, 0);
+    if (idx < 0 || estado_sistema_bmpfs.buffers_escrita[idx].tamanho == 0) {
+        return idx;
+    }
+    destravar_arquivo(idx);
+    int resultado = descarregar_indice(slot, 0);
+    if (resultado < 0) {
+        return resultado;
+    }
+    return travar_arquivo_por_indice(slot, 0);
+}
+
+static size_t blocos_alocados(int idx) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    size_t total = lista->num_blocos_cadeia;
+    for (uint32_t i = 0; i < lista->quantidade; i++) {
+        if (lista->itens[i].bloco_inicio != BMPFS_BURACO) {
+            total += lista->itens[i].num_blocos;
+        }
+    }
+    return total;
+}
+
+static void coletar_espaco_livre(estado_bmpfs *estado, MetricasEspacoLivre *metricas) {
+    pthread_mutex_lock(&estado->trava_alocador);
+    metricas->blocos_livres = estado->indice_livre.blocos_livres;
+    metricas->extents_livres = estado->indice_livre.num_extents;
+    metricas->maior_livre = indice_livre_maior(&estado->indice_livre);
+    indice_livre_histograma(&estado->indice_livre, metricas->histograma, BMPFS_FAIXAS_HISTOGRAMA_LIVRE);
+    metricas->buscas = estado->indice_livre.buscas;
+    metricas->passos_busca = estado->indice_livre.passos_busca;
+    metricas->maior_busca = estado->indice_livre.maior_busca;
+    pthread_mutex_unlock(&estado->trava_alocador);
+}
+
+static int eh_arquivo_estatisticas(const char *caminho) {
+    return caminho && strcmp(caminho, BMPFS_ARQUIVO_ESTATISTICAS) == 0;
+}
+
+static int eh_caminho_virtual(const char *caminho) {
+    return caminho && (strcmp(caminho, BMPFS_DIRETORIO_VIRTUAL) == 0 || eh_arquivo_estatisticas(caminho));
+}
+
+static int gerar_estatisticas(InstantaneoEstatisticas *instantaneo) {
+    estado_bmpfs *estado = &estado_sistema_bmpfs;
+    Estatisticas *total = malloc(sizeof(Estatisticas));
+    FILE *saida = total ? open_memstream(&instantaneo->dados, &instantaneo->tamanho) : NULL;
+    if (!saida) {
+        free(total);
+        return -ENOMEM;
+    }
+    estatisticas_coletar(total);
+    MetricasEspacoLivre livre;
+    coletar_espaco_livre(estado, &livre);
+    uint64_t acertos, falhas;
+    cache_blocos_contadores(&estado->cache_blocos, &acertos, &falhas);
+    uint64_t submissoes, operacoes;
+    fila_io_contadores(&estado->fila_io, &submissoes, &operacoes);
+    fprintf(saida, "{\n");
+    estatisticas_escrever_json(saida, total);
+    fprintf(saida, ",\n  \"cache\": {\"acertos\": %llu, \"falhas\": %llu},\n", (unsigned long long)acertos,
+            (unsigned long long)falhas);
+    fprintf(saida, "  \"io\": {\"assincrona\": %s, \"submissoes\": %llu, \"operacoes\": %llu},\n",
+            fila_io_assincrona(&estado->fila_io) ? "true" : "false", (unsigned long long)submissoes,
+            (unsigned long long)operacoes);
+    fprintf(saida,
+            "  \"alocador\": {\"buscas\": %llu, \"passos_busca\": %llu, \"maior_busca\": %llu, "
+            "\"blocos_livres\": %zu, \"extents_livres\": %zu, \"maior_livre\": %zu, \"histograma_livre\": [",
+            (unsigned long long)livre.buscas, (unsigned long long)livre.passos_busca,
+            (unsigned long long)livre.maior_busca, livre.blocos_livres, livre.extents_livres, livre.maior_livre);
+    int primeira = 1;
+    for (size_t faixa = 0; faixa < BMPFS_FAIXAS_HISTOGRAMA_LIVRE; faixa++) {
+        if (livre.histograma[faixa]) {
+            fprintf(saida, "%s[%zu, %zu]", primeira ? "" : ", ", (size_t)1 << faixa, livre.histograma[faixa]);
+            primeira = 0;
+        }
+    }
+    fprintf(saida, "]},\n");
+    fprintf(saida,
+            "  \"desfragmentacao\": {\"ativa\": %s, \"ciclos\": %llu, \"arquivos_migrados\": %llu, "
+            "\"blocos_migrados\": %llu, \"falhas\": %llu},\n",
+            estado->desfragmentador_ativo ? "true" : "false",
+            (unsigned long long)__atomic_load_n(&estado->desfragmentacao.ciclos, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&estado->desfragmentacao.arquivos_migrados, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&estado->desfragmentacao.blocos_migrados, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&estado->desfragmentacao.falhas, __ATOMIC_RELAXED));
+    fprintf(saida, "  \"arquivos\": {\"entradas\": %zu, \"capacidade\": %zu}\n}\n",
+            __atomic_load_n(&estado->max_arquivos, __ATOMIC_ACQUIRE), estado->capacidade_inodes);
+    int resultado = fclose(saida) == 0 ? 0 : -ENOMEM;
+    free(total);
+    if (resultado < 0) {
+        free(instantaneo->dados);
+        instantaneo->dados = NULL;
+    }
+    return resultado;
+}
+
+static int ler_estatisticas(char *buf, size_t tamanho, off_t offset, struct fuse_file_info *fi) {
+    InstantaneoEstatisticas temporario = {NULL, 0};
+    InstantaneoEstatisticas *instantaneo = fi ? (InstantaneoEstatisticas *)(uintptr_t)fi->fh : NULL;
+    if (!instantaneo) {
+        int resultado = gerar_estatisticas(&temporario);
+        if (resultado < 0) {
+            return resultado;
+        }
+        instantaneo = &temporario;
+    }
+    size_t lidos = 0;
+    if ((size_t)offset < instantaneo->tamanho) {
+        lidos = instantaneo->tamanho - offset < tamanho ? instantaneo->tamanho - offset : tamanho;
+        memcpy(buf, instantaneo->dados + offset, lidos);
+    }
+    free(temporario.dados);
+    return (int)lidos;
+}
+
+static int abrir_estatisticas(struct fuse_file_info *fi) {
+    if ((fi->flags & O_ACCMODE) != O_RDONLY) {
+        return -EACCES;
+    }
+    InstantaneoEstatisticas *instantaneo = calloc(1, sizeof(InstantaneoEstatisticas));
+    if (!instantaneo) {
+        return -ENOMEM;
+    }
+    int resultado = gerar_estatisticas(instantaneo);
+    if (resultado < 0) {
+        free(instantaneo);
+        return resultado;
+    }
+    fi->fh = (uint64_t)(uintptr_t)instantaneo;
+    fi->direct_io = 1;
+    return 0;
+}
+
+static void fechar_estatisticas(struct fuse_file_info *fi) {
+    InstantaneoEstatisticas *instantaneo = (InstantaneoEstatisticas *)(uintptr_t)fi->fh;
+    if (instantaneo) {
+        free(instantaneo->dados);
+        free(instantaneo);
+        fi->fh = 0;
+    }
+}
+
+static fuse_ino_t no_do_slot(uint32_t slot) {
+    return slot == BMPFS_PAI_RAIZ ? FUSE_ROOT_ID : (fuse_ino_t)slot + 2;
+}
+
+static void preencher_atributos_sinteticos(struct stat *stbuf, fuse_ino_t no) {
+    memset(stbuf, 0, sizeof(struct stat));
+    stbuf->st_ino = no;
+    if (no == FUSE_ROOT_ID) {
+        stbuf->st_mode = S_IFDIR | 0755;
+        stbuf->st_nlink = 2 + __atomic_load_n(&estado_sistema_bmpfs.diretorio_raiz.subdiretorios, __ATOMIC_RELAXED);
+    } else {
+        stbuf->st_mode = no == BMPFS_NO_ESTATISTICAS ? S_IFREG | 0444 : S_IFDIR | 0555;
+        stbuf->st_nlink = no == BMPFS_NO_ESTATISTICAS ? 1 : 2;
+    }
+    stbuf->st_uid = getuid();
+    stbuf->st_gid = getgid();
+    stbuf->st_atime = time(NULL);
+    stbuf->st_mtime = stbuf->st_atime;
+    stbuf->st_ctime = stbuf->st_atime;
+}
+
+static void preencher_atributos(int idx, struct stat *stbuf) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    BufferEscrita *buffer = &estado_sistema_bmpfs.buffers_escrita[idx];
+    size_t tamanho = meta->tamanho;
+    if (buffer->tamanho > 0 && buffer->offset + buffer->tamanho > tamanho) {
+        tamanho = buffer->offset + buffer->tamanho;
+    }
+    memset(stbuf, 0, sizeof(struct stat));
+    stbuf->st_ino = no_do_slot(idx);
+    stbuf->st_mode = meta->modo;
+    if (meta->pai == BMPFS_PAI_ORFAO) {
+        stbuf->st_nlink = 0;
+    } else if (meta->eh_diretorio) {
+        stbuf->st_nlink = 2 + __atomic_load_n(&estado_sistema_bmpfs.diretorios[idx].subdiretorios, __ATOMIC_RELAXED);
+    } else {
+        stbuf->st_nlink = 1;
+    }
+    stbuf->st_size = tamanho;
+    stbuf->st_uid = meta->uid;
+    stbuf->st_gid = meta->gid;
+    stbuf->st_atime = meta->acessado;
+    stbuf->st_mtime = meta->modificado;
+    stbuf->st_ctime = meta->criado;
+    stbuf->st_blocks = blocos_alocados(idx) * (estado_sistema_bmpfs.tamanho_bloco / 512);
+    stbuf->st_blksize = estado_sistema_bmpfs.tamanho_bloco;
+}
+
+static int getattr_bmpfs(const char *caminho, struct stat *stbuf,
+                         struct fuse_file_info *fi) {
+    (void) fi;
+    if (strcmp(caminho, "/") == 0) {
+        preencher_atributos_sinteticos(stbuf, FUSE_ROOT_ID);
+        return 0;
+    }
+    if (eh_caminho_virtual(caminho)) {
+        preencher_atributos_sinteticos(stbuf, eh_arquivo_estatisticas(caminho) ? BMPFS_NO_ESTATISTICAS
+                                                                                 : BMPFS_NO_DIRETORIO_VIRTUAL);
+        return 0;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 0);
+    if (idx < 0) {
+        return idx;
+    }
+    preencher_atributos(idx, stbuf);
+    destravar_arquivo(idx);
+    return 0;
+}
+
+static void marcar_inode_livre(estado_bmpfs *estado, size_t idx) {
+    estado->inodes_livres[idx / 64] |= UINT64_C(1) << (idx % 64);
+    estado->num_inodes_livres++;
+    if (idx / 64 < estado->dica_inodes_livres) {
+        estado->dica_inodes_livres = idx / 64;
+    }
+}
+
+static int32_t tomar_inode_livre(estado_bmpfs *estado) {
+    size_t palavras = (estado->max_arquivos + 63) / 64;
+    for (size_t palavra = estado->dica_inodes_livres; palavra < palavras; palavra++) {
+        uint64_t bits = estado->inodes_livres[palavra];
+        if (bits) {
+            estado->inodes_livres[palavra] = bits & (bits - 1);
+            estado->num_inodes_livres--;
+            estado->dica_inodes_livres = palavra;
+            return (int32_t)(palavra * 64 + __builtin_ctzll(bits));
+        }
+    }
+    estado->dica_inodes_livres = palavras;
+    return -ENOSPC;
+}
+
+static int crescer_tabela_inodes(void) {
+    estado_bmpfs *estado = &estado_sistema_bmpfs;
+    SuperblocoBMPFS *superbloco = &estado->superbloco;
+    size_t atual = estado->max_arquivos;
+    size_t novo = atual + superbloco->entradas_por_grupo;
+    if (novo > estado->capacidade_inodes || superbloco->num_grupos_inodes >= BMPFS_MAX_GRUPOS_INODES) {
+        registrar_aviso("Tabela de arquivos atingiu a capacidade máxima de %zu entradas\n", atual);
+        return -ENOSPC;
+    }
+    if (ativar_vetor(estado->arquivos, novo, sizeof(MetadadosArquivo)) < 0 ||
+        ativar_vetor(estado->extents, novo, sizeof(ListaExtents)) < 0 ||
+        ativar_vetor(estado->travas_arquivos, novo, sizeof(pthread_rwlock_t)) < 0 ||
+        ativar_vetor(estado->buffers_escrita, novo, sizeof(BufferEscrita)) < 0 ||
+        ativar_vetor(estado->diretorios, novo, sizeof(ArvoreDiretorio)) < 0 ||
+        ativar_vetor(estado->consultas, novo, sizeof(uint64_t)) < 0) {
+        return -ENOMEM;
+    }
+    uint32_t blocos = formato_blocos_grupo_inodes(superbloco);
+    size_t obtidos;
+    uint32_t bloco = alocar_extent(blocos, &obtidos);
+    if (bloco == UINT32_MAX) {
+        return -ENOSPC;
+    }
+    if (obtidos < blocos) {
+        liberar_blocos(bloco, obtidos);
+        return -ENOSPC;
+    }
+    cache_blocos_invalidar(&estado->cache_blocos, bloco, blocos);
+    size_t tamanho_grupo = superbloco->entradas_por_grupo * sizeof(MetadadosArquivo);
+    char *zeros = calloc(1, tamanho_grupo);
+    if (!zeros) {
+        liberar_blocos(bloco, blocos);
+        return -ENOMEM;
+    }
+    __atomic_store_n(&estado->dados_pendentes, 1, __ATOMIC_RELEASE);
+    int resultado = escrever_posicional(estado->descritor_bmp, zeros, tamanho_grupo, offset_bloco(bloco));
+    free(zeros);
+    if (resultado < 0) {
+        liberar_blocos(bloco, blocos);
+        return -EIO;
+    }
+    for (size_t i = atual; i < novo; i++) {
+        pthread_rwlock_init(&estado->travas_arquivos[i], NULL);
+    }
+    pthread_mutex_lock(&estado->trava_alocador);
+    superbloco->grupos_inodes[superbloco->num_grupos_inodes++] = bloco;
+    pthread_mutex_unlock(&estado->trava_alocador);
+    __atomic_store_n(&estado->superbloco_sujo, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&estado->max_arquivos, novo, __ATOMIC_RELEASE);
+    for (size_t i = atual; i < novo; i++) {
+        marcar_inode_livre(estado, i);
+    }
+    registrar_info("Tabela de arquivos ampliada para %zu entradas (grupo nos blocos %u-%u)\n", novo, bloco,
+                   bloco + blocos - 1);
+    return 0;
+}
+
+static int reservar_slot_metadados(uint32_t pai, const char *nome) {
+    if (buscar_entrada(pai, nome) >= 0) {
+        return -EEXIST;
+    }
+    if (estado_sistema_bmpfs.num_inodes_livres == 0) {
+        int resultado = crescer_tabela_inodes();
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return tomar_inode_livre(&estado_sistema_bmpfs);
+}
+
+static void devolver_slot_metadados(int idx) {
+    marcar_inode_livre(&estado_sistema_bmpfs, idx);
+}
+
+static int ligar_slot_metadados(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    ArvoreDiretorio *diretorio = diretorio_do_slot(meta->pai);
+    if (arvore_diretorio_inserir(diretorio, (uint64_t)idx) < 0) {
+        return -ENOMEM;
+    }
+    if (indice_nomes_inserir(&estado_sistema_bmpfs.indice_nomes, hash_entrada(meta->pai, meta->nome_arquivo), idx) < 0) {
+        arvore_diretorio_remover(diretorio, (uint64_t)idx);
+        return -ENOMEM;
+    }
+    if (meta->eh_diretorio) {
+        __atomic_add_fetch(&diretorio->subdiretorios, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+static void desligar_slot_metadados(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    ArvoreDiretorio *diretorio = diretorio_do_slot(meta->pai);
+    indice_nomes_remover(&estado_sistema_bmpfs.indice_nomes, hash_entrada(meta->pai, meta->nome_arquivo), idx);
+    arvore_diretorio_remover(diretorio, (uint64_t)idx);
+    if (meta->eh_diretorio) {
+        __atomic_sub_fetch(&diretorio->subdiretorios, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int publicar_slot_metadados(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (ligar_slot_metadados(idx) < 0) {
+        memset(meta, 0, sizeof(MetadadosArquivo));
+        devolver_slot_metadados(idx);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+static void liberar_slot_orfao(int idx) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    liberar_buffer_escrita(idx);
+    if (!meta->em_linha) {
+        encolher_arquivo(idx, 0);
+    }
+    descartar_extents(&estado_sistema_bmpfs.extents[idx]);
+    if (meta->eh_diretorio) {
+        arvore_diretorio_destruir(&estado_sistema_bmpfs.diretorios[idx]);
+    }
+    memset(meta, 0, sizeof(MetadadosArquivo));
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    devolver_slot_metadados(idx);
+}
+
+static void descartar_slot_metadados(int idx) {
+    desligar_slot_metadados(idx);
+    if (__atomic_load_n(&estado_sistema_bmpfs.consultas[idx], __ATOMIC_ACQUIRE) > 0) {
+        estado_sistema_bmpfs.arquivos[idx].pai = BMPFS_PAI_ORFAO;
+        marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+        return;
+    }
+    liberar_slot_orfao(idx);
+}
+
+static void recolher_orfaos(estado_bmpfs *estado) {
+    if (!estado->consultas) {
+        return;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        if (estado->arquivos[i].nome_arquivo[0] != '\0' && estado->arquivos[i].pai == BMPFS_PAI_ORFAO) {
+            registrar_info("Liberando entrada órfã %zu (%s)\n", i, estado->arquivos[i].nome_arquivo);
+            estado->consultas[i] = 0;
+            liberar_slot_orfao((int)i);
+        }
+    }
+}
+
+static int nome_valido(const char *nome) {
+    size_t comprimento = strlen(nome);
+    if (comprimento == 0 || strchr(nome, '/') || strcmp(nome, ".") == 0 || strcmp(nome, "..") == 0) {
+        return -EINVAL;
+    }
+    return comprimento < sizeof(((MetadadosArquivo *)0)->nome_arquivo) ? 0 : -ENAMETOOLONG;
+}
+
+static int diretorio_vivo(uint32_t slot) {
+    if (slot == BMPFS_PAI_RAIZ) {
+        return 0;
+    }
+    if (!slot_ativo(slot) || estado_sistema_bmpfs.arquivos[slot].pai == BMPFS_PAI_ORFAO) {
+        return -ENOENT;
+    }
+    return estado_sistema_bmpfs.arquivos[slot].eh_diretorio ? 0 : -ENOTDIR;
+}
+
+static int criar_no_diretorio(uint32_t pai, const char *nome, mode_t modo, int eh_diretorio) {
+    int idx = diretorio_vivo(pai);
+    if (idx == 0) {
+        idx = nome_valido(nome);
+    }
+    if (idx == 0) {
+        idx = reservar_slot_metadados(pai, nome);
+    }
+    if (idx < 0) {
+        return idx;
+    }
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    strncpy(meta->nome_arquivo, nome, sizeof(meta->nome_arquivo) - 1);
+    meta->nome_arquivo[sizeof(meta->nome_arquivo) - 1] = '\0';
+    meta->tamanho = 0;
+    meta->criado = time(NULL);
+    meta->modificado = meta->criado;
+    meta->acessado = meta->criado;
+    memset(meta->dados_inline, 0, sizeof(meta->dados_inline));
+    meta->num_extents = 0;
+    meta->bloco_extents = UINT32_MAX;
+    meta->num_blocos = 0;
+    meta->modo = (eh_diretorio ? S_IFDIR : S_IFREG) | (modo & 0777);
+    meta->uid = getuid();
+    meta->gid = getgid();
+    meta->eh_diretorio = eh_diretorio;
+    meta->pai = pai;
+    meta->em_linha = !eh_diretorio;
+    int resultado_publicacao = publicar_slot_metadados(idx);
+    if (resultado_publicacao == 0) {
+        marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    }
+    destravar_arquivo(idx);
+    return resultado_publicacao < 0 ? resultado_publicacao : idx;
+}
+
+static int criar_entrada(const char *caminho, mode_t modo, int eh_diretorio) {
+    if (eh_caminho_virtual(caminho)) {
+        return -EEXIST;
+    }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t pai;
+    const char *nome;
+    int idx = separar_caminho(caminho, &pai, &nome);
+    if (idx == 0) {
+        idx = criar_no_diretorio(pai, nome, modo, eh_diretorio);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    return idx;
+}
+
+static int criar_diretorio(const char *caminho, mode_t modo) {
+    registrar_debug("Criando diretório: %s\n", caminho);
+    int idx = criar_entrada(caminho, modo, 1);
+    if (idx < 0) {
+        registrar_debug("Falha ao criar diretório %s: %d\n", caminho, idx);
+        return idx;
+    }
+    registrar_debug("Diretório criado com sucesso: %s (idx: %d)\n", caminho, idx);
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após criação do diretório\n");
+        return -EIO;
+    }
+    return 0;
+}
+
+static int criar_bmpfs(const char *caminho, mode_t modo,
+                       struct fuse_file_info *fi) {
+    (void) fi;
+    registrar_debug("Criando arquivo: %s\n", caminho);
+    int idx = criar_entrada(caminho, modo, 0);
+    if (idx < 0) {
+        registrar_debug("Falha ao criar arquivo %s: %d\n", caminho, idx);
+        return idx;
+    }
+    registrar_debug("Arquivo criado com sucesso: %s (idx: %d)\n", caminho, idx);
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após criação do arquivo\n");
+        return -EIO;
+    }
+    return 0;
+}
+
+static int remover_entrada(int idx, int diretorio) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio && !diretorio) {
+        registrar_debug("Não é possível excluir um diretório: %s\n", meta->nome_arquivo);
+        return -EISDIR;
+    }
+    if (!meta->eh_diretorio && diretorio) {
+        registrar_debug("Não é possível remover um arquivo como diretório: %s\n", meta->nome_arquivo);
+        return -ENOTDIR;
+    }
+    if (diretorio && estado_sistema_bmpfs.diretorios[idx].quantidade > 0) {
+        registrar_debug("Diretório não está vazio: %s\n", meta->nome_arquivo);
+        return -ENOTEMPTY;
+    }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    descartar_slot_metadados(idx);
+    destravar_arquivo(idx);
+    return 0;
+}
+
+static int remover_caminho(const char *caminho, int diretorio) {
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    int idx = caminho_para_indice_metadados(caminho);
+    int resultado = idx < 0 ? idx : remover_entrada(idx, diretorio);
+    if (resultado == 0) {
+        cache_dentries_remover(&estado_sistema_bmpfs.cache_dentries, caminho);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (resultado < 0) {
+        return resultado;
+    }
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após remover %s\n", caminho);
+        return -EIO;
+    }
+    registrar_debug("Entrada removida com sucesso: %s (idx: %d)\n", caminho, idx);
+    return 0;
+}
+
+static int excluir_bmpfs(const char *caminho) {
+    return remover_caminho(caminho, 0);
+}
+
+static int ler_travado(int idx, char *buf, size_t tamanho, off_t offset) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio) {
+        destravar_arquivo(idx);
+        return -EISDIR;
+    }
+    if ((uint64_t)offset >= meta->tamanho) {
+        destravar_arquivo(idx);
+        return 0;
+    }
+    if ((uint64_t)(offset + tamanho) > meta->tamanho) {
+        tamanho = meta->tamanho - offset;
+    }
+    if (meta->em_linha) {
+        memcpy(buf, meta->dados_inline + offset, tamanho);
+        destravar_arquivo(idx);
+        return (int)tamanho;
+    }
+    if (estado_sistema_bmpfs.mapeamento) {
+        int resultado_mapeado = ler_arquivo_mapeado(idx, offset, tamanho, buf);
+        destravar_arquivo(idx);
+        return resultado_mapeado < 0 ? resultado_mapeado : (int)tamanho;
+    }
+    int resultado_leitura = ler_intervalo(idx, offset, tamanho, buf);
+    destravar_arquivo(idx);
+    if (resultado_leitura < 0) {
+        return resultado_leitura;
+    }
+    registrar_debug("Lido %zu bytes da entrada %d (offset: %ld)\n", tamanho, idx, offset);
+    return (int)tamanho;
+}
+
+static int ler_bmpfs(const char *caminho, char *buf, size_t tamanho, off_t offset,
+                     struct fuse_file_info *fi) {
+    if (!buf) {
+        return -EINVAL;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    if (eh_arquivo_estatisticas(caminho)) {
+        return ler_estatisticas(buf, tamanho, offset, fi);
+    }
+    int idx = travar_arquivo_descarregado(caminho);
+    if (idx < 0) {
+        return idx;
+    }
+    return ler_travado(idx, buf, tamanho, offset);
+}
+
+static int entregar_copia(char *dados, int lidos, struct fuse_bufvec **bufp) {
+    struct fuse_bufvec *vetor = lidos >= 0 ? malloc(sizeof(struct fuse_bufvec)) : NULL;
+    if (!vetor) {
+        free(dados);
+        return lidos < 0 ? lidos : -ENOMEM;
+    }
+    *vetor = FUSE_BUFVEC_INIT(lidos);
+    vetor->buf[0].mem = dados;
+    *bufp = vetor;
+    return 0;
+}
+
+static int ler_buf_copiando(int idx, struct fuse_bufvec **bufp, size_t tamanho, off_t offset) {
+    char *dados = malloc(tamanho ? tamanho : 1);
+    if (!dados) {
+        destravar_arquivo(idx);
+        return -ENOMEM;
+    }
+    return entregar_copia(dados, ler_travado(idx, dados, tamanho, offset), bufp);
+}
+
+static int ler_buf_estatisticas(struct fuse_bufvec **bufp, size_t tamanho, off_t offset,
+                                struct fuse_file_info *fi) {
+    char *dados = malloc(tamanho ? tamanho : 1);
+    if (!dados) {
+        return -ENOMEM;
+    }
+    return entregar_copia(dados, ler_estatisticas(dados, tamanho, offset, fi), bufp);
+}
+
+static int ler_buf_travado(int idx, struct fuse_bufvec **bufp, size_t tamanho, off_t offset) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (tamanho < BMPFS_MINIMO_ZERO_COPIA || estado_sistema_bmpfs.superbloco.bits_lsb || meta->em_linha ||
+        meta->eh_diretorio) {
+        return ler_buf_copiando(idx, bufp, tamanho, offset);
+    }
+    if ((uint64_t)offset >= meta->tamanho) {
+        tamanho = 0;
+    } else if ((uint64_t)offset + tamanho > meta->tamanho) {
+        tamanho = meta->tamanho - offset;
+    }
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    if (tamanho > 0 && intervalo_tem_buracos(&estado_sistema_bmpfs.extents[idx], offset / tamanho_bloco,
+                                             (offset % tamanho_bloco + tamanho + tamanho_bloco - 1) / tamanho_bloco)) {
+        return ler_buf_copiando(idx, bufp, tamanho, offset);
+    }
+    int resultado = montar_vetor_arquivo(idx, offset, tamanho, 0, bufp);
+    if (resultado < 0) {
+        destravar_arquivo(idx);
+        return resultado;
+    }
+    estatisticas_contar(ESTATISTICAS_LEITURAS_SEM_COPIA, 1);
+    registrar_debug("Leitura sem cópia de %zu bytes da entrada %d (offset: %ld, %zu segmentos)\n",
+                    tamanho, idx, offset, (*bufp)->count);
+    return 1;
+}
+
+static int ler_buf_bmpfs(const char *caminho, struct fuse_bufvec **bufp, size_t tamanho, off_t offset,
+                         struct fuse_file_info *fi) {
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    if (eh_arquivo_estatisticas(caminho)) {
+        return ler_buf_estatisticas(bufp, tamanho, offset, fi);
+    }
+    int idx = travar_arquivo_descarregado(caminho);
+    if (idx < 0) {
+        return idx;
+    }
+    return ler_buf_copiando(idx, bufp, tamanho, offset);
+}
+
+static off_t procurar_extent(int idx, uint64_t offset, int buraco) {
+    ListaExtents *lista = &estado_sistema_bmpfs.extents[idx];
+    uint64_t tamanho = estado_sistema_bmpfs.arquivos[idx].tamanho;
+    uint64_t inicio = 0;
+    for (uint32_t i = 0; i < lista->quantidade && inicio < tamanho; i++) {
+        uint64_t fim = inicio + (uint64_t)lista->itens[i].num_blocos * estado_sistema_bmpfs.tamanho_bloco;
+        if (fim > offset && extent_sem_dados(&lista->itens[i]) == buraco) {
+            return offset > inicio ? offset : inicio;
+        }
+        inicio = fim;
+    }
+    return buraco ? (off_t)tamanho : -ENXIO;
+}
+
+static off_t posicionar_travado(int idx, off_t offset, int origem) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    off_t resultado;
+    if (meta->eh_diretorio) {
+        resultado = -EISDIR;
+    } else if ((uint64_t)offset >= meta->tamanho) {
+        resultado = -ENXIO;
+    } else if (meta->em_linha) {
+        resultado = origem == SEEK_DATA ? offset : (off_t)meta->tamanho;
+    } else {
+        resultado = procurar_extent(idx, offset, origem == SEEK_HOLE);
+    }
+    destravar_arquivo(idx);
+    return resultado;
+}
+
+static off_t posicionar_bmpfs(const char *caminho, off_t offset, int origem, struct fuse_file_info *fi) {
+    (void) fi;
+    if (origem != SEEK_DATA && origem != SEEK_HOLE) {
+        return -EINVAL;
+    }
+    if (offset < 0) {
+        return -ENXIO;
+    }
+    int idx = travar_arquivo_descarregado(caminho);
+    if (idx < 0) {
+        return idx;
+    }
+    return posicionar_travado(idx, offset, origem);
+}
+
+static int escrever_trecho(int idx, const char *buf, size_t tamanho, off_t offset, int *metadados_alterados) {
+    BufferEscrita *buffer = &estado_sistema_bmpfs.buffers_escrita[idx];
+    int resultado = 0;
+    if (buffer->tamanho > 0 && ((uint64_t)offset != buffer->offset + buffer->tamanho ||
+                                buffer->tamanho + tamanho > BMPFS_TAMANHO_BUFFER_ESCRITA)) {
+        resultado = descarregar_buffer_escrita(idx);
+        *metadados_alterados = 1;
+    }
+    if (resultado == 0 && tamanho >= BMPFS_TAMANHO_BUFFER_ESCRITA) {
+        resultado = escrever_intervalo(idx, buf, tamanho, offset);
+        *metadados_alterados = 1;
+    } else if (resultado == 0) {
+        resultado = acumular_buffer_escrita(buffer, buf, tamanho, offset);
+    }
+    return resultado;
+}
+
+static int escrever_travado(int idx, const char *buf, size_t tamanho, off_t offset) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio) {
+        destravar_arquivo(idx);
+        registrar_debug("Não é possível escrever em um diretório: %s\n", meta->nome_arquivo);
+        return -EISDIR;
+    }
+    int metadados_alterados = 0;
+    int resultado = escrever_trecho(idx, buf, tamanho, offset, &metadados_alterados);
+    destravar_arquivo(idx);
+    if (resultado < 0) {
+        return resultado;
+    }
+    registrar_debug("Escrita bem-sucedida: %zu bytes escritos\n", tamanho);
+    if (metadados_alterados && agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após escrita no arquivo\n");
+        return -EIO;
+    }
+    return (int)tamanho;
+}
+
+static int validar_escrita(const char *buf, size_t tamanho, off_t offset) {
+    if (!buf) {
+        registrar_debug("Buffer inválido\n");
+        return -EINVAL;
+    }
+    if (offset < 0) {
+        registrar_debug("Offset negativo\n");
+        return -EINVAL;
+    }
+    size_t novo_tamanho = (size_t)offset + tamanho;
+    if (novo_tamanho < (size_t)offset) {
+        registrar_debug("Overflow no tamanho do arquivo\n");
+        return -EFBIG;
+    }
+    return 0;
+}
+
+static int escrever_bmpfs(const char *caminho, const char *buf, size_t tamanho,
+                          off_t offset, struct fuse_file_info *fi) {
+    (void) fi;
+    registrar_debug("Escrevendo no arquivo: %s (tamanho: %zu, offset: %ld)\n", caminho, tamanho, offset);
+    int resultado = validar_escrita(buf, tamanho, offset);
+    if (resultado < 0) {
+        return resultado;
+    }
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        registrar_debug("Arquivo não encontrado: %d\n", idx);
+        return idx;
+    }
+    return escrever_travado(idx, buf, tamanho, offset);
+}
+
+static int escrever_buf_copiando(int idx, struct fuse_bufvec *buf, size_t tamanho, off_t offset) {
+    char *dados = obter_buffer_thread(BMPFS_BUFFER_TRANSFERENCIA);
+    if (!dados) {
+        destravar_arquivo(idx);
+        return -ENOMEM;
+    }
+    size_t capacidade = capacidade_buffer_thread();
+    size_t total = 0;
+    int metadados_alterados = 0;
+    int resultado = 0;
+    while (total < tamanho) {
+        size_t parte = tamanho - total < capacidade ? tamanho - total : capacidade;
+        struct fuse_bufvec destino = FUSE_BUFVEC_INIT(parte);
+        destino.buf[0].mem = dados;
+        ssize_t copiados = fuse_buf_copy(&destino, buf, 0);
+        if (copiados <= 0) {
+            resultado = (int)copiados;
+            break;
+        }
+        resultado = escrever_trecho(idx, dados, copiados, offset + total, &metadados_alterados);
+        if (resultado < 0) {
+            break;
+        }
+        total += copiados;
+    }
+    destravar_arquivo(idx);
+    if (metadados_alterados && agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após escrita no arquivo\n");
+        return -EIO;
+    }
+    return total ? (int)total : resultado;
+}
+
+static int escrever_buf_travado(int idx, struct fuse_bufvec *buf, off_t offset) {
+    size_t tamanho = fuse_buf_size(buf);
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio) {
+        destravar_arquivo(idx);
+        return -EISDIR;
+    }
+    if (tamanho < BMPFS_MINIMO_ZERO_COPIA || offset % tamanho_bloco != 0 || tamanho % tamanho_bloco != 0 ||
+        estado_sistema_bmpfs.superbloco.bits_lsb || estado_sistema_bmpfs.buffers_escrita[idx].tamanho > 0) {
+        return escrever_buf_copiando(idx, buf, tamanho, offset);
+    }
+    size_t novo_tamanho = (size_t)offset + tamanho;
+    size_t primeiro_bloco = (size_t)offset / tamanho_bloco;
+    size_t novos_blocos = novo_tamanho / tamanho_bloco;
+    int resultado = meta->em_linha ? materializar_inline(idx) : 0;
+    if (resultado == 0 && primeiro_bloco > meta->tamanho / tamanho_bloco) {
+        resultado = zerar_cauda_arquivo(idx);
+    }
+    if (resultado == 0 && primeiro_bloco > meta->num_blocos) {
+        resultado = crescer_esparso(idx, primeiro_bloco);
+    }
+    if (resultado == 0 && novos_blocos > meta->num_blocos) {
+        resultado = crescer_arquivo(idx, novos_blocos, BMPFS_EXTENT_NAO_ESCRITO);
+    }
+    if (resultado == 0) {
+        resultado = preencher_intervalo(idx, primeiro_bloco, tamanho / tamanho_bloco, BMPFS_EXTENT_NAO_ESCRITO);
+    }
+    struct fuse_bufvec *destino = NULL;
+    if (resultado == 0) {
+        resultado = montar_vetor_arquivo(idx, offset, tamanho, 1, &destino);
+    }
+    if (resultado == 0) {
+        __atomic_store_n(&estado_sistema_bmpfs.dados_pendentes, 1, __ATOMIC_RELEASE);
+        ssize_t copiados = fuse_buf_copy(destino, buf, 0);
+        free(destino);
+        size_t completos = copiados > 0 ? (size_t)copiados / tamanho_bloco * tamanho_bloco : 0;
+        if (copiados < 0) {
+            resultado = (int)copiados;
+        } else if (completos == 0) {
+            resultado = -EIO;
+        } else {
+            resultado = preencher_intervalo(idx, primeiro_bloco, completos / tamanho_bloco, 0);
+        }
+        if (resultado == 0) {
+            if ((size_t)offset + completos > meta->tamanho) {
+                meta->tamanho = (size_t)offset + completos;
+            }
+            meta->modificado = time(NULL);
+            marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+            estatisticas_contar(ESTATISTICAS_ESCRITAS_SEM_COPIA, 1);
+            resultado = (int)completos;
+        }
+    }
+    destravar_arquivo(idx);
+    if (resultado < 0) {
+        registrar_erro("Falha na escrita sem cópia na entrada %d: %d\n", idx, resultado);
+        return resultado;
+    }
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        return -EIO;
+    }
+    return resultado;
+}
+
+static int escrever_buf_bmpfs(const char *caminho, struct fuse_bufvec *buf, off_t offset,
+                              struct fuse_file_info *fi) {
+    (void) fi;
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        return idx;
+    }
+    return escrever_buf_travado(idx, buf, offset);
+}
+
+static int readdir_bmpfs(const char *caminho, void *buf, fuse_fill_dir_t filler,
+                         off_t offset, struct fuse_file_info *fi,
+                         enum fuse_readdir_flags flags) {
+    (void) fi;
+    (void) flags;
+    if (caminho && strcmp(caminho, BMPFS_DIRETORIO_VIRTUAL) == 0) {
+        if (offset < 1 && filler(buf, ".", NULL, 1, 0)) {
+            return 0;
+        }
+        if (offset < 2 && filler(buf, "..", NULL, 2, 0)) {
+            return 0;
+        }
+        if (offset < 3) {
+            filler(buf, strrchr(BMPFS_ARQUIVO_ESTATISTICAS, '/') + 1, NULL, 3, 0);
+        }
+        return 0;
+    }
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t diretorio;
+    int resultado = caminho && caminho[0] == '/' ? resolver_caminho(caminho, strlen(caminho), &diretorio) : -EINVAL;
+    if (resultado == 0 && !eh_diretorio_slot(diretorio)) {
+        resultado = -ENOTDIR;
+    }
+    if (resultado < 0) {
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+        return resultado;
+    }
+    if ((offset < 1 && filler(buf, ".", NULL, 1, 0)) || (offset < 2 && filler(buf, "..", NULL, 2, 0))) {
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+        return 0;
+    }
+    ArvoreDiretorio *arvore = diretorio_do_slot(diretorio);
+    uint64_t proximo = offset >= 3 ? (uint64_t)offset - 2 : 0;
+    uint64_t i;
+    while (arvore_diretorio_proxima(arvore, proximo, &i) == 0) {
+        proximo = i + 1;
+        struct stat st;
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.travas_arquivos[i]);
+        preencher_atributos((int)i, &st);
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.travas_arquivos[i]);
+        if (filler(buf, estado_sistema_bmpfs.arquivos[i].nome_arquivo, &st, (off_t)(i + 3), 0)) {
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    return 0;
+}
+
+static int truncar_travado(int idx, off_t tamanho) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio) {
+        destravar_arquivo(idx);
+        registrar_debug("Não é possível truncar um diretório: %s\n", meta->nome_arquivo);
+        return -EISDIR;
+    }
+    int resultado = descarregar_buffer_escrita(idx);
+    if (resultado == 0 && meta->em_linha && (size_t)tamanho > BMPFS_TAMANHO_INLINE) {
+        resultado = materializar_inline(idx);
+    }
+    if (resultado < 0) {
+        destravar_arquivo(idx);
+        return resultado;
+    }
+    if (meta->em_linha && (size_t)tamanho < meta->tamanho) {
+        memset(meta->dados_inline + tamanho, 0, meta->tamanho - tamanho);
+    }
+    if ((size_t)tamanho > meta->tamanho) {
+        resultado = zerar_cauda_arquivo(idx);
+    }
+    size_t novos_blocos = (tamanho + estado_sistema_bmpfs.tamanho_bloco - 1) / estado_sistema_bmpfs.tamanho_bloco;
+    if (resultado == 0 && !meta->em_linha && novos_blocos < meta->num_blocos) {
+        resultado = encolher_arquivo(idx, novos_blocos);
+    } else if (resultado == 0 && !meta->em_linha && novos_blocos > meta->num_blocos) {
+        resultado = crescer_esparso(idx, novos_blocos);
+    }
+    if (resultado < 0) {
+        destravar_arquivo(idx);
+        registrar_erro("Falha ao ajustar blocos durante truncamento: %d\n", resultado);
+        return resultado;
+    }
+    meta->tamanho = tamanho;
+    meta->modificado = time(NULL);
+    if (tamanho == 0 && meta->num_blocos == 0 && !meta->em_linha) {
+        memset(meta->dados_inline, 0, sizeof(meta->dados_inline));
+        meta->em_linha = 1;
+    }
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    destravar_arquivo(idx);
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após truncamento\n");
+        return -EIO;
+    }
+    registrar_debug("Truncamento bem-sucedido: entrada %d truncada para %ld bytes\n", idx, tamanho);
+    return 0;
+}
+
+static int truncar_bmpfs(const char *caminho, off_t tamanho,
+                         struct fuse_file_info *fi) {
+    (void) fi;
+    if (tamanho < 0) {
+        return -EINVAL;
+    }
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        return idx;
+    }
+    return truncar_travado(idx, tamanho);
+}
+
+static int reservar_espaco_arquivo(int idx, uint64_t offset, uint64_t fim, int manter_tamanho) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    int resultado = 0;
+    if (meta->em_linha && fim <= BMPFS_TAMANHO_INLINE) {
+        if (!manter_tamanho && fim > meta->tamanho) {
+            meta->tamanho = fim;
+        }
+        return 0;
+    }
+    if (meta->em_linha) {
+        resultado = materializar_inline(idx);
+    }
+    if (resultado == 0 && !manter_tamanho && fim > meta->tamanho) {
+        resultado = zerar_cauda_arquivo(idx);
+    }
+    size_t primeiro_bloco = offset / tamanho_bloco;
+    size_t ultimo_bloco = (fim + tamanho_bloco - 1) / tamanho_bloco;
+    if (resultado == 0 && primeiro_bloco > meta->num_blocos) {
+        resultado = crescer_esparso(idx, primeiro_bloco);
+    }
+    if (resultado == 0 && ultimo_bloco > meta->num_blocos) {
+        resultado = crescer_arquivo(idx, ultimo_bloco, BMPFS_EXTENT_NAO_ESCRITO);
+    }
+    if (resultado == 0) {
+        resultado = preencher_intervalo(idx, primeiro_bloco, ultimo_bloco - primeiro_bloco, BMPFS_EXTENT_NAO_ESCRITO);
+    }
+    if (resultado == 0 && !manter_tamanho && fim > meta->tamanho) {
+        meta->tamanho = fim;
+    }
+    return resultado;
+}
+
+static int perfurar_arquivo(int idx, uint64_t offset, uint64_t fim) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    size_t tamanho_bloco = estado_sistema_bmpfs.tamanho_bloco;
+    if (meta->em_linha) {
+        if (offset < meta->tamanho) {
+            memset(meta->dados_inline + offset, 0, (fim < meta->tamanho ? fim : meta->tamanho) - offset);
+        }
+        return 0;
+    }
+    uint64_t primeiro_inteiro = (offset + tamanho_bloco - 1) / tamanho_bloco;
+    uint64_t fim_inteiro = fim / tamanho_bloco;
+    if (primeiro_inteiro >= fim_inteiro) {
+        return zerar_trecho_arquivo(idx, offset, fim);
+    }
+    int resultado = zerar_trecho_arquivo(idx, offset, primeiro_inteiro * tamanho_bloco);
+    if (resultado == 0) {
+        resultado = zerar_trecho_arquivo(idx, fim_inteiro * tamanho_bloco, fim);
+    }
+    if (fim_inteiro > meta->num_blocos) {
+        fim_inteiro = meta->num_blocos;
+    }
+    if (resultado == 0 && primeiro_inteiro < fim_inteiro) {
+        resultado = perfurar_intervalo(idx, primeiro_inteiro, fim_inteiro - primeiro_inteiro);
+    }
+    return resultado;
+}
+
+static int validar_alocacao(int modo, off_t offset, off_t tamanho) {
+    if (offset < 0 || tamanho <= 0) {
+        return -EINVAL;
+    }
+    if ((modo & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE)) ||
+        ((modo & FALLOC_FL_PUNCH_HOLE) && !(modo & FALLOC_FL_KEEP_SIZE))) {
+        return -EOPNOTSUPP;
+    }
+    uint64_t fim = (uint64_t)offset + (uint64_t)tamanho;
+    if (fim < (uint64_t)offset || fim / estado_sistema_bmpfs.tamanho_bloco >= UINT32_MAX) {
+        return -EFBIG;
+    }
+    return 0;
+}
+
+static int alocar_espaco_travado(int idx, int modo, off_t offset, off_t tamanho) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (meta->eh_diretorio) {
+        destravar_arquivo(idx);
+        return -EISDIR;
+    }
+    uint64_t fim = (uint64_t)offset + (uint64_t)tamanho;
+    int resultado = descarregar_buffer_escrita(idx);
+    if (resultado == 0 && (modo & FALLOC_FL_PUNCH_HOLE)) {
+        resultado = perfurar_arquivo(idx, offset, fim);
+    } else if (resultado == 0) {
+        resultado = reservar_espaco_arquivo(idx, offset, fim, modo & FALLOC_FL_KEEP_SIZE);
+    }
+    if (resultado == 0) {
+        meta->modificado = time(NULL);
+        marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    }
+    destravar_arquivo(idx);
+    if (resultado < 0) {
+        registrar_debug("Falha em fallocate da entrada %d (modo %d, offset %ld, tamanho %ld): %d\n", idx, modo,
+                        offset, tamanho, resultado);
+        return resultado;
+    }
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após fallocate\n");
+        return -EIO;
+    }
+    registrar_debug("fallocate bem-sucedido: entrada %d (modo %d, offset %ld, tamanho %ld)\n", idx, modo, offset,
+                    tamanho);
+    return 0;
+}
+
+static int alocar_espaco_bmpfs(const char *caminho, int modo, off_t offset, off_t tamanho,
+                               struct fuse_file_info *fi) {
+    (void) fi;
+    if (offset < 0 || tamanho <= 0) {
+        return -EINVAL;
+    }
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    int resultado = validar_alocacao(modo, offset, tamanho);
+    if (resultado < 0) {
+        return resultado;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        return idx;
+    }
+    return alocar_espaco_travado(idx, modo, offset, tamanho);
+}
+
+static void ajustar_tempo(time_t *destino, const struct timespec *ts, time_t atual) {
+    if (!ts || ts->tv_nsec == UTIME_NOW) {
+        *destino = atual;
+    } else if (ts->tv_nsec != UTIME_OMIT) {
+        *destino = ts->tv_sec;
+    }
+}
+
+static int atualizar_tempo_travado(int idx, const struct timespec ts[2]) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    time_t atual = time(NULL);
+    ajustar_tempo(&meta->acessado, ts ? &ts[0] : NULL, atual);
+    ajustar_tempo(&meta->modificado, ts ? &ts[1] : NULL, atual);
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    destravar_arquivo(idx);
+    registrar_debug("Timestamps atualizados para a entrada %d\n", idx);
+    return 0;
+}
+
+static int atualizar_tempo_bmpfs(const char *caminho, const struct timespec ts[2],
+                                 struct fuse_file_info *fi) {
+    (void) fi;
+    if (eh_caminho_virtual(caminho)) {
+        return -EPERM;
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        return idx;
+    }
+    return atualizar_tempo_travado(idx, ts);
+}
+
+static int flush_bmpfs(const char *caminho, struct fuse_file_info *fi) {
+    (void) fi;
+    if (eh_caminho_virtual(caminho)) {
+        return 0;
+    }
+    return descarregar_arquivo(caminho, 0);
+}
+
+static int liberar_bmpfs(const char *caminho, struct fuse_file_info *fi) {
+    if (eh_arquivo_estatisticas(caminho)) {
+        fechar_estatisticas(fi);
+        return 0;
+    }
+    int resultado = descarregar_arquivo(caminho, 1);
+    return resultado == -ENOENT ? 0 : resultado;
+}
+
+static int sincronizar_mapeamento(void) {
+    if (!estado_sistema_bmpfs.mapeamento) {
+        return 0;
+    }
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_mapeamento);
+    int resultado = msync(estado_sistema_bmpfs.mapeamento, estado_sistema_bmpfs.tamanho_mapeamento, MS_SYNC) == 0 ? 0 : -errno;
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_mapeamento);
+    return resultado;
+}
+
+static void descarregar_todos_buffers(estado_bmpfs *estado) {
+    if (!estado->buffers_escrita) {
+        return;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        pthread_rwlock_wrlock(&estado->travas_arquivos[i]);
+        descarregar_buffer_escrita((int)i);
+        pthread_rwlock_unlock(&estado->travas_arquivos[i]);
+        if (limite_sujos_atingido(estado)) {
+            escrever_metadados(estado);
+        }
+    }
+}
+
+static int sincronizar_imagem(int datasync) {
+    int resultado_msync = sincronizar_mapeamento();
+    if (resultado_msync < 0) {
+        return resultado_msync;
+    }
+    return confirmar_metadados(&estado_sistema_bmpfs, 1, datasync);
+}
+
+static int fsync_bmpfs(const char *caminho, int datasync,
+                       struct fuse_file_info *fi) {
+    (void) fi;
+    if (estado_sistema_bmpfs.descritor_bmp < 0) {
+        return -EIO;
+    }
+    if (caminho) {
+        int resultado = descarregar_arquivo(caminho, 0);
+        if (resultado < 0 && resultado != -ENOENT) {
+            return resultado;
+        }
+    } else {
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+        descarregar_todos_buffers(&estado_sistema_bmpfs);
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    }
+    return sincronizar_imagem(datasync);
+}
+
+static int abrir_travado(int idx, int flags) {
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    int resultado = 0;
+    if (meta->eh_diretorio && (flags & O_WRONLY)) {
+        resultado = -EACCES;
+    } else if ((flags & O_WRONLY) && !(meta->modo & S_IWUSR)) {
+        resultado = -EACCES;
+    } else if ((flags & O_RDONLY) && !(meta->modo & S_IRUSR)) {
+        resultado = -EACCES;
+    }
+    destravar_arquivo(idx);
+    return resultado;
+}
+
+static int abrir_bmpfs(const char *caminho, struct fuse_file_info *fi) {
+    if (eh_arquivo_estatisticas(caminho)) {
+        return abrir_estatisticas(fi);
+    }
+    int idx = travar_arquivo_por_caminho(caminho, 1);
+    if (idx < 0) {
+        return idx;
+    }
+    int resultado = abrir_travado(idx, fi->flags);
+    if (resultado == 0) {
+        registrar_debug("Arquivo aberto com sucesso: %s\n", caminho);
+    }
+    return resultado;
+}
+
+static int remover_diretorio_bmpfs(const char *caminho) {
+    return remover_caminho(caminho, 1);
+}
+
+static int renomear_entrada(int idx, uint32_t pai, const char *nome, unsigned int flags) {
+    int resultado = diretorio_vivo(pai);
+    if (resultado == 0) {
+        resultado = nome_valido(nome);
+    }
+    for (uint32_t ancestral = pai; resultado == 0 && ancestral != BMPFS_PAI_RAIZ;
+         ancestral = estado_sistema_bmpfs.arquivos[ancestral].pai) {
+        if (ancestral == (uint32_t)idx) {
+            resultado = -EINVAL;
+        }
+    }
+    if (resultado < 0) {
+        return resultado;
+    }
+    int32_t alvo = buscar_entrada(pai, nome);
+    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
+    if (alvo == idx) {
+        return 0;
+    }
+    if (alvo >= 0) {
+        MetadadosArquivo *meta_alvo = &estado_sistema_bmpfs.arquivos[alvo];
+        if (flags & RENAME_NOREPLACE) {
+            return -EEXIST;
+        } else if (meta->eh_diretorio && !meta_alvo->eh_diretorio) {
+            return -ENOTDIR;
+        } else if (!meta->eh_diretorio && meta_alvo->eh_diretorio) {
+            return -EISDIR;
+        } else if (meta_alvo->eh_diretorio && estado_sistema_bmpfs.diretorios[alvo].quantidade > 0) {
+            return -ENOTEMPTY;
+        }
+    }
+    ArvoreDiretorio *diretorio_origem = diretorio_do_slot(meta->pai);
+    ArvoreDiretorio *diretorio_destino = diretorio_do_slot(pai);
+    uint32_t hash_origem = hash_entrada(meta->pai, meta->nome_arquivo);
+    uint32_t hash_destino = hash_entrada(pai, nome);
+    if (diretorio_destino != diretorio_origem && arvore_diretorio_inserir(diretorio_destino, (uint64_t)idx) < 0) {
+        return -ENOMEM;
+    }
+    if (indice_nomes_inserir(&estado_sistema_bmpfs.indice_nomes, hash_destino, idx) < 0) {
+        if (diretorio_destino != diretorio_origem) {
+            arvore_diretorio_remover(diretorio_destino, (uint64_t)idx);
+        }
+        return -ENOMEM;
+    }
+    if (alvo >= 0) {
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[alvo < idx ? alvo : idx]);
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[alvo < idx ? idx : alvo]);
+        descartar_slot_metadados(alvo);
+        destravar_arquivo(alvo);
+    } else {
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    }
+    indice_nomes_remover(&estado_sistema_bmpfs.indice_nomes, hash_origem, idx);
+    if (diretorio_destino != diretorio_origem) {
+        arvore_diretorio_remover(diretorio_origem, (uint64_t)idx);
+        if (meta->eh_diretorio) {
+            __atomic_sub_fetch(&diretorio_origem->subdiretorios, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&diretorio_destino->subdiretorios, 1, __ATOMIC_RELAXED);
+        }
+    }
+    meta->pai = pai;
+    strncpy(meta->nome_arquivo, nome, sizeof(meta->nome_arquivo) - 1);
+    meta->nome_arquivo[sizeof(meta->nome_arquivo) - 1] = '\0';
+    marcar_arquivo_sujo(&estado_sistema_bmpfs, idx);
+    destravar_arquivo(idx);
+    return 0;
+}
+
+static int renomear_bmpfs(const char *origem, const char *destino, unsigned int flags) {
+    registrar_debug("Renomeando %s para %s\n", origem, destino);
+    if (flags & ~RENAME_NOREPLACE) {
+        return -EINVAL;
+    }
+    if (eh_caminho_virtual(origem) || eh_caminho_virtual(destino)) {
+        return -EPERM;
+    }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t pai = BMPFS_PAI_RAIZ;
+    const char *nome;
+    int idx = caminho_para_indice_metadados(origem);
+    int resultado = idx < 0 ? idx : separar_caminho(destino, &pai, &nome);
+    if (resultado == 0) {
+        resultado = renomear_entrada(idx, pai, nome, flags);
+    }
+    if (resultado < 0) {
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+        registrar_debug("Falha ao renomear %s para %s: %d\n", origem, destino, resultado);
+        return resultado;
+    }
+    if (estado_sistema_bmpfs.arquivos[idx].eh_diretorio) {
+        cache_dentries_invalidar(&estado_sistema_bmpfs.cache_dentries);
+    } else {
+        cache_dentries_remover(&estado_sistema_bmpfs.cache_dentries, origem);
+    }
+    cache_dentries_remover(&estado_sistema_bmpfs.cache_dentries, destino);
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após renomear %s\n", origem);
+        return -EIO;
+    }
+    registrar_debug("Renomeado com sucesso: %s -> %s (idx: %d)\n", origem, destino, idx);
+    return 0;
+}
+
+static int inicializar_travas(estado_bmpfs *estado) {
+    estado->travas_arquivos = reservar_vetor(estado->capacidade_inodes, sizeof(pthread_rwlock_t));
+    estado->buffers_escrita = reservar_vetor(estado->capacidade_inodes, sizeof(BufferEscrita));
+    if (!estado->travas_arquivos || !estado->buffers_escrita ||
+        ativar_vetor(estado->travas_arquivos, estado->max_arquivos, sizeof(pthread_rwlock_t)) < 0 ||
+        ativar_vetor(estado->buffers_escrita, estado->max_arquivos, sizeof(BufferEscrita)) < 0) {
+        liberar_vetor(estado->travas_arquivos, estado->capacidade_inodes, sizeof(pthread_rwlock_t));
+        liberar_vetor(estado->buffers_escrita, estado->capacidade_inodes, sizeof(BufferEscrita));
+        estado->travas_arquivos = NULL;
+        estado->buffers_escrita = NULL;
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        pthread_rwlock_init(&estado->travas_arquivos[i], NULL);
+    }
+    pthread_rwlock_init(&estado->trava_tabela, NULL);
+    pthread_mutex_init(&estado->trava_alocador, NULL);
+    pthread_mutex_init(&estado->trava_metadados, NULL);
+    return 0;
+}
+
+static void destruir_travas(estado_bmpfs *estado) {
+    if (!estado->travas_arquivos) {
+        return;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        pthread_rwlock_destroy(&estado->travas_arquivos[i]);
+        free(estado->buffers_escrita[i].dados);
+    }
+    liberar_vetor(estado->travas_arquivos, estado->capacidade_inodes, sizeof(pthread_rwlock_t));
+    estado->travas_arquivos = NULL;
+    liberar_vetor(estado->buffers_escrita, estado->capacidade_inodes, sizeof(BufferEscrita));
+    estado->buffers_escrita = NULL;
+    pthread_rwlock_destroy(&estado->trava_tabela);
+    pthread_mutex_destroy(&estado->trava_alocador);
+    pthread_mutex_destroy(&estado->trava_metadados);
+}
+
+static int carregar_todos_extents(estado_bmpfs *estado) {
+    estado->extents = reservar_vetor(estado->capacidade_inodes, sizeof(ListaExtents));
+    if (!estado->extents) {
+        return -ENOMEM;
+    }
+    if (ativar_vetor(estado->extents, estado->max_arquivos, sizeof(ListaExtents)) < 0) {
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        if (estado->arquivos[i].nome_arquivo[0] == '\0') {
+            continue;
+        }
+        int resultado = carregar_extents(estado, i);
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return 0;
+}
+
+static void descartar_todos_extents(estado_bmpfs *estado) {
+    if (!estado->extents) {
+        return;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        descartar_extents(&estado->extents[i]);
+    }
+    liberar_vetor(estado->extents, estado->capacidade_inodes, sizeof(ListaExtents));
+    estado->extents = NULL;
+}
+
+static void destruir_indice_nomes(estado_bmpfs *estado) {
+    if (estado->diretorios) {
+        for (size_t i = 0; i < estado->max_arquivos; i++) {
+            arvore_diretorio_destruir(&estado->diretorios[i]);
+        }
+    }
+    liberar_vetor(estado->diretorios, estado->capacidade_inodes, sizeof(ArvoreDiretorio));
+    estado->diretorios = NULL;
+    liberar_vetor(estado->consultas, estado->capacidade_inodes, sizeof(uint64_t));
+    estado->consultas = NULL;
+    arvore_diretorio_destruir(&estado->diretorio_raiz);
+    cache_dentries_destruir(&estado->cache_dentries);
+    indice_nomes_destruir(&estado->indice_nomes);
+    free(estado->inodes_livres);
+    estado->inodes_livres = NULL;
+    estado->num_inodes_livres = 0;
+}
+
+static int construir_indice_nomes(estado_bmpfs *estado) {
+    estado->num_inodes_livres = 0;
+    estado->dica_inodes_livres = 0;
+    estado->inodes_livres = calloc((estado->capacidade_inodes + 63) / 64, sizeof(uint64_t));
+    estado->diretorios = reservar_vetor(estado->capacidade_inodes, sizeof(ArvoreDiretorio));
+    estado->consultas = reservar_vetor(estado->capacidade_inodes, sizeof(uint64_t));
+    memset(&estado->diretorio_raiz, 0, sizeof(ArvoreDiretorio));
+    if (!estado->inodes_livres || !estado->diretorios || !estado->consultas ||
+        ativar_vetor(estado->diretorios, estado->max_arquivos, sizeof(ArvoreDiretorio)) < 0 ||
+        ativar_vetor(estado->consultas, estado->max_arquivos, sizeof(uint64_t)) < 0 ||
+        indice_nomes_inicializar(&estado->indice_nomes, estado->max_arquivos) < 0) {
+        free(estado->inodes_livres);
+        liberar_vetor(estado->diretorios, estado->capacidade_inodes, sizeof(ArvoreDiretorio));
+        liberar_vetor(estado->consultas, estado->capacidade_inodes, sizeof(uint64_t));
+        estado->inodes_livres = NULL;
+        estado->diretorios = NULL;
+        estado->consultas = NULL;
+        return -ENOMEM;
+    }
+    if (cache_dentries_iniciar(&estado->cache_dentries, BMPFS_ENTRADAS_CACHE_DENTRIES) < 0) {
+        indice_nomes_destruir(&estado->indice_nomes);
+        free(estado->inodes_livres);
+        liberar_vetor(estado->diretorios, estado->capacidade_inodes, sizeof(ArvoreDiretorio));
+        liberar_vetor(estado->consultas, estado->capacidade_inodes, sizeof(uint64_t));
+        estado->inodes_livres = NULL;
+        estado->diretorios = NULL;
+        estado->consultas = NULL;
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < estado->max_arquivos; i++) {
+        MetadadosArquivo *meta = &estado->arquivos[i];
+        if (meta->nome_arquivo[0] == '\0') {
+            marcar_inode_livre(estado, i);
+            continue;
+        }
+        if (meta->pai == BMPFS_PAI_ORFAO) {
+            continue;
+        }
+        if (meta->pai != BMPFS_PAI_RAIZ &&
+            (meta->pai >= estado->max_arquivos || meta->pai == i ||
+             estado->arquivos[meta->pai].nome_arquivo[0] == '\0' || !estado->arquivos[meta->pai].eh_diretorio)) {
+            registrar_aviso("Entrada %zu (%s) com diretório pai inválido %u, movendo para a raiz\n",
+                            i, meta->nome_arquivo, meta->pai);
+            meta->pai = BMPFS_PAI_RAIZ;
+        }
+        if (ligar_slot_metadados(i) < 0) {
+            destruir_indice_nomes(estado);
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+static uint32_t reservar_destino(size_t desejados, uint32_t limite) {
+    pthread_mutex_lock(&estado_sistema_bmpfs.trava_alocador);
+    uint32_t destino = indice_livre_primeiro_encaixe(&estado_sistema_bmpfs.indice_livre, desejados, limite);
+    if (destino != UINT32_MAX) {
+        indice_livre_estender(&estado_sistema_bmpfs.indice_livre, destino, desejados);
+        bitmap_marcar(estado_sistema_bmpfs.bitmap, destino, desejados, 1);
+        marcar_bitmap_sujo(&estado_sistema_bmpfs, destino, desejados);
+    }
+    pthread_mutex_unlock(&estado_sistema_bmpfs.trava_alocador);
+    return destino;
+}
+
+static int copiar_blocos(uint32_t origem, uint32_t destino, size_t num_blocos) {
+    char *buffer = obter_buffer_thread(BMPFS_BUFFER_TRANSFERENCIA);
+    if (!buffer) {
+        return -ENOMEM;
+    }
+    size_t por_vez = capacidade_buffer_thread() / estado_sistema_bmpfs.tamanho_bloco;
+    for (size_t copiados = 0; copiados < num_blocos;) {
+        size_t quantidade = num_blocos - copiados < por_vez ? num_blocos - copiados : por_vez;
+        int resultado = ler_blocos(origem + copiados, quantidade, buffer);
+        if (resultado == 0) {
+            resultado = escrever_blocos(destino + copiados, quantidade, buffer);
+        }
+        if (resultado < 0) {
+            return resultado;
+        }
+        copiados += quantidade;
+    }
+    return 0;
+}
+
+static int sincronizar_dados(estado_bmpfs *estado) {
+    LoteIO lote;
+    fila_io_lote(&lote, &estado->fila_io);
+    int resultado = cache_blocos_descarregar_em_lote(&estado->cache_blocos, &lote);
+    if (resultado == 0) {
+        resultado = fila_io_sincronizar(&lote, 1);
+    }
+    int resultado_lote = fila_io_executar(&lote);
+    return resultado < 0 ? resultado : resultado_lote;
+}
+
+static int adiar_liberacao(estado_bmpfs *estado, const ExtentArquivo *antigos, uint32_t quantidade) {
+    pthread_mutex_lock(&estado->trava_metadados);
+    size_t total = estado->num_extents_pendentes + quantidade;
+    ExtentArquivo *extents = realloc(estado->extents_pendentes, total * sizeof(ExtentArquivo));
+    if (!extents) {
+        pthread_mutex_unlock(&estado->trava_metadados);
+        return -ENOMEM;
+    }
+    for (uint32_t i = 0; i < quantidade; i++) {
+        if (antigos[i].bloco_inicio != BMPFS_BURACO) {
+            extents[estado->num_extents_pendentes++] = antigos[i];
+        }
+    }
+    estado->extents_pendentes = extents;
+    pthread_mutex_unlock(&estado->trava_metadados);
+    return 0;
+}
+
+static int migrar_arquivo(size_t idx) {
+    estado_bmpfs *estado = &estado_sistema_bmpfs;
+    pthread_rwlock_rdlock(&estado->trava_tabela);
+    if (idx >= __atomic_load_n(&estado->max_arquivos, __ATOMIC_ACQUIRE)) {
+        pthread_rwlock_unlock(&estado->trava_tabela);
+        return 0;
+    }
+    pthread_rwlock_wrlock(&estado->travas_arquivos[idx]);
+    pthread_rwlock_unlock(&estado->trava_tabela);
+    MetadadosArquivo *meta = &estado->arquivos[idx];
+    ListaExtents *lista = &estado->extents[idx];
+    if (meta->nome_arquivo[0] == '\0' || meta->eh_diretorio || meta->em_linha) {
+        destravar_arquivo(idx);
+        return 0;
+    }
+    int resultado = descarregar_buffer_escrita(idx);
+    if (resultado < 0) {
+        destravar_arquivo(idx);
+        return resultado;
+    }
+    size_t alocados = 0;
+    uint32_t limite = UINT32_MAX;
+    int descontinuo = 0;
+    const ExtentArquivo *anterior = NULL;
+    for (uint32_t i = 0; i < lista->quantidade; i++) {
+        const ExtentArquivo *extent = &lista->itens[i];
+        if (extent->bloco_inicio == BMPFS_BURACO) {
+            continue;
+        }
+        if (anterior && anterior->bloco_inicio + anterior->num_blocos != extent->bloco_inicio) {
+            descontinuo = 1;
+        } else if (!anterior) {
+            limite = extent->bloco_inicio;
+        }
+        alocados += extent->num_blocos;
+        anterior = extent;
+    }
+    if (descontinuo) {
+        limite = UINT32_MAX;
+    }
+    if (alocados == 0 || alocados * estado->tamanho_bloco > BMPFS_MAXIMO_DESFRAGMENTACAO) {
+        destravar_arquivo(idx);
+        return 0;
+    }
+    uint32_t destino = reservar_destino(alocados, limite);
+    if (destino == UINT32_MAX) {
+        destravar_arquivo(idx);
+        return 0;
+    }
+    uint32_t proximo = destino;
+    for (uint32_t i = 0; resultado == 0 && i < lista->quantidade; i++) {
+        const ExtentArquivo *extent = &lista->itens[i];
+        if (extent->bloco_inicio == BMPFS_BURACO) {
+            continue;
+        }
+        if (!(extent->sinalizadores & BMPFS_EXTENT_NAO_ESCRITO)) {
+            resultado = copiar_blocos(extent->bloco_inicio, proximo, extent->num_blocos);
+        }
+        proximo += extent->num_blocos;
+    }
+    if (resultado == 0) {
+        resultado = sincronizar_dados(estado);
+    }
+    uint32_t quantidade_antiga = lista->quantidade;
+    ExtentArquivo *antigos = resultado == 0 ? malloc(quantidade_antiga * sizeof(ExtentArquivo)) : NULL;
+    if (resultado == 0 && !antigos) {
+        resultado = -ENOMEM;
+    }
+    if (resultado < 0) {
+        liberar_blocos(destino, alocados);
+        destravar_arquivo(idx);
+        return resultado;
+    }
+    memcpy(antigos, lista->itens, quantidade_antiga * sizeof(ExtentArquivo));
+    proximo = destino;
+    for (uint32_t i = 0; i < lista->quantidade; i++) {
+        if (lista->itens[i].bloco_inicio != BMPFS_BURACO) {
+            lista->itens[i].bloco_inicio = proximo;
+            proximo += lista->itens[i].num_blocos;
+        }
+    }
+    compactar_extents(lista);
+    resultado = gravar_extents(idx);
+    if (resultado < 0) {
+        memcpy(lista->itens, antigos, quantidade_antiga * sizeof(ExtentArquivo));
+        lista->quantidade = quantidade_antiga;
+        recalcular_inicios(lista, 0);
+        if (gravar_extents(idx) < 0) {
+            registrar_erro("Falha ao restaurar extents de %s após migração\n", meta->nome_arquivo);
+        }
+        liberar_blocos(destino, alocados);
+        free(antigos);
+        destravar_arquivo(idx);
+        return resultado;
+    }
+    marcar_arquivo_sujo(estado, idx);
+    destravar_arquivo(idx);
+    if (escrever_metadados(estado) < 0) {
+        if (adiar_liberacao(estado, antigos, quantidade_antiga) < 0) {
+            registrar_aviso("Falha ao confirmar migração da entrada %zu; %zu blocos antigos ficam reservados\n",
+                            idx, alocados);
+        }
+        free(antigos);
+        return -EIO;
+    }
+    for (uint32_t i = 0; i < quantidade_antiga; i++) {
+        if (antigos[i].bloco_inicio != BMPFS_BURACO) {
+            cache_blocos_invalidar(&estado->cache_blocos, antigos[i].bloco_inicio, antigos[i].num_blocos);
+            liberar_blocos(antigos[i].bloco_inicio, antigos[i].num_blocos);
+        }
+    }
+    free(antigos);
+    return (int)alocados;
+}
+
+static void registrar_fragmentacao(estado_bmpfs *estado) {
+    MetricasEspacoLivre metricas;
+    coletar_espaco_livre(estado, &metricas);
+    const size_t *contagens = metricas.histograma;
+    char histograma[BMPFS_FAIXAS_HISTOGRAMA_LIVRE * 24];
+    size_t usado = 0;
+    for (size_t faixa = 0; faixa < BMPFS_FAIXAS_HISTOGRAMA_LIVRE && usado < sizeof(histograma); faixa++) {
+        if (contagens[faixa]) {
+            usado += snprintf(histograma + usado, sizeof(histograma) - usado, " %s%zu:%zu",
+                              faixa == BMPFS_FAIXAS_HISTOGRAMA_LIVRE - 1 ? ">=" : "", (size_t)1 << faixa,
+                              contagens[faixa]);
+        }
+    }
+    histograma[usado < sizeof(histograma) ? usado : sizeof(histograma) - 1] = '\0';
+    registrar_info("Desfragmentação: ciclo %llu, %llu arquivos e %llu blocos migrados, "
+                   "%zu blocos livres em %zu extents, maior %zu, histograma:%s\n",
+                   (unsigned long long)estado->desfragmentacao.ciclos,
+                   (unsigned long long)estado->desfragmentacao.arquivos_migrados,
+                   (unsigned long long)estado->desfragmentacao.blocos_migrados, metricas.blocos_livres,
+                   metricas.extents_livres, metricas.maior_livre, histograma);
+}
+
+static void *executar_desfragmentador(void *argumento) {
+    estado_bmpfs *estado = argumento;
+    unsigned int ocioso_ms = estado->ocioso_desfragmentacao_s * 1000;
+    uint64_t bytes_por_segundo = (uint64_t)estado->desfragmentacao_mb_s * 1024 * 1024;
+    unsigned int espera = ocioso_ms;
+    size_t cursor = 0;
+    int migrados_no_ciclo = 0;
+    pthread_mutex_lock(&estado->trava_desfragmentador);
+    while (!estado->encerrando_desfragmentador) {
+        if (espera > 0) {
+            struct timespec limite;
+            calcular_prazo(&limite, espera);
+            pthread_cond_timedwait(&estado->sinal_desfragmentador, &estado->trava_desfragmentador, &limite);
+            if (estado->encerrando_desfragmentador) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&estado->trava_desfragmentador);
+        time_t ultima = __atomic_load_n(&estado->ultima_atividade, __ATOMIC_RELAXED);
+        if (time(NULL) - ultima < (time_t)estado->ocioso_desfragmentacao_s) {
+            espera = 1000;
+            pthread_mutex_lock(&estado->trava_desfragmentador);
+            continue;
+        }
+        size_t num_arquivos = __atomic_load_n(&estado->max_arquivos, __ATOMIC_ACQUIRE);
+        int movidos = 0;
+        for (size_t examinados = 0; movidos == 0 && examinados < BMPFS_LOTE_DESFRAGMENTACAO && cursor < num_arquivos;
+             examinados++) {
+            movidos = migrar_arquivo(cursor++);
+        }
+        espera = 0;
+        if (movidos > 0) {
+            __atomic_fetch_add(&estado->desfragmentacao.arquivos_migrados, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&estado->desfragmentacao.blocos_migrados, (uint64_t)movidos, __ATOMIC_RELAXED);
+            migrados_no_ciclo = 1;
+            espera = (unsigned int)((uint64_t)movidos * estado->tamanho_bloco * 1000 / bytes_por_segundo);
+        } else if (movidos < 0) {
+            __atomic_fetch_add(&estado->desfragmentacao.falhas, 1, __ATOMIC_RELAXED);
+            espera = 1000;
+        }
+        if (cursor >= num_arquivos) {
+            cursor = 0;
+            __atomic_fetch_add(&estado->desfragmentacao.ciclos, 1, __ATOMIC_RELAXED);
+            registrar_fragmentacao(estado);
+            if (!migrados_no_ciclo) {
+                espera = ocioso_ms > 1000 ? ocioso_ms : 1000;
+            }
+            migrados_no_ciclo = 0;
+        }
+        pthread_mutex_lock(&estado->trava_desfragmentador);
+    }
+    pthread_mutex_unlock(&estado->trava_desfragmentador);
+    return NULL;
+}
+
+static void iniciar_desfragmentador(estado_bmpfs *estado) {
+    estado->ultima_atividade = time(NULL);
+    estado->desfragmentador_ativo = 0;
+    if (estado->desfragmentacao_mb_s == 0) {
+        return;
+    }
+    memset(&estado->desfragmentacao, 0, sizeof(EstatisticasDesfragmentacao));
+    pthread_mutex_init(&estado->trava_desfragmentador, NULL);
+    pthread_cond_init(&estado->sinal_desfragmentador, NULL);
+    estado->encerrando_desfragmentador = 0;
+    if (pthread_create(&estado->thread_desfragmentador, NULL, executar_desfragmentador, estado) != 0) {
+        registrar_aviso("Falha ao iniciar desfragmentador; desfragmentação desativada\n");
+        pthread_cond_destroy(&estado->sinal_desfragmentador);
+        pthread_mutex_destroy(&estado->trava_desfragmentador);
+        return;
+    }
+    estado->desfragmentador_ativo = 1;
+}
+
+static void parar_desfragmentador(estado_bmpfs *estado) {
+    if (!estado->desfragmentador_ativo) {
+        return;
+    }
+    pthread_mutex_lock(&estado->trava_desfragmentador);
+    estado->encerrando_desfragmentador = 1;
+    pthread_cond_signal(&estado->sinal_desfragmentador);
+    pthread_mutex_unlock(&estado->trava_desfragmentador);
+    pthread_join(estado->thread_desfragmentador, NULL);
+    pthread_cond_destroy(&estado->sinal_desfragmentador);
+    pthread_mutex_destroy(&estado->trava_desfragmentador);
+    estado->desfragmentador_ativo = 0;
+}
+
+static void *inicializar_bmpfs(struct fuse_conn_info *conn, struct fuse_config *cfg) {
+    conn->want |= conn->capable & (FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE | FUSE_CAP_SPLICE_MOVE);
+    registrar_info("Inicializando sistema de arquivos...\n");
+    cfg->kernel_cache = 1;
+    cfg->entry_timeout = 60.0;
+    cfg->attr_timeout = 60.0;
+    estado_sistema_bmpfs.descritor_bmp = -1;
+    if (!estado_sistema_bmpfs.caminho_imagem) {
+        registrar_erro("Nenhum caminho de imagem fornecido\n");
+        return NULL;
+    }
+    registrar_info("Verificando arquivo: %s\n", estado_sistema_bmpfs.caminho_imagem);
+    estado_sistema_bmpfs.arquivo_bmp = fopen(estado_sistema_bmpfs.caminho_imagem, "r+b");
+    if (!estado_sistema_bmpfs.arquivo_bmp) {
+        registrar_erro("Não foi possível abrir a imagem (errno: %d - %s); crie-a com mkfs.bmpfs\n",
+                       errno, strerror(errno));
+        return NULL;
+    }
+    int fd = fileno(estado_sistema_bmpfs.arquivo_bmp);
+    if (fd == -1) {
+        registrar_erro("Falha ao obter descritor de arquivo\n");
+        goto falha_arquivo;
+    }
+    estado_sistema_bmpfs.descritor_bmp = fd;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        registrar_erro("Falha ao obter estatísticas do arquivo\n");
+        goto falha_arquivo;
+    }
+    if ((st.st_mode & S_IRUSR) == 0 || (st.st_mode & S_IWUSR) == 0) {
+        registrar_erro("Permissões insuficientes para o arquivo BMP\n");
+        goto falha_arquivo;
+    }
+    CabeçalhoBMP cabecalho;
+    InfoCabecalhoBMP info_cabecalho;
+    if (ler_cabecalho_bmp(estado_sistema_bmpfs.arquivo_bmp, &cabecalho, &info_cabecalho) < 0) {
+        registrar_erro("Falha ao ler cabeçalhos BMP\n");
+        goto falha_arquivo;
+    }
+    estado_sistema_bmpfs.cabecalho = cabecalho;
+    estado_sistema_bmpfs.info_cabecalho = info_cabecalho;
+    estado_sistema_bmpfs.tamanho_dados = calcular_tamanho_pixels(&info_cabecalho);
+    if ((uint64_t)st.st_size < (uint64_t)cabecalho.deslocamento_dados + estado_sistema_bmpfs.tamanho_dados) {
+        registrar_erro("Imagem truncada: área de pixels excede o arquivo\n");
+        goto falha_arquivo;
+    }
+    int resultado_fila = fila_io_iniciar(&estado_sistema_bmpfs.fila_io, fd, config_bmpfs.profundidade_io);
+    if (resultado_fila < 0) {
+        registrar_aviso("io_uring indisponível (%d); usando escrita posicional síncrona\n", resultado_fila);
+    } else if (fila_io_assincrona(&estado_sistema_bmpfs.fila_io)) {
+        registrar_info("E/S assíncrona: io_uring com profundidade %u\n", estado_sistema_bmpfs.fila_io.profundidade);
+    }
+    if (carregar_superbloco(&estado_sistema_bmpfs) < 0) {
+        goto falha_fila;
+    }
+    estado_sistema_bmpfs.tamanho_bloco = estado_sistema_bmpfs.superbloco.tamanho_bloco;
+    estado_sistema_bmpfs.max_arquivos = estado_sistema_bmpfs.superbloco.max_arquivos +
+                                        (size_t)estado_sistema_bmpfs.superbloco.num_grupos_inodes *
+                                            estado_sistema_bmpfs.superbloco.entradas_por_grupo;
+    estado_sistema_bmpfs.capacidade_inodes = formato_capacidade_inodes(&estado_sistema_bmpfs.superbloco);
+    if (estado_sistema_bmpfs.capacidade_inodes > INT32_MAX) {
+        estado_sistema_bmpfs.capacidade_inodes = INT32_MAX;
+    }
+    registrar_info("Parâmetros do sistema de arquivos:\n");
+    registrar_info("  Versão do formato: %u\n", estado_sistema_bmpfs.superbloco.versao);
+    registrar_info("  Tamanho dos dados: %zu bytes\n", estado_sistema_bmpfs.tamanho_dados);
+    registrar_info("  Total de blocos: %llu\n", (unsigned long long)estado_sistema_bmpfs.superbloco.total_blocos);
+    registrar_info("  Tamanho do bloco: %zu bytes\n", estado_sistema_bmpfs.tamanho_bloco);
+    registrar_info("  Entradas na tabela de arquivos: %zu (até %zu)\n", estado_sistema_bmpfs.max_arquivos,
+                   estado_sistema_bmpfs.capacidade_inodes);
+    size_t tamanho_bitmap = calcular_tamanho_bitmap(&estado_sistema_bmpfs);
+    estado_sistema_bmpfs.bitmap = calloc(tamanho_bitmap, sizeof(uint8_t));
+    if (!estado_sistema_bmpfs.bitmap) {
+        registrar_erro("Falha ao alocar bitmap\n");
+        goto falha_journal;
+    }
+    estado_sistema_bmpfs.arquivos = reservar_vetor(estado_sistema_bmpfs.capacidade_inodes, sizeof(MetadadosArquivo));
+    if (!estado_sistema_bmpfs.arquivos ||
+        ativar_vetor(estado_sistema_bmpfs.arquivos, estado_sistema_bmpfs.max_arquivos, sizeof(MetadadosArquivo)) < 0) {
+        registrar_erro("Falha ao alocar array de metadados de arquivos\n");
+        goto falha_arquivos;
+    }
+    if (inicializar_travas(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao alocar travas dos arquivos\n");
+        goto falha_arquivos;
+    }
+    if (ler_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao ler metadados\n");
+        goto falha_travas;
+    }
+    size_t tamanho_cache = (size_t)config_bmpfs.cache_mb * 1024 * 1024;
+    if (estado_sistema_bmpfs.superbloco.bits_lsb) {
+        registrar_info("  Modo LSB: %u bits por byte de pixel (kernel %s); cache e mmap desativados\n",
+                       estado_sistema_bmpfs.superbloco.bits_lsb, lsb_melhor_kernel()->nome);
+        tamanho_cache = 0;
+    } else if (config_bmpfs.usar_mmap) {
+        pthread_rwlock_init(&estado_sistema_bmpfs.trava_mapeamento, NULL);
+        int resultado_mapeamento = mapear_imagem(&estado_sistema_bmpfs);
+        if (resultado_mapeamento < 0) {
+            registrar_aviso("Falha ao mapear imagem (%d); usando leitura posicional\n", resultado_mapeamento);
+            pthread_rwlock_destroy(&estado_sistema_bmpfs.trava_mapeamento);
+        } else {
+            tamanho_cache = 0;
+        }
+    }
+    off_t base_blocos = offset_bloco(0);
+    if (cache_blocos_iniciar(&estado_sistema_bmpfs.cache_blocos, &estado_sistema_bmpfs.fila_io, base_blocos,
+                             estado_sistema_bmpfs.tamanho_bloco, tamanho_cache) < 0) {
+        registrar_erro("Falha ao alocar cache de blocos\n");
+        goto falha_mapeamento;
+    }
+    registrar_info("  Cache de blocos: %zu MB\n", tamanho_cache / (1024 * 1024));
+    size_t total_blocos = estado_sistema_bmpfs.superbloco.total_blocos;
+    if (indice_livre_construir(&estado_sistema_bmpfs.indice_livre, estado_sistema_bmpfs.bitmap, total_blocos) < 0) {
+        registrar_erro("Falha ao construir índice de espaço livre\n");
+        goto falha_cache;
+    }
+    registrar_info("  Blocos livres: %zu em %zu extents\n", estado_sistema_bmpfs.indice_livre.blocos_livres,
+                   estado_sistema_bmpfs.indice_livre.num_extents);
+    if (carregar_todos_extents(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao carregar listas de extents\n");
+        goto falha_extents;
+    }
+    if (construir_indice_nomes(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao construir índice de nomes\n");
+        goto falha_extents;
+    }
+    estado_sistema_bmpfs.atraso_metadados_ms = config_bmpfs.atraso_metadados_ms;
+    if (iniciar_escritor_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao alocar controle de metadados sujos\n");
+        goto falha_indice_nomes;
+    }
+    recolher_orfaos(&estado_sistema_bmpfs);
+    estado_sistema_bmpfs.desfragmentacao_mb_s = config_bmpfs.desfragmentacao_mb_s;
+    estado_sistema_bmpfs.ocioso_desfragmentacao_s = config_bmpfs.ocioso_desfragmentacao_s;
+    iniciar_desfragmentador(&estado_sistema_bmpfs);
+    registrar_info("Sistema de arquivos inicializado com sucesso\n");
+    return &estado_sistema_bmpfs;
+
+falha_indice_nomes:
+    destruir_indice_nomes(&estado_sistema_bmpfs);
+falha_extents:
+    descartar_todos_extents(&estado_sistema_bmpfs);
+    indice_livre_destruir(&estado_sistema_bmpfs.indice_livre);
+falha_cache:
+    cache_blocos_destruir(&estado_sistema_bmpfs.cache_blocos);
+falha_mapeamento:
+    desmapear_imagem(&estado_sistema_bmpfs);
+falha_travas:
+    destruir_travas(&estado_sistema_bmpfs);
+falha_arquivos:
+    liberar_vetor(estado_sistema_bmpfs.arquivos, estado_sistema_bmpfs.capacidade_inodes, sizeof(MetadadosArquivo));
+    free(estado_sistema_bmpfs.bitmap);
+falha_journal:
+    journal_fechar(&estado_sistema_bmpfs.journal);
+falha_fila:
+    fila_io_destruir(&estado_sistema_bmpfs.fila_io);
+falha_arquivo:
+    fclose(estado_sistema_bmpfs.arquivo_bmp);
+    estado_sistema_bmpfs.arquivo_bmp = NULL;
+    estado_sistema_bmpfs.descritor_bmp = -1;
+    return NULL;
+}
+
+static void destruir_bmpfs(void *dados_privados) {
+    (void) dados_privados;
+    parar_desfragmentador(&estado_sistema_bmpfs);
+    descarregar_todos_buffers(&estado_sistema_bmpfs);
+    recolher_orfaos(&estado_sistema_bmpfs);
+    parar_escritor_metadados(&estado_sistema_bmpfs);
+    cache_blocos_destruir(&estado_sistema_bmpfs.cache_blocos);
+    desmapear_imagem(&estado_sistema_bmpfs);
+    if (estado_sistema_bmpfs.arquivo_bmp) {
+        fila_io_destruir(&estado_sistema_bmpfs.fila_io);
+        fclose(estado_sistema_bmpfs.arquivo_bmp);
+        estado_sistema_bmpfs.arquivo_bmp = NULL;
+        estado_sistema_bmpfs.descritor_bmp = -1;
+    }
+    destruir_travas(&estado_sistema_bmpfs);
+    descartar_todos_extents(&estado_sistema_bmpfs);
+    indice_livre_destruir(&estado_sistema_bmpfs.indice_livre);
+    destruir_indice_nomes(&estado_sistema_bmpfs);
+    free(estado_sistema_bmpfs.bitmap);
+    estado_sistema_bmpfs.bitmap = NULL;
+    liberar_vetor(estado_sistema_bmpfs.arquivos, estado_sistema_bmpfs.capacidade_inodes, sizeof(MetadadosArquivo));
+    estado_sistema_bmpfs.arquivos = NULL;
+    free(estado_sistema_bmpfs.caminho_imagem);
+    estado_sistema_bmpfs.caminho_imagem = NULL;
+}
+
+static int medir(int operacao, uint64_t inicio, int resultado) {
+    estatisticas_operacao(operacao, inicio, resultado);
+    return resultado;
+}
+
+static int getattr_medido(const char *caminho, struct stat *stbuf, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_GETATTR, inicio, getattr_bmpfs(caminho, stbuf, fi));
+}
+
+static int readdir_medido(const char *caminho, void *buf, fuse_fill_dir_t filler, off_t offset,
+                          struct fuse_file_info *fi, enum fuse_readdir_flags flags) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_READDIR, inicio, readdir_bmpfs(caminho, buf, filler, offset, fi, flags));
+}
+
+static int criar_medido(const char *caminho, mode_t modo, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_CREATE, inicio, criar_bmpfs(caminho, modo, fi));
+}
+
+static int excluir_medido(const char *caminho) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_UNLINK, inicio, excluir_bmpfs(caminho));
+}
+
+static int ler_medido(const char *caminho, char *buf, size_t tamanho, off_t offset, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = ler_bmpfs(caminho, buf, tamanho, offset, fi);
+    if (resultado > 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_LIDOS, (uint64_t)resultado);
+    }
+    return medir(ESTATISTICAS_OP_READ, inicio, resultado);
+}
+
+static int escrever_medido(const char *caminho, const char *buf, size_t tamanho, off_t offset,
+                           struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = escrever_bmpfs(caminho, buf, tamanho, offset, fi);
+    if (resultado > 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_ESCRITOS, (uint64_t)resultado);
+    }
+    return medir(ESTATISTICAS_OP_WRITE, inicio, resultado);
+}
+
+static int ler_buf_medido(const char *caminho, struct fuse_bufvec **bufp, size_t tamanho, off_t offset,
+                          struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = ler_buf_bmpfs(caminho, bufp, tamanho, offset, fi);
+    if (resultado == 0 && *bufp) {
+        estatisticas_contar(ESTATISTICAS_BYTES_LIDOS, fuse_buf_size(*bufp));
+    }
+    return medir(ESTATISTICAS_OP_READ_BUF, inicio, resultado);
+}
+
+static int escrever_buf_medido(const char *caminho, struct fuse_bufvec *buf, off_t offset,
+                               struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = escrever_buf_bmpfs(caminho, buf, offset, fi);
+    if (resultado > 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_ESCRITOS, (uint64_t)resultado);
+    }
+    return medir(ESTATISTICAS_OP_WRITE_BUF, inicio, resultado);
+}
+
+static int abrir_medido(const char *caminho, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_OPEN, inicio, abrir_bmpfs(caminho, fi));
+}
+
+static int truncar_medido(const char *caminho, off_t tamanho, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_TRUNCATE, inicio, truncar_bmpfs(caminho, tamanho, fi));
+}
+
+static int atualizar_tempo_medido(const char *caminho, const struct timespec ts[2], struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_UTIMENS, inicio, atualizar_tempo_bmpfs(caminho, ts, fi));
+}
+
+static int fsync_medido(const char *caminho, int datasync, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_FSYNC, inicio, fsync_bmpfs(caminho, datasync, fi));
+}
+
+static int flush_medido(const char *caminho, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_FLUSH, inicio, flush_bmpfs(caminho, fi));
+}
+
+static int liberar_medido(const char *caminho, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_RELEASE, inicio, liberar_bmpfs(caminho, fi));
+}
+
+static int criar_diretorio_medido(const char *caminho, mode_t modo) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_MKDIR, inicio, criar_diretorio(caminho, modo));
+}
+
+static int remover_diretorio_medido(const char *caminho) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_RMDIR, inicio, remover_diretorio_bmpfs(caminho));
+}
+
+static int renomear_medido(const char *origem, const char *destino, unsigned int flags) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_RENAME, inicio, renomear_bmpfs(origem, destino, flags));
+}
+
+static off_t posicionar_medido(const char *caminho, off_t offset, int origem, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    off_t resultado = posicionar_bmpfs(caminho, offset, origem, fi);
+    estatisticas_operacao(ESTATISTICAS_OP_LSEEK, inicio, resultado);
+    return resultado;
+}
+
+static int alocar_espaco_medido(const char *caminho, int modo, off_t offset, off_t tamanho,
+                                struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    return medir(ESTATISTICAS_OP_FALLOCATE, inicio, alocar_espaco_bmpfs(caminho, modo, offset, tamanho, fi));
+}
+
+struct fuse_operations operacoes_bmpfs = {
+    .init       = inicializar_bmpfs,
+    .destroy    = destruir_bmpfs,
+    .getattr    = getattr_medido,
+    .readdir    = readdir_medido,
+    .create     = criar_medido,
+    .unlink     = excluir_medido,
+    .read       = ler_medido,
+    .write      = escrever_medido,
+    .read_buf   = ler_buf_medido,
+    .write_buf  = escrever_buf_medido,
+    .open       = abrir_medido,
+    .truncate   = truncar_medido,
+    .utimens    = atualizar_tempo_medido,
+    .fsync      = fsync_medido,
+    .flush      = flush_medido,
+    .release    = liberar_medido,
+    .mkdir      = criar_diretorio_medido,
+    .rmdir      = remover_diretorio_medido,
+    .rename     = renomear_medido,
+    .lseek      = posicionar_medido,
+    .fallocate  = alocar_espaco_medido,
+};
+
+static int montado_baixo_nivel;
+
+static int eh_no_virtual(fuse_ino_t no) {
+    return no == BMPFS_NO_DIRETORIO_VIRTUAL || no == BMPFS_NO_ESTATISTICAS;
+}
+
+static int eh_entrada_virtual(fuse_ino_t pai, const char *nome) {
+    return pai == BMPFS_NO_DIRETORIO_VIRTUAL || (pai == FUSE_ROOT_ID && strcmp(nome, BMPFS_DIRETORIO_VIRTUAL + 1) == 0);
+}
+
+static int diretorio_do_no(fuse_ino_t no, uint32_t *slot) {
+    if (no == FUSE_ROOT_ID) {
+        *slot = BMPFS_PAI_RAIZ;
+        return 0;
+    }
+    if (no < 2 || no - 2 >= estado_sistema_bmpfs.max_arquivos) {
+        return eh_no_virtual(no) ? -EPERM : -ENOENT;
+    }
+    *slot = (uint32_t)(no - 2);
+    return diretorio_vivo(*slot);
+}
+
+static void iniciar_entrada(struct fuse_entry_param *entrada) {
+    memset(entrada, 0, sizeof(struct fuse_entry_param));
+    entrada->attr_timeout = BMPFS_TEMPO_CACHE;
+    entrada->entry_timeout = BMPFS_TEMPO_CACHE;
+}
+
+static void registrar_consulta(int idx, struct fuse_entry_param *entrada) {
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    preencher_atributos(idx, &entrada->attr);
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.travas_arquivos[idx]);
+    entrada->ino = no_do_slot(idx);
+    __atomic_add_fetch(&estado_sistema_bmpfs.consultas[idx], 1, __ATOMIC_RELEASE);
+}
+
+static int consultar_no(fuse_ino_t pai, const char *nome, struct fuse_entry_param *entrada) {
+    iniciar_entrada(entrada);
+    if (eh_entrada_virtual(pai, nome)) {
+        if (pai == BMPFS_NO_DIRETORIO_VIRTUAL && strcmp(nome, strrchr(BMPFS_ARQUIVO_ESTATISTICAS, '/') + 1) != 0) {
+            return -ENOENT;
+        }
+        entrada->ino = pai == FUSE_ROOT_ID ? BMPFS_NO_DIRETORIO_VIRTUAL : BMPFS_NO_ESTATISTICAS;
+        preencher_atributos_sinteticos(&entrada->attr, entrada->ino);
+        return 0;
+    }
+    registrar_atividade();
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t diretorio;
+    int idx = diretorio_do_no(pai, &diretorio);
+    if (idx == 0) {
+        idx = nome_valido(nome);
+    }
+    if (idx == 0) {
+        idx = buscar_entrada(diretorio, nome);
+    }
+    if (idx >= 0) {
+        registrar_consulta(idx, entrada);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    return idx < 0 ? idx : 0;
+}
+
+static void esquecer_no(fuse_ino_t no, uint64_t quantidade) {
+    if (no < 2 || eh_no_virtual(no)) {
+        return;
+    }
+    uint64_t slot = no - 2;
+    int liberar = 0;
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    if (slot < estado_sistema_bmpfs.max_arquivos) {
+        uint64_t *consultas = &estado_sistema_bmpfs.consultas[slot];
+        uint64_t atual = __atomic_load_n(consultas, __ATOMIC_ACQUIRE);
+        uint64_t restantes;
+        do {
+            restantes = atual > quantidade ? atual - quantidade : 0;
+        } while (!__atomic_compare_exchange_n(consultas, &atual, restantes, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+        liberar = restantes == 0 && estado_sistema_bmpfs.arquivos[slot].pai == BMPFS_PAI_ORFAO;
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (!liberar) {
+        return;
+    }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    liberar = slot_ativo(slot) && estado_sistema_bmpfs.arquivos[slot].pai == BMPFS_PAI_ORFAO &&
+              __atomic_load_n(&estado_sistema_bmpfs.consultas[slot], __ATOMIC_ACQUIRE) == 0;
+    if (liberar) {
+        pthread_rwlock_wrlock(&estado_sistema_bmpfs.travas_arquivos[slot]);
+        liberar_slot_orfao((int)slot);
+        destravar_arquivo((int)slot);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (liberar && agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após liberar entrada órfã %llu\n", (unsigned long long)slot);
+    }
+}
+
+static int atributos_do_no(fuse_ino_t no, struct stat *st) {
+    if (no == FUSE_ROOT_ID || eh_no_virtual(no)) {
+        preencher_atributos_sinteticos(st, no);
+        return 0;
+    }
+    int idx = travar_arquivo_por_indice(no - 2, 0);
     if (idx < 0) {
-        registrar_debug("Arquivo não encontrado: %d\n", idx);
         return idx;
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (meta->eh_diretorio) {
-        registrar_debug("Não é possível escrever em um diretório: %s\n", caminho);
-        return -EISDIR;
+    preencher_atributos(idx, st);
+    destravar_arquivo(idx);
+    return 0;
+}
+
+static void tempo_pedido(struct timespec *ts, int campos, int definir, int agora, const struct timespec *valor) {
+    if (campos & agora) {
+        ts->tv_sec = 0;
+        ts->tv_nsec = UTIME_NOW;
+    } else if (campos & definir) {
+        *ts = *valor;
+    } else {
+        ts->tv_sec = 0;
+        ts->tv_nsec = UTIME_OMIT;
     }
-    if (offset < 0) {
-        registrar_debug("Offset negativo\n");
-        return -EINVAL;
+}
+
+static int ajustar_atributos_no(fuse_ino_t no, const struct stat *atributos, int campos) {
+    if (no == FUSE_ROOT_ID || eh_no_virtual(no)) {
+        return -EPERM;
     }
-    size_t novo_tamanho = (size_t)offset + tamanho;
-    if (novo_tamanho < (size_t)offset) {
-        registrar_debug("Overflow no tamanho do arquivo\n");
-        return -EFBIG;
+    if (campos & (FUSE_SET_ATTR_MODE | FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID)) {
+        return -ENOSYS;
     }
-    size_t novos_blocos = (novo_tamanho + estado_sistema_bmpfs.tamanho_bloco - 1) / estado_sistema_bmpfs.tamanho_bloco;
-    registrar_debug("Blocos necessários: %zu (atual: %u)\n", novos_blocos, meta->num_blocos);
-    if (novos_blocos > meta->num_blocos) {
-        uint32_t novo_inicio = encontrar_blocos_livres(novos_blocos);
-        if (novo_inicio == UINT32_MAX) {
-            registrar_debug("Nenhum bloco livre disponível\n");
-            return -ENOSPC;
+    int resultado = 0;
+    if (campos & FUSE_SET_ATTR_SIZE) {
+        if (atributos->st_size < 0) {
+            return -EINVAL;
         }
-        registrar_debug("Blocos alocados a partir de: %u\n", novo_inicio);
-        if (meta->num_blocos > 0) {
-            char *buffer_temp = malloc(meta->num_blocos * estado_sistema_bmpfs.tamanho_bloco);
-            if (!buffer_temp) {
-                registrar_debug("Falha ao alocar buffer temporário\n");
-                return -ENOMEM;
-            }
-            int resultado_leitura = ler_blocos(meta->primeiro_bloco, meta->num_blocos, buffer_temp);
-            if (resultado_leitura < 0) {
-                registrar_debug("Falha ao ler blocos existentes: %d\n", resultado_leitura);
-                free(buffer_temp);
-                return resultado_leitura;
-            }
-            int resultado_escrita = escrever_blocos(novo_inicio, meta->num_blocos, buffer_temp);
-            free(buffer_temp);
-            if (resultado_escrita < 0) {
-                registrar_debug("Falha ao escrever nos novos blocos: %d\n", resultado_escrita);
-                return resultado_escrita;
-            }
-            for (uint32_t i = 0; i < meta->num_blocos; i++) {
-                estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
-            }
+        resultado = travar_arquivo_por_indice(no - 2, 1);
+        if (resultado >= 0) {
+            resultado = truncar_travado(resultado, atributos->st_size);
         }
-        meta->primeiro_bloco = novo_inicio;
-        for (uint32_t i = 0; i < novos_blocos; i++) {
-            estado_sistema_bmpfs.bitmap[novo_inicio + i] = 1;
+    }
+    if (resultado == 0 && (campos & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME))) {
+        struct timespec ts[2];
+        tempo_pedido(&ts[0], campos, FUSE_SET_ATTR_ATIME, FUSE_SET_ATTR_ATIME_NOW, &atributos->st_atim);
+        tempo_pedido(&ts[1], campos, FUSE_SET_ATTR_MTIME, FUSE_SET_ATTR_MTIME_NOW, &atributos->st_mtim);
+        resultado = travar_arquivo_por_indice(no - 2, 1);
+        if (resultado >= 0) {
+            resultado = atualizar_tempo_travado(resultado, ts);
         }
-        meta->num_blocos = novos_blocos;
     }
-    uint32_t bloco_inicio = meta->primeiro_bloco + (offset / estado_sistema_bmpfs.tamanho_bloco);
-    size_t deslocamento_bloco = offset % estado_sistema_bmpfs.tamanho_bloco;
-    size_t blocos_para_escrever = (tamanho + deslocamento_bloco + estado_sistema_bmpfs.tamanho_bloco - 1) / estado_sistema_bmpfs.tamanho_bloco;
-    char *buffer_temp = malloc(blocos_para_escrever * estado_sistema_bmpfs.tamanho_bloco);
-    if (!buffer_temp) {
-        registrar_debug("Falha ao alocar buffer de escrita\n");
-        return -ENOMEM;
+    return resultado;
+}
+
+static int criar_no(fuse_ino_t pai, const char *nome, mode_t modo, int eh_diretorio,
+                    struct fuse_entry_param *entrada) {
+    if (eh_entrada_virtual(pai, nome)) {
+        return pai == FUSE_ROOT_ID ? -EEXIST : -EPERM;
     }
-    if (deslocamento_bloco > 0 || (tamanho % estado_sistema_bmpfs.tamanho_bloco) != 0) {
-        int resultado_leitura = ler_blocos(bloco_inicio, blocos_para_escrever, buffer_temp);
-        if (resultado_leitura < 0) {
-            registrar_debug("Falha ao ler blocos para escrita parcial: %d\n", resultado_leitura);
-            free(buffer_temp);
-            return resultado_leitura;
-        }
-    } else {
-        memset(buffer_temp, 0, blocos_para_escrever * estado_sistema_bmpfs.tamanho_bloco);
+    iniciar_entrada(entrada);
+    registrar_atividade();
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t diretorio;
+    int idx = diretorio_do_no(pai, &diretorio);
+    if (idx == 0) {
+        idx = criar_no_diretorio(diretorio, nome, modo, eh_diretorio);
     }
-    memcpy(buffer_temp + deslocamento_bloco, buf, tamanho);
-    int resultado_escrita = escrever_blocos(bloco_inicio, blocos_para_escrever, buffer_temp);
-    free(buffer_temp);
-    if (resultado_escrita < 0) {
-        registrar_debug("Falha ao escrever blocos: %d\n", resultado_escrita);
-        return resultado_escrita;
+    if (idx >= 0) {
+        registrar_consulta(idx, entrada);
     }
-    if (novo_tamanho > meta->tamanho) {
-        meta->tamanho = novo_tamanho;
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (idx < 0) {
+        registrar_debug("Falha ao criar %s no nó %llu: %d\n", nome, (unsigned long long)pai, idx);
+        return idx;
     }
-    meta->modificado = time(NULL);
-    registrar_debug("Escrita bem-sucedida: %zu bytes escritos\n", tamanho);
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após escrita no arquivo\n");
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após criação de %s\n", nome);
         return -EIO;
     }
-    return (int)tamanho;
+    return 0;
 }
 
-static int readdir_bmpfs(const char *caminho, void *buf, fuse_fill_dir_t filler,
-                         off_t offset, struct fuse_file_info *fi,
-                         enum fuse_readdir_flags flags) {
-    (void) offset;
-    (void) fi;
-    (void) flags;
-    if (strcmp(caminho, "/") != 0) {
-        return -ENOENT;
+static int remover_no(fuse_ino_t pai, const char *nome, int diretorio) {
+    if (eh_entrada_virtual(pai, nome)) {
+        return -EPERM;
     }
-    if (filler(buf, ".", NULL, 0, 0) || filler(buf, "..", NULL, 0, 0)) {
-        return -ENOMEM;
-    }
-    for (size_t i = 0; i < estado_sistema_bmpfs.max_arquivos; i++) {
-        if (estado_sistema_bmpfs.arquivos[i].nome_arquivo[0] != '\0') {
-            struct stat st;
-            memset(&st, 0, sizeof(struct stat));
-            st.st_mode = estado_sistema_bmpfs.arquivos[i].modo;
-            st.st_nlink = estado_sistema_bmpfs.arquivos[i].eh_diretorio ? 2 : 1;
-            st.st_size = estado_sistema_bmpfs.arquivos[i].tamanho;
-            st.st_uid = estado_sistema_bmpfs.arquivos[i].uid;
-            st.st_gid = estado_sistema_bmpfs.arquivos[i].gid;
-            st.st_atime = estado_sistema_bmpfs.arquivos[i].acessado;
-            st.st_mtime = estado_sistema_bmpfs.arquivos[i].modificado;
-            st.st_ctime = estado_sistema_bmpfs.arquivos[i].criado;
-            st.st_blocks = (estado_sistema_bmpfs.arquivos[i].tamanho + 511) / 512;
-            st.st_blksize = estado_sistema_bmpfs.tamanho_bloco;
-            if (estado_sistema_bmpfs.arquivos[i].eh_diretorio) {
-                st.st_mode |= S_IFDIR;
-            } else {
-                st.st_mode |= S_IFREG;
-            }
-            if (filler(buf, estado_sistema_bmpfs.arquivos[i].nome_arquivo, &st, 0, 0)) {
-                return -ENOMEM;
-            }
-        }
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t slot_pai;
+    int idx = diretorio_do_no(pai, &slot_pai);
+    if (idx == 0) {
+        idx = buscar_entrada(slot_pai, nome);
+    }
+    int resultado = idx < 0 ? idx : remover_entrada(idx, diretorio);
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (resultado < 0) {
+        return resultado;
+    }
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após remover %s\n", nome);
+        return -EIO;
     }
     return 0;
 }
 
-static int truncar_bmpfs(const char *caminho, off_t tamanho,
-                         struct fuse_file_info *fi) {
-    (void) fi;
-    if (tamanho < 0) {
+static int renomear_no(fuse_ino_t pai, const char *nome, fuse_ino_t novo_pai, const char *novo_nome,
+                       unsigned int flags) {
+    if (flags & ~RENAME_NOREPLACE) {
         return -EINVAL;
     }
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+    if (eh_entrada_virtual(pai, nome) || eh_entrada_virtual(novo_pai, novo_nome)) {
+        return -EPERM;
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (meta->eh_diretorio) {
-        registrar_debug("Não é possível truncar um diretório: %s\n", caminho);
-        return -EISDIR;
+    pthread_rwlock_wrlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t origem, destino;
+    int idx = diretorio_do_no(pai, &origem);
+    if (idx == 0) {
+        idx = buscar_entrada(origem, nome);
     }
-    size_t novos_blocos = (tamanho + estado_sistema_bmpfs.tamanho_bloco - 1) / estado_sistema_bmpfs.tamanho_bloco;
-    if (tamanho == 0) {
-        for (uint32_t i = 0; i < meta->num_blocos; i++) {
-            estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
-        }
-        meta->primeiro_bloco = UINT32_MAX;
-        meta->num_blocos = 0;
-        meta->tamanho = 0;
-        meta->modificado = time(NULL);
-    } else if (novos_blocos < meta->num_blocos) {
-        for (uint32_t i = novos_blocos; i < meta->num_blocos; i++) {
-            estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
-        }
-        meta->num_blocos = novos_blocos;
-        meta->tamanho = tamanho;
-        meta->modificado = time(NULL);
-    } else if (novos_blocos > meta->num_blocos) {
-        uint32_t novo_inicio = encontrar_blocos_livres(novos_blocos);
-        if (novo_inicio == UINT32_MAX) {
-            return -ENOSPC;
+    int resultado = idx < 0 ? idx : diretorio_do_no(novo_pai, &destino);
+    if (resultado == 0) {
+        resultado = renomear_entrada(idx, destino, novo_nome, flags);
+    }
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+    if (resultado < 0) {
+        return resultado;
+    }
+    if (agendar_metadados(&estado_sistema_bmpfs) < 0) {
+        registrar_erro("Falha ao escrever metadados após renomear %s\n", nome);
+        return -EIO;
+    }
+    return 0;
+}
+
+static void descartar_vetor_leitura(struct fuse_bufvec *vetor) {
+    for (size_t i = 0; i < vetor->count; i++) {
+        if (!(vetor->buf[i].flags & FUSE_BUF_IS_FD)) {
+            free(vetor->buf[i].mem);
         }
-        registrar_debug("Blocos alocados a partir de: %u\n", novo_inicio);
-        if (meta->num_blocos > 0) {
-            char *buffer_temp = malloc(meta->num_blocos * estado_sistema_bmpfs.tamanho_bloco);
-            if (!buffer_temp) {
-                return -ENOMEM;
-            }
-            int resultado_leitura = ler_blocos(meta->primeiro_bloco, meta->num_blocos, buffer_temp);
-            if (resultado_leitura < 0) {
-                registrar_debug("Falha ao ler blocos existentes durante truncamento: %d\n", resultado_leitura);
-                free(buffer_temp);
-                return resultado_leitura;
-            }
-            int resultado_escrita = escrever_blocos(novo_inicio, meta->num_blocos, buffer_temp);
-            free(buffer_temp);
-            if (resultado_escrita < 0) {
-                registrar_debug("Falha ao escrever nos novos blocos durante truncamento: %d\n", resultado_escrita);
-                return resultado_escrita;
-            }
-            for (uint32_t i = 0; i < meta->num_blocos; i++) {
-                estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
+    }
+    free(vetor);
+}
+
+static size_t adicionar_entrada(fuse_req_t req, char *buf, size_t restante, const char *nome,
+                                const struct fuse_entry_param *entrada, off_t proximo, int mais) {
+    return mais ? fuse_add_direntry_plus(req, buf, restante, nome, entrada, proximo)
+                : fuse_add_direntry(req, buf, restante, nome, &entrada->attr, proximo);
+}
+
+static int listar_no(fuse_req_t req, fuse_ino_t no, char *buf, size_t tamanho, off_t offset, int mais,
+                     size_t *usado) {
+    struct fuse_entry_param entrada;
+    iniciar_entrada(&entrada);
+    *usado = 0;
+    if (no == BMPFS_NO_DIRETORIO_VIRTUAL) {
+        const char *nomes[] = {".", "..", strrchr(BMPFS_ARQUIVO_ESTATISTICAS, '/') + 1};
+        const fuse_ino_t nos[] = {BMPFS_NO_DIRETORIO_VIRTUAL, FUSE_ROOT_ID, BMPFS_NO_ESTATISTICAS};
+        for (off_t i = offset < 0 ? 0 : offset; i < 3; i++) {
+            entrada.ino = nos[i];
+            preencher_atributos_sinteticos(&entrada.attr, nos[i]);
+            size_t ocupado = adicionar_entrada(req, buf + *usado, tamanho - *usado, nomes[i], &entrada, i + 1, mais);
+            if (ocupado > tamanho - *usado) {
+                break;
             }
+            *usado += ocupado;
         }
-        for (uint32_t i = 0; i < novos_blocos; i++) {
-            estado_sistema_bmpfs.bitmap[novo_inicio + i] = 1;
+        return 0;
+    }
+    pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+    uint32_t diretorio;
+    int resultado = diretorio_do_no(no, &diretorio);
+    if (resultado < 0) {
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+        return resultado;
+    }
+    uint32_t pai = diretorio == BMPFS_PAI_RAIZ ? BMPFS_PAI_RAIZ : estado_sistema_bmpfs.arquivos[diretorio].pai;
+    const char *pontos[] = {".", ".."};
+    const fuse_ino_t nos_pontos[] = {no, no_do_slot(pai)};
+    for (off_t i = offset < 0 ? 0 : offset; i < 2; i++) {
+        memset(&entrada.attr, 0, sizeof(struct stat));
+        entrada.ino = nos_pontos[i];
+        entrada.attr.st_ino = nos_pontos[i];
+        entrada.attr.st_mode = S_IFDIR;
+        size_t ocupado = adicionar_entrada(req, buf + *usado, tamanho - *usado, pontos[i], &entrada, i + 1, mais);
+        if (ocupado > tamanho - *usado) {
+            pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
+            return 0;
         }
-        meta->primeiro_bloco = novo_inicio;
-        meta->num_blocos = novos_blocos;
-        meta->tamanho = tamanho;
-        meta->modificado = time(NULL);
+        *usado += ocupado;
     }
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após truncamento\n");
-        return -EIO;
+    ArvoreDiretorio *arvore = diretorio_do_slot(diretorio);
+    uint64_t proximo = offset >= 3 ? (uint64_t)offset - 2 : 0;
+    uint64_t i;
+    while (arvore_diretorio_proxima(arvore, proximo, &i) == 0) {
+        proximo = i + 1;
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.travas_arquivos[i]);
+        preencher_atributos((int)i, &entrada.attr);
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.travas_arquivos[i]);
+        entrada.ino = no_do_slot(i);
+        size_t ocupado = adicionar_entrada(req, buf + *usado, tamanho - *usado,
+                                           estado_sistema_bmpfs.arquivos[i].nome_arquivo, &entrada, (off_t)(i + 3), mais);
+        if (ocupado > tamanho - *usado) {
+            break;
+        }
+        *usado += ocupado;
+        if (mais) {
+            __atomic_add_fetch(&estado_sistema_bmpfs.consultas[i], 1, __ATOMIC_RELEASE);
+        }
     }
-    registrar_debug("Truncamento bem-sucedido: %s truncado para %ld bytes\n", caminho, tamanho);
+    pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
     return 0;
 }
 
-static int atualizar_tempo_bmpfs(const char *caminho, const struct timespec ts[2],
-                                 struct fuse_file_info *fi) {
-    (void) fi;
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+static void responder_erro(fuse_req_t req, int resultado) {
+    fuse_reply_err(req, resultado < 0 ? -resultado : 0);
+}
+
+static void inicializar_baixo_nivel(void *dados, struct fuse_conn_info *conn) {
+    struct fuse_session **sessao = dados;
+    struct fuse_config configuracao;
+    memset(&configuracao, 0, sizeof(configuracao));
+    montado_baixo_nivel = inicializar_bmpfs(conn, &configuracao) != NULL;
+    if (!montado_baixo_nivel && sessao && *sessao) {
+        fuse_session_exit(*sessao);
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (ts) {
-        meta->acessado = ts[0].tv_sec;
-        meta->modificado = ts[1].tv_sec;
+}
+
+static void destruir_baixo_nivel(void *dados) {
+    if (montado_baixo_nivel) {
+        destruir_bmpfs(dados);
+        montado_baixo_nivel = 0;
+    }
+}
+
+static void consultar_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome) {
+    uint64_t inicio = estatisticas_relogio();
+    struct fuse_entry_param entrada;
+    int resultado = consultar_no(pai, nome, &entrada);
+    estatisticas_operacao(ESTATISTICAS_OP_LOOKUP, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
     } else {
-        time_t atual = time(NULL);
-        meta->acessado = atual;
-        meta->modificado = atual;
+        fuse_reply_entry(req, &entrada);
     }
-    registrar_debug("Timestamps atualizados para o arquivo: %s\n", caminho);
-    return 0;
 }
 
-static int fsync_bmpfs(const char *caminho, int datasync,
-                       struct fuse_file_info *fi) {
-    (void) caminho;
+static void esquecer_baixo_nivel(fuse_req_t req, fuse_ino_t no, uint64_t quantidade) {
+    uint64_t inicio = estatisticas_relogio();
+    esquecer_no(no, quantidade);
+    estatisticas_operacao(ESTATISTICAS_OP_FORGET, inicio, 0);
+    fuse_reply_none(req);
+}
+
+static void esquecer_varios_baixo_nivel(fuse_req_t req, size_t quantidade, struct fuse_forget_data *nos) {
+    uint64_t inicio = estatisticas_relogio();
+    for (size_t i = 0; i < quantidade; i++) {
+        esquecer_no(nos[i].ino, nos[i].nlookup);
+    }
+    estatisticas_operacao(ESTATISTICAS_OP_FORGET, inicio, 0);
+    fuse_reply_none(req);
+}
+
+static void getattr_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
     (void) fi;
-    if (!estado_sistema_bmpfs.arquivo_bmp) {
-        return -EIO;
+    uint64_t inicio = estatisticas_relogio();
+    struct stat st;
+    int resultado = atributos_do_no(no, &st);
+    estatisticas_operacao(ESTATISTICAS_OP_GETATTR, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_attr(req, &st, BMPFS_TEMPO_CACHE);
+    }
+}
+
+static void setattr_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct stat *atributos, int campos,
+                                struct fuse_file_info *fi) {
+    (void) fi;
+    uint64_t inicio = estatisticas_relogio();
+    struct stat st;
+    int resultado = ajustar_atributos_no(no, atributos, campos);
+    if (resultado == 0) {
+        resultado = atributos_do_no(no, &st);
     }
-    if (datasync) {
-        return fdatasync(fileno(estado_sistema_bmpfs.arquivo_bmp));
+    estatisticas_operacao(ESTATISTICAS_OP_SETATTR, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
     } else {
-        return fsync(fileno(estado_sistema_bmpfs.arquivo_bmp));
+        fuse_reply_attr(req, &st, BMPFS_TEMPO_CACHE);
     }
 }
 
-static int abrir_bmpfs(const char *caminho, struct fuse_file_info *fi) {
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+static void criar_diretorio_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome, mode_t modo) {
+    uint64_t inicio = estatisticas_relogio();
+    struct fuse_entry_param entrada;
+    int resultado = criar_no(pai, nome, modo, 1, &entrada);
+    estatisticas_operacao(ESTATISTICAS_OP_MKDIR, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_entry(req, &entrada);
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (meta->eh_diretorio && (fi->flags & O_WRONLY)) {
-        return -EACCES;
+}
+
+static void excluir_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = remover_no(pai, nome, 0);
+    estatisticas_operacao(ESTATISTICAS_OP_UNLINK, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void remover_diretorio_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = remover_no(pai, nome, 1);
+    estatisticas_operacao(ESTATISTICAS_OP_RMDIR, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void renomear_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome, fuse_ino_t novo_pai,
+                                 const char *novo_nome, unsigned int flags) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = renomear_no(pai, nome, novo_pai, novo_nome, flags);
+    estatisticas_operacao(ESTATISTICAS_OP_RENAME, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void abrir_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado;
+    if (no == BMPFS_NO_ESTATISTICAS) {
+        resultado = abrir_estatisticas(fi);
+    } else if (no == FUSE_ROOT_ID || no == BMPFS_NO_DIRETORIO_VIRTUAL) {
+        resultado = -EISDIR;
+    } else {
+        resultado = travar_arquivo_por_indice(no - 2, 1);
+        if (resultado >= 0) {
+            resultado = abrir_travado(resultado, fi->flags);
+        }
+        if (resultado == 0) {
+            fi->fh = no - 2;
+            fi->keep_cache = 1;
+        }
     }
-    if ((fi->flags & O_WRONLY) && !(meta->modo & S_IWUSR)) {
-        return -EACCES;
+    estatisticas_operacao(ESTATISTICAS_OP_OPEN, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_open(req, fi);
     }
-    if ((fi->flags & O_RDONLY) && !(meta->modo & S_IRUSR)) {
-        return -EACCES;
+}
+
+static void criar_baixo_nivel(fuse_req_t req, fuse_ino_t pai, const char *nome, mode_t modo,
+                              struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    struct fuse_entry_param entrada;
+    int resultado = criar_no(pai, nome, modo, 0, &entrada);
+    estatisticas_operacao(ESTATISTICAS_OP_CREATE, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+        return;
     }
-    meta->acessado = time(NULL);
-    registrar_debug("Arquivo aberto com sucesso: %s\n", caminho);
-    return 0;
+    fi->fh = entrada.ino - 2;
+    fi->keep_cache = 1;
+    fuse_reply_create(req, &entrada, fi);
 }
 
-static int remover_diretorio_bmpfs(const char *caminho) {
-    int idx = caminho_para_indice_metadados(caminho);
-    if (idx < 0) {
-        return idx;
+static void ler_baixo_nivel(fuse_req_t req, fuse_ino_t no, size_t tamanho, off_t offset,
+                            struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    struct fuse_bufvec *vetor = NULL;
+    int idx = -1;
+    int resultado;
+    if (offset < 0) {
+        resultado = -EINVAL;
+    } else if (no == BMPFS_NO_ESTATISTICAS) {
+        resultado = ler_buf_estatisticas(&vetor, tamanho, offset, fi);
+    } else {
+        resultado = travar_indice_descarregado(fi->fh);
+        if (resultado >= 0) {
+            idx = resultado;
+            resultado = ler_buf_travado(idx, &vetor, tamanho, offset);
+        }
     }
-    MetadadosArquivo *meta = &estado_sistema_bmpfs.arquivos[idx];
-    if (!meta->eh_diretorio) {
-        registrar_debug("Não é possível remover um arquivo como diretório: %s\n", caminho);
-        return -ENOTDIR;
+    if (resultado >= 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_LIDOS, fuse_buf_size(vetor));
     }
-    for (uint32_t i = 0; i < meta->num_blocos; i++) {
-        estado_sistema_bmpfs.bitmap[meta->primeiro_bloco + i] = 0;
+    estatisticas_operacao(ESTATISTICAS_OP_READ, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+        return;
     }
-    memset(meta, 0, sizeof(MetadadosArquivo));
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados após remoção do diretório\n");
-        return -EIO;
+    fuse_reply_data(req, vetor, FUSE_BUF_SPLICE_MOVE);
+    if (resultado > 0) {
+        destravar_arquivo(idx);
     }
-    registrar_debug("Diretório removido com sucesso: %s (idx: %d)\n", caminho, idx);
-    return 0;
+    descartar_vetor_leitura(vetor);
 }
 
-static void *inicializar_bmpfs(struct fuse_conn_info *conn, struct fuse_config *cfg) {
-    (void) conn;
-    registrar_debug("Inicializando sistema de arquivos...\n");
-    cfg->kernel_cache = 1;
-    cfg->entry_timeout = 60.0;
-    cfg->attr_timeout = 60.0;
-    if (!estado_sistema_bmpfs.caminho_imagem) {
-        registrar_debug("Nenhum caminho de imagem fornecido\n");
-        return NULL;
-    }
-    registrar_debug("Verificando arquivo: %s\n", estado_sistema_bmpfs.caminho_imagem);
-    estado_sistema_bmpfs.arquivo_bmp = fopen(estado_sistema_bmpfs.caminho_imagem, "r+b");
-    if (!estado_sistema_bmpfs.arquivo_bmp) {
-        registrar_debug("Não foi possível abrir o arquivo existente (errno: %d - %s)\n", errno, strerror(errno));
-        int resultado_criacao = criar_arquivo_bmp(estado_sistema_bmpfs.caminho_imagem, 2048, 2048);
-        if (resultado_criacao < 0) {
-            registrar_debug("Falha ao criar arquivo BMP: %d (errno: %d - %s)\n",
-                           resultado_criacao, errno, strerror(errno));
-            return NULL;
+static void escrever_baixo_nivel(fuse_req_t req, fuse_ino_t no, const char *buf, size_t tamanho, off_t offset,
+                                 struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = eh_no_virtual(no) ? -EPERM : validar_escrita(buf, tamanho, offset);
+    if (resultado == 0) {
+        resultado = travar_arquivo_por_indice(fi->fh, 1);
+        if (resultado >= 0) {
+            resultado = escrever_travado(resultado, buf, tamanho, offset);
         }
-        estado_sistema_bmpfs.arquivo_bmp = fopen(estado_sistema_bmpfs.caminho_imagem, "r+b");
-        if (!estado_sistema_bmpfs.arquivo_bmp) {
-            registrar_debug("Falha ao abrir o arquivo BMP criado (errno: %d - %s)\n", errno, strerror(errno));
-            return NULL;
+    }
+    if (resultado > 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_ESCRITOS, (uint64_t)resultado);
+    }
+    estatisticas_operacao(ESTATISTICAS_OP_WRITE, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_write(req, (size_t)resultado);
+    }
+}
+
+static void escrever_buf_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_bufvec *buf, off_t offset,
+                                     struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = eh_no_virtual(no) ? -EPERM : offset < 0 ? -EINVAL : 0;
+    if (resultado == 0) {
+        resultado = travar_arquivo_por_indice(fi->fh, 1);
+        if (resultado >= 0) {
+            resultado = escrever_buf_travado(resultado, buf, offset);
         }
     }
-    int fd = fileno(estado_sistema_bmpfs.arquivo_bmp);
-    if (fd == -1) {
-        registrar_debug("Falha ao obter descritor de arquivo\n");
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    if (resultado > 0) {
+        estatisticas_contar(ESTATISTICAS_BYTES_ESCRITOS, (uint64_t)resultado);
     }
-    struct stat st;
-    if (fstat(fd, &st) == -1) {
-        registrar_debug("Falha ao obter estatísticas do arquivo\n");
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    estatisticas_operacao(ESTATISTICAS_OP_WRITE_BUF, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_write(req, (size_t)resultado);
     }
-    if ((st.st_mode & S_IRUSR) == 0 || (st.st_mode & S_IWUSR) == 0) {
-        registrar_debug("Permissões insuficientes para o arquivo BMP\n");
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+}
+
+static void flush_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = eh_no_virtual(no) ? 0 : descarregar_indice(fi->fh, 0);
+    estatisticas_operacao(ESTATISTICAS_OP_FLUSH, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void liberar_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = 0;
+    if (no == BMPFS_NO_ESTATISTICAS) {
+        fechar_estatisticas(fi);
+    } else if (!eh_no_virtual(no)) {
+        resultado = descarregar_indice(fi->fh, 1);
     }
-    CabeçalhoBMP cabecalho;
-    InfoCabecalhoBMP info_cabecalho;
-    if (ler_cabecalho_bmp(estado_sistema_bmpfs.arquivo_bmp, &cabecalho, &info_cabecalho) < 0) {
-        registrar_debug("Falha ao ler cabeçalhos BMP\n");
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    if (resultado == -ENOENT) {
+        resultado = 0;
     }
-    estado_sistema_bmpfs.cabecalho = cabecalho;
-    estado_sistema_bmpfs.info_cabecalho = info_cabecalho;
-    size_t tamanho_linha = (info_cabecalho.largura * 3 + 3) & ~3;
-    estado_sistema_bmpfs.tamanho_dados = tamanho_linha * info_cabecalho.altura;
-    estado_sistema_bmpfs.tamanho_bloco = 512;
-    estado_sistema_bmpfs.max_arquivos = 1000;
-    registrar_debug("Parâmetros do sistema de arquivos:\n");
-    registrar_debug("  Tamanho dos dados: %zu bytes\n", estado_sistema_bmpfs.tamanho_dados);
-    registrar_debug("  Tamanho do bloco: %zu bytes\n", estado_sistema_bmpfs.tamanho_bloco);
-    registrar_debug("  Máximo de arquivos: %zu\n", estado_sistema_bmpfs.max_arquivos);
-    size_t tamanho_bitmap = estado_sistema_bmpfs.tamanho_dados / estado_sistema_bmpfs.tamanho_bloco;
-    estado_sistema_bmpfs.bitmap = calloc(tamanho_bitmap, sizeof(uint8_t));
-    if (!estado_sistema_bmpfs.bitmap) {
-        registrar_debug("Falha ao alocar bitmap\n");
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    estatisticas_operacao(ESTATISTICAS_OP_RELEASE, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void fsync_baixo_nivel(fuse_req_t req, fuse_ino_t no, int datasync, struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = estado_sistema_bmpfs.descritor_bmp < 0 ? -EIO : 0;
+    if (resultado == 0 && !eh_no_virtual(no) && no != FUSE_ROOT_ID) {
+        resultado = descarregar_indice(fi ? fi->fh : no - 2, 0);
+        if (resultado == -ENOENT) {
+            resultado = 0;
+        }
     }
-    estado_sistema_bmpfs.arquivos = calloc(estado_sistema_bmpfs.max_arquivos, sizeof(MetadadosArquivo));
-    if (!estado_sistema_bmpfs.arquivos) {
-        registrar_debug("Falha ao alocar array de metadados de arquivos\n");
-        free(estado_sistema_bmpfs.bitmap);
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    if (resultado == 0) {
+        resultado = sincronizar_imagem(datasync);
     }
-    if (ler_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao ler metadados\n");
-        free(estado_sistema_bmpfs.bitmap);
-        free(estado_sistema_bmpfs.arquivos);
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        return NULL;
+    estatisticas_operacao(ESTATISTICAS_OP_FSYNC, inicio, resultado);
+    responder_erro(req, resultado);
+}
+
+static void abrir_diretorio_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
+    int resultado = 0;
+    if (no != BMPFS_NO_DIRETORIO_VIRTUAL) {
+        uint32_t diretorio;
+        pthread_rwlock_rdlock(&estado_sistema_bmpfs.trava_tabela);
+        resultado = diretorio_do_no(no, &diretorio);
+        pthread_rwlock_unlock(&estado_sistema_bmpfs.trava_tabela);
     }
-    registrar_debug("Sistema de arquivos inicializado com sucesso\n");
-    return &estado_sistema_bmpfs;
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+        return;
+    }
+    fi->fh = 0;
+    fuse_reply_open(req, fi);
 }
 
-static void destruir_bmpfs(void *dados_privados) {
-    (void) dados_privados;
-    if (escrever_metadados(&estado_sistema_bmpfs) < 0) {
-        registrar_debug("Falha ao escrever metadados na destruição\n");
+static void listar_baixo_nivel(fuse_req_t req, fuse_ino_t no, size_t tamanho, off_t offset, int mais) {
+    uint64_t inicio = estatisticas_relogio();
+    char *buf = malloc(tamanho ? tamanho : 1);
+    size_t usado = 0;
+    int resultado = buf ? listar_no(req, no, buf, tamanho, offset, mais, &usado) : -ENOMEM;
+    estatisticas_operacao(mais ? ESTATISTICAS_OP_READDIRPLUS : ESTATISTICAS_OP_READDIR, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, resultado);
+    } else {
+        fuse_reply_buf(req, buf, usado);
     }
-    if (estado_sistema_bmpfs.arquivo_bmp) {
-        fclose(estado_sistema_bmpfs.arquivo_bmp);
-        estado_sistema_bmpfs.arquivo_bmp = NULL;
+    free(buf);
+}
+
+static void readdir_baixo_nivel(fuse_req_t req, fuse_ino_t no, size_t tamanho, off_t offset,
+                                struct fuse_file_info *fi) {
+    (void) fi;
+    listar_baixo_nivel(req, no, tamanho, offset, 0);
+}
+
+static void readdirplus_baixo_nivel(fuse_req_t req, fuse_ino_t no, size_t tamanho, off_t offset,
+                                    struct fuse_file_info *fi) {
+    (void) fi;
+    listar_baixo_nivel(req, no, tamanho, offset, 1);
+}
+
+static void liberar_diretorio_baixo_nivel(fuse_req_t req, fuse_ino_t no, struct fuse_file_info *fi) {
+    (void) no;
+    (void) fi;
+    fuse_reply_err(req, 0);
+}
+
+static void posicionar_baixo_nivel(fuse_req_t req, fuse_ino_t no, off_t offset, int origem,
+                                   struct fuse_file_info *fi) {
+    (void) no;
+    uint64_t inicio = estatisticas_relogio();
+    off_t resultado;
+    if (origem != SEEK_DATA && origem != SEEK_HOLE) {
+        resultado = -EINVAL;
+    } else if (offset < 0) {
+        resultado = -ENXIO;
+    } else {
+        resultado = travar_indice_descarregado(fi->fh);
+        if (resultado >= 0) {
+            resultado = posicionar_travado((int)resultado, offset, origem);
+        }
+    }
+    estatisticas_operacao(ESTATISTICAS_OP_LSEEK, inicio, resultado);
+    if (resultado < 0) {
+        responder_erro(req, (int)resultado);
+    } else {
+        fuse_reply_lseek(req, resultado);
     }
-    free(estado_sistema_bmpfs.bitmap);
-    estado_sistema_bmpfs.bitmap = NULL;
-    free(estado_sistema_bmpfs.arquivos);
-    estado_sistema_bmpfs.arquivos = NULL;
-    free(estado_sistema_bmpfs.caminho_imagem);
-    estado_sistema_bmpfs.caminho_imagem = NULL;
 }
 
-struct fuse_operations operacoes_bmpfs = {
-    .init       = inicializar_bmpfs,
-    .destroy    = destruir_bmpfs,
-    .getattr    = getattr_bmpfs,
-    .readdir    = readdir_bmpfs,
-    .create     = criar_bmpfs,
-    .unlink     = excluir_bmpfs,
-    .read       = ler_bmpfs,
-    .write      = escrever_bmpfs,
-    .open       = abrir_bmpfs,
-    .truncate   = truncar_bmpfs,
-    .utimens    = atualizar_tempo_bmpfs,
-    .fsync      = fsync_bmpfs,
-    .mkdir      = criar_diretorio,
-    .rmdir      = remover_diretorio_bmpfs,
-};
+static void alocar_espaco_baixo_nivel(fuse_req_t req, fuse_ino_t no, int modo, off_t offset, off_t tamanho,
+                                      struct fuse_file_info *fi) {
+    uint64_t inicio = estatisticas_relogio();
+    int resultado = validar_alocacao(modo, offset, tamanho);
+    if (resultado == 0 && eh_no_virtual(no)) {
+        resultado = -EPERM;
+    }
+    if (resultado == 0) {
+        resultado = travar_arquivo_por_indice(fi->fh, 1);
+        if (resultado >= 0) {
+            resultado = alocar_espaco_travado(resultado, modo, offset, tamanho);
+        }
+    }
+    estatisticas_operacao(ESTATISTICAS_OP_FALLOCATE, inicio, resultado);
+    responder_erro(req, resultado);
+}
 
+struct fuse_lowlevel_ops operacoes_baixo_nivel_bmpfs = {
+    .init           = inicializar_baixo_nivel,
+    .destroy        = destruir_baixo_nivel,
+    .lookup         = consultar_baixo_nivel,
+    .forget         = esquecer_baixo_nivel,
+    .forget_multi   = esquecer_varios_baixo_nivel,
+    .getattr        = getattr_baixo_nivel,
+    .setattr        = setattr_baixo_nivel,
+    .mkdir          = criar_diretorio_baixo_nivel,
+    .unlink         = excluir_baixo_nivel,
+    .rmdir          = remover_diretorio_baixo_nivel,
+    .rename         = renomear_baixo_nivel,
+    .open           = abrir_baixo_nivel,
+    .create         = criar_baixo_nivel,
+    .read           = ler_baixo_nivel,
+    .write          = escrever_baixo_nivel,
+    .write_buf      = escrever_buf_baixo_nivel,
+    .flush          = flush_baixo_nivel,
+    .release        = liberar_baixo_nivel,
+    .fsync          = fsync_baixo_nivel,
+    .opendir        = abrir_diretorio_baixo_nivel,
+    .readdir        = readdir_baixo_nivel,
+    .readdirplus    = readdirplus_baixo_nivel,
+    .releasedir     = liberar_diretorio_baixo_nivel,
+    .lseek          = posicionar_baixo_nivel,
+    .fallocate      = alocar_espaco_baixo_nivel,
+};
@@ -0,0 +1,189 @@
+#ifndef BMPFS_H
+#define BMPFS_H
+
+#define FUSE_USE_VERSION 31
+
+#include <fuse3/fuse.h>
+#include <fuse3/fuse_lowlevel.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "bmp.h"
+#include "formato.h"
+#include "espaco_livre.h"
+#include "indice_nomes.h"
+#include "arvore_diretorio.h"
+#include "cache_dentries.h"
+#include "journal.h"
+#include "cache_blocos.h"
+#include "fila_io.h"
+#include "lsb.h"
+#include "estatisticas.h"
+
+#define BMPFS_PAGINA_BITMAP 4096
+#define BMPFS_ATRASO_METADADOS_PADRAO 100
+#define BMPFS_CACHE_MB_PADRAO 8
+#define BMPFS_PROFUNDIDADE_IO_PADRAO 256
+#define BMPFS_TAMANHO_BUFFER_ESCRITA (1024 * 1024)
+#define BMPFS_MINIMO_ZERO_COPIA (64 * 1024)
+#define BMPFS_TAMANHO_BUFFER_THREAD (256 * 1024)
+#define BMPFS_ALINHAMENTO_BUFFER 4096
+#define BMPFS_ENTRADAS_CACHE_DENTRIES 4096
+#define BMPFS_OCIOSO_DESFRAGMENTACAO_PADRAO 30
+#define BMPFS_MAXIMO_DESFRAGMENTACAO (16 * 1024 * 1024)
+#define BMPFS_LOTE_DESFRAGMENTACAO 1024
+#define BMPFS_FAIXAS_HISTOGRAMA_LIVRE 16
+#define BMPFS_DIRETORIO_VIRTUAL "/.bmpfs"
+#define BMPFS_ARQUIVO_ESTATISTICAS "/.bmpfs/stats"
+#define BMPFS_TEMPO_CACHE 60.0
+#define BMPFS_NO_DIRETORIO_VIRTUAL ((fuse_ino_t)1 << 32)
+#define BMPFS_NO_ESTATISTICAS (BMPFS_NO_DIRETORIO_VIRTUAL + 1)
+
+enum {
+    BMPFS_LOG_ERRO,
+    BMPFS_LOG_AVISO,
+    BMPFS_LOG_INFO,
+    BMPFS_LOG_DEBUG
+};
+
+#ifndef BMPFS_NIVEL_LOG_MAXIMO
+#define BMPFS_NIVEL_LOG_MAXIMO BMPFS_LOG_INFO
+#endif
+
+enum {
+    BMPFS_BUFFER_BLOCOS,
+    BMPFS_BUFFER_TRANSFERENCIA,
+    BMPFS_BUFFER_PORTADORA,
+    BMPFS_NUM_BUFFERS_THREAD
+};
+
+typedef struct {
+    ExtentArquivo *itens;
+    uint32_t *inicios;
+    uint32_t quantidade;
+    uint32_t capacidade;
+    uint32_t *blocos_cadeia;
+    uint32_t num_blocos_cadeia;
+} ListaExtents;
+
+typedef struct {
+    char *buffers[BMPFS_NUM_BUFFERS_THREAD];
+} BuffersThread;
+
+typedef struct {
+    uint64_t offset;
+    size_t tamanho;
+    size_t capacidade;
+    char *dados;
+} BufferEscrita;
+
+typedef struct {
+    uint64_t ciclos;
+    uint64_t arquivos_migrados;
+    uint64_t blocos_migrados;
+    uint64_t falhas;
+} EstatisticasDesfragmentacao;
+
+typedef struct {
+    size_t blocos_livres;
+    size_t extents_livres;
+    size_t maior_livre;
+    size_t histograma[BMPFS_FAIXAS_HISTOGRAMA_LIVRE];
+    uint64_t buscas;
+    uint64_t passos_busca;
+    uint64_t maior_busca;
+} MetricasEspacoLivre;
+
+typedef struct {
+    char *dados;
+    size_t tamanho;
+} InstantaneoEstatisticas;
+
+typedef struct {
+    FILE *arquivo_bmp;
+    int descritor_bmp;
+    char *mapeamento;
+    size_t tamanho_mapeamento;
+    pthread_rwlock_t trava_mapeamento;
+    CabeçalhoBMP cabecalho;
+    InfoCabecalhoBMP info_cabecalho;
+    size_t tamanho_dados;
+    SuperblocoBMPFS superbloco;
+    size_t tamanho_bloco;
+    uint8_t *bitmap;
+    IndiceLivre indice_livre;
+    MetadadosArquivo *arquivos;
+    ListaExtents *extents;
+    size_t max_arquivos;
+    IndiceNomes indice_nomes;
+    ArvoreDiretorio diretorio_raiz;
+    ArvoreDiretorio *diretorios;
+    uint64_t *consultas;
+    CacheDentries cache_dentries;
+    uint64_t *inodes_livres;
+    size_t num_inodes_livres;
+    size_t dica_inodes_livres;
+    size_t capacidade_inodes;
+    char *caminho_imagem;
+    pthread_rwlock_t trava_tabela;
+    pthread_rwlock_t *travas_arquivos;
+    BufferEscrita *buffers_escrita;
+    pthread_mutex_t trava_alocador;
+    pthread_mutex_t trava_metadados;
+    uint64_t *arquivos_sujos;
+    int superbloco_sujo;
+    int64_t bytes_sujos;
+    int dados_pendentes;
+    ExtentArquivo *extents_pendentes;
+    size_t num_extents_pendentes;
+    uint64_t *paginas_bitmap_sujas;
+    FilaIO fila_io;
+    Journal journal;
+    CacheBlocos cache_blocos;
+    pthread_mutex_t trava_confirmacao;
+    pthread_cond_t sinal_confirmacao;
+    uint64_t geracao_pedida;
+    uint64_t geracao_confirmada;
+    int confirmacao_em_andamento;
+    int resultado_confirmacao;
+    unsigned int atraso_metadados_ms;
+    pthread_t thread_escritor;
+    pthread_mutex_t trava_escritor;
+    pthread_cond_t sinal_escritor;
+    int encerrando_escritor;
+    int escritor_ativo;
+    unsigned int desfragmentacao_mb_s;
+    unsigned int ocioso_desfragmentacao_s;
+    time_t ultima_atividade;
+    pthread_t thread_desfragmentador;
+    pthread_mutex_t trava_desfragmentador;
+    pthread_cond_t sinal_desfragmentador;
+    int encerrando_desfragmentador;
+    int desfragmentador_ativo;
+    EstatisticasDesfragmentacao desfragmentacao;
+} estado_bmpfs;
+
+struct config_bmpfs {
+    char *configuracao_caminho_imagem;
+    unsigned int atraso_metadados_ms;
+    unsigned int cache_mb;
+    unsigned int profundidade_io;
+    int usar_mmap;
+    unsigned int desfragmentacao_mb_s;
+    unsigned int ocioso_desfragmentacao_s;
+    unsigned int nivel_log;
+    int baixo_nivel;
+};
+
+#define BMPFS_OPT(t, p) { t, offsetof(struct config_bmpfs, p), 1 }
+
+extern struct config_bmpfs config_bmpfs;
+extern estado_bmpfs estado_sistema_bmpfs;
+extern struct fuse_opt opcoes_bmpfs[];
+extern struct fuse_operations operacoes_bmpfs;
+extern struct fuse_lowlevel_ops operacoes_baixo_nivel_bmpfs;
+
+#endif
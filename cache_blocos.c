@@ -0,0 +1,409 @@
+#include "cache_blocos.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static int transferir(CacheBlocos *cache, int escrita, uint32_t bloco, size_t num_blocos, char *buffer) {
+    size_t tamanho = num_blocos * cache->tamanho_bloco;
+    off_t offset = cache->base + (off_t)bloco * cache->tamanho_bloco;
+    while (tamanho > 0) {
+        ssize_t feitos = escrita ? pwrite(cache->fd, buffer, tamanho, offset) : pread(cache->fd, buffer, tamanho, offset);
+        if (feitos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (feitos <= 0) {
+            return -EIO;
+        }
+        buffer += feitos;
+        tamanho -= feitos;
+        offset += feitos;
+    }
+    return 0;
+}
+
+static ShardCacheBlocos *shard_do_bloco(CacheBlocos *cache, uint32_t bloco) {
+    return &cache->shards[(bloco / CACHE_BLOCOS_AGRUPAMENTO) % cache->num_shards];
+}
+
+static size_t balde_do_bloco(ShardCacheBlocos *shard, uint32_t bloco) {
+    return (size_t)((bloco * UINT32_C(2654435761)) & shard->mascara_baldes);
+}
+
+static char *dados_entrada(CacheBlocos *cache, ShardCacheBlocos *shard, size_t entrada) {
+    return shard->dados + entrada * cache->tamanho_bloco;
+}
+
+static int32_t buscar_entrada(ShardCacheBlocos *shard, uint32_t bloco) {
+    int32_t entrada = shard->baldes[balde_do_bloco(shard, bloco)];
+    while (entrada >= 0 && shard->entradas[entrada].bloco != bloco) {
+        entrada = shard->entradas[entrada].proxima;
+    }
+    return entrada;
+}
+
+static int32_t aguardar_entrada(ShardCacheBlocos *shard, uint32_t bloco) {
+    int32_t entrada = buscar_entrada(shard, bloco);
+    while (entrada >= 0 && shard->entradas[entrada].descarregando) {
+        pthread_cond_wait(&shard->sinal_descarga, &shard->trava);
+        entrada = buscar_entrada(shard, bloco);
+    }
+    return entrada;
+}
+
+static void desligar_entrada(ShardCacheBlocos *shard, size_t entrada) {
+    int32_t *ligacao = &shard->baldes[balde_do_bloco(shard, shard->entradas[entrada].bloco)];
+    while (*ligacao != (int32_t)entrada) {
+        ligacao = &shard->entradas[*ligacao].proxima;
+    }
+    *ligacao = shard->entradas[entrada].proxima;
+    if (shard->entradas[entrada].suja) {
+        shard->num_sujas--;
+    }
+    shard->entradas[entrada].valida = 0;
+    shard->entradas[entrada].suja = 0;
+}
+
+static int obter_vitima(CacheBlocos *cache, ShardCacheBlocos *shard, int32_t *vitima) {
+    size_t ocupadas = 0;
+    for (;;) {
+        size_t entrada = shard->ponteiro;
+        shard->ponteiro = (shard->ponteiro + 1) % shard->capacidade;
+        EntradaCacheBlocos *atual = &shard->entradas[entrada];
+        if (!atual->valida) {
+            *vitima = (int32_t)entrada;
+            return 0;
+        }
+        if (atual->descarregando) {
+            if (++ocupadas == shard->capacidade) {
+                pthread_cond_wait(&shard->sinal_descarga, &shard->trava);
+                ocupadas = 0;
+            }
+            continue;
+        }
+        ocupadas = 0;
+        if (atual->referenciada) {
+            atual->referenciada = 0;
+            continue;
+        }
+        if (atual->suja) {
+            int resultado = transferir(cache, 1, atual->bloco, 1, dados_entrada(cache, shard, entrada));
+            if (resultado < 0) {
+                return resultado;
+            }
+        }
+        desligar_entrada(shard, entrada);
+        *vitima = (int32_t)entrada;
+        return 0;
+    }
+}
+
+static int inserir_entrada(CacheBlocos *cache, ShardCacheBlocos *shard, uint32_t bloco, const char *dados, int suja) {
+    int32_t entrada = suja ? aguardar_entrada(shard, bloco) : buscar_entrada(shard, bloco);
+    if (entrada >= 0) {
+        if (!suja && shard->entradas[entrada].suja) {
+            return 0;
+        }
+    } else {
+        int resultado = obter_vitima(cache, shard, &entrada);
+        if (resultado < 0) {
+            return resultado;
+        }
+        size_t balde = balde_do_bloco(shard, bloco);
+        shard->entradas[entrada].bloco = bloco;
+        shard->entradas[entrada].proxima = shard->baldes[balde];
+        shard->entradas[entrada].valida = 1;
+        shard->entradas[entrada].suja = 0;
+        shard->baldes[balde] = entrada;
+    }
+    memcpy(dados_entrada(cache, shard, entrada), dados, cache->tamanho_bloco);
+    shard->entradas[entrada].referenciada = 1;
+    if (suja && !shard->entradas[entrada].suja) {
+        shard->entradas[entrada].suja = 1;
+        shard->num_sujas++;
+    }
+    return 0;
+}
+
+int cache_blocos_iniciar(CacheBlocos *cache, FilaIO *fila, off_t base, size_t tamanho_bloco, size_t capacidade_bytes) {
+    memset(cache, 0, sizeof(CacheBlocos));
+    cache->fd = fila->fd;
+    cache->fila = fila;
+    cache->base = base;
+    cache->tamanho_bloco = tamanho_bloco;
+    size_t por_shard = capacidade_bytes / tamanho_bloco / CACHE_BLOCOS_SHARDS;
+    if (por_shard == 0) {
+        return 0;
+    }
+    cache->shards = calloc(CACHE_BLOCOS_SHARDS, sizeof(ShardCacheBlocos));
+    cache->sujos = malloc(por_shard * CACHE_BLOCOS_SHARDS * sizeof(BlocoSujo));
+    cache->vetores = malloc(CACHE_BLOCOS_MAX_VETORES * sizeof(struct iovec));
+    if (!cache->shards || !cache->sujos || !cache->vetores) {
+        free(cache->shards);
+        free(cache->sujos);
+        free(cache->vetores);
+        memset(cache, 0, sizeof(CacheBlocos));
+        return -ENOMEM;
+    }
+    pthread_mutex_init(&cache->trava_descarga, NULL);
+    size_t num_baldes = 1;
+    while (num_baldes < por_shard) {
+        num_baldes <<= 1;
+    }
+    for (size_t i = 0; i < CACHE_BLOCOS_SHARDS; i++) {
+        ShardCacheBlocos *shard = &cache->shards[i];
+        shard->entradas = calloc(por_shard, sizeof(EntradaCacheBlocos));
+        shard->dados = malloc(por_shard * tamanho_bloco);
+        shard->baldes = malloc(num_baldes * sizeof(int32_t));
+        if (!shard->entradas || !shard->dados || !shard->baldes) {
+            free(shard->entradas);
+            free(shard->dados);
+            free(shard->baldes);
+            cache->num_shards = i;
+            cache_blocos_destruir(cache);
+            return -ENOMEM;
+        }
+        memset(shard->baldes, 0xFF, num_baldes * sizeof(int32_t));
+        shard->capacidade = por_shard;
+        shard->mascara_baldes = num_baldes - 1;
+        pthread_mutex_init(&shard->trava, NULL);
+        pthread_cond_init(&shard->sinal_descarga, NULL);
+    }
+    cache->num_shards = CACHE_BLOCOS_SHARDS;
+    return 0;
+}
+
+void cache_blocos_destruir(CacheBlocos *cache) {
+    for (size_t i = 0; i < cache->num_shards; i++) {
+        ShardCacheBlocos *shard = &cache->shards[i];
+        pthread_cond_destroy(&shard->sinal_descarga);
+        pthread_mutex_destroy(&shard->trava);
+        free(shard->entradas);
+        free(shard->dados);
+        free(shard->baldes);
+    }
+    if (cache->shards) {
+        pthread_mutex_destroy(&cache->trava_descarga);
+    }
+    free(cache->shards);
+    free(cache->sujos);
+    free(cache->vetores);
+    cache->shards = NULL;
+    cache->sujos = NULL;
+    cache->vetores = NULL;
+    cache->num_shards = 0;
+}
+
+int cache_blocos_ler(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos, char *buffer) {
+    if (cache->num_shards == 0) {
+        return transferir(cache, 0, bloco_inicio, num_blocos, buffer);
+    }
+    size_t i = 0;
+    while (i < num_blocos) {
+        uint32_t bloco = bloco_inicio + i;
+        ShardCacheBlocos *shard = shard_do_bloco(cache, bloco);
+        pthread_mutex_lock(&shard->trava);
+        int32_t entrada = buscar_entrada(shard, bloco);
+        if (entrada >= 0) {
+            memcpy(buffer + i * cache->tamanho_bloco, dados_entrada(cache, shard, entrada), cache->tamanho_bloco);
+            shard->entradas[entrada].referenciada = 1;
+            shard->acertos++;
+            pthread_mutex_unlock(&shard->trava);
+            i++;
+            continue;
+        }
+        shard->falhas++;
+        pthread_mutex_unlock(&shard->trava);
+        size_t fim = i + 1;
+        while (fim < num_blocos) {
+            ShardCacheBlocos *proximo = shard_do_bloco(cache, bloco_inicio + fim);
+            pthread_mutex_lock(&proximo->trava);
+            int presente = buscar_entrada(proximo, bloco_inicio + fim) >= 0;
+            if (!presente) {
+                proximo->falhas++;
+            }
+            pthread_mutex_unlock(&proximo->trava);
+            if (presente) {
+                break;
+            }
+            fim++;
+        }
+        int resultado = transferir(cache, 0, bloco, fim - i, buffer + i * cache->tamanho_bloco);
+        if (resultado < 0) {
+            return resultado;
+        }
+        if (num_blocos <= CACHE_BLOCOS_LIMITE_DIRETO) {
+            for (size_t j = i; j < fim; j++) {
+                ShardCacheBlocos *destino = shard_do_bloco(cache, bloco_inicio + j);
+                pthread_mutex_lock(&destino->trava);
+                int32_t existente = buscar_entrada(destino, bloco_inicio + j);
+                if (existente >= 0 && destino->entradas[existente].suja) {
+                    memcpy(buffer + j * cache->tamanho_bloco, dados_entrada(cache, destino, existente), cache->tamanho_bloco);
+                } else {
+                    resultado = inserir_entrada(cache, destino, bloco_inicio + j, buffer + j * cache->tamanho_bloco, 0);
+                }
+                pthread_mutex_unlock(&destino->trava);
+                if (resultado < 0) {
+                    return resultado;
+                }
+            }
+        }
+        i = fim;
+    }
+    return 0;
+}
+
+int cache_blocos_escrever(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos, const char *buffer) {
+    if (cache->num_shards == 0) {
+        return transferir(cache, 1, bloco_inicio, num_blocos, (char *)buffer);
+    }
+    if (num_blocos > CACHE_BLOCOS_LIMITE_DIRETO) {
+        cache_blocos_invalidar(cache, bloco_inicio, num_blocos);
+        return transferir(cache, 1, bloco_inicio, num_blocos, (char *)buffer);
+    }
+    for (size_t i = 0; i < num_blocos; i++) {
+        ShardCacheBlocos *shard = shard_do_bloco(cache, bloco_inicio + i);
+        pthread_mutex_lock(&shard->trava);
+        int resultado = inserir_entrada(cache, shard, bloco_inicio + i, buffer + i * cache->tamanho_bloco, 1);
+        pthread_mutex_unlock(&shard->trava);
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return 0;
+}
+
+void cache_blocos_invalidar(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos) {
+    for (size_t i = 0; i < num_blocos && cache->num_shards > 0; i++) {
+        ShardCacheBlocos *shard = shard_do_bloco(cache, bloco_inicio + i);
+        pthread_mutex_lock(&shard->trava);
+        int32_t entrada = aguardar_entrada(shard, bloco_inicio + i);
+        if (entrada >= 0) {
+            desligar_entrada(shard, entrada);
+        }
+        pthread_mutex_unlock(&shard->trava);
+    }
+}
+
+int cache_blocos_descarregar_intervalo(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos) {
+    for (size_t i = 0; i < num_blocos && cache->num_shards > 0; i++) {
+        ShardCacheBlocos *shard = shard_do_bloco(cache, bloco_inicio + i);
+        pthread_mutex_lock(&shard->trava);
+        int32_t entrada = aguardar_entrada(shard, bloco_inicio + i);
+        int resultado = 0;
+        if (entrada >= 0 && shard->entradas[entrada].suja) {
+            resultado = transferir(cache, 1, bloco_inicio + i, 1, dados_entrada(cache, shard, entrada));
+            if (resultado == 0) {
+                shard->entradas[entrada].suja = 0;
+                shard->num_sujas--;
+            }
+        }
+        pthread_mutex_unlock(&shard->trava);
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    return 0;
+}
+
+static int comparar_blocos_sujos(const void *a, const void *b) {
+    uint32_t bloco_a = ((const BlocoSujo *)a)->bloco;
+    uint32_t bloco_b = ((const BlocoSujo *)b)->bloco;
+    return (bloco_a > bloco_b) - (bloco_a < bloco_b);
+}
+
+static int descarregar_shard(CacheBlocos *cache, ShardCacheBlocos *shard, LoteIO *lote) {
+    BlocoSujo *sujos = cache->sujos + cache->num_sujos;
+    size_t quantidade = 0;
+    for (size_t entrada = 0; entrada < shard->capacidade; entrada++) {
+        if (shard->entradas[entrada].valida && shard->entradas[entrada].suja) {
+            shard->entradas[entrada].descarregando = 1;
+            sujos[quantidade].bloco = shard->entradas[entrada].bloco;
+            sujos[quantidade].entrada = (int32_t)entrada;
+            quantidade++;
+        }
+    }
+    cache->num_sujos += quantidade;
+    qsort(sujos, quantidade, sizeof(BlocoSujo), comparar_blocos_sujos);
+    size_t i = 0;
+    while (i < quantidade) {
+        size_t fim = i + 1;
+        while (fim < quantidade && fim - i < CACHE_BLOCOS_MAX_VETORES && sujos[fim].bloco == sujos[fim - 1].bloco + 1) {
+            fim++;
+        }
+        for (size_t j = i; j < fim; j++) {
+            cache->vetores[j - i].iov_base = dados_entrada(cache, shard, sujos[j].entrada);
+            cache->vetores[j - i].iov_len = cache->tamanho_bloco;
+        }
+        off_t offset = cache->base + (off_t)sujos[i].bloco * cache->tamanho_bloco;
+        if (fila_io_escrever_vetor(lote, cache->vetores, (int)(fim - i), offset) < 0) {
+            return -ENOMEM;
+        }
+        i = fim;
+    }
+    return 0;
+}
+
+static void concluir_descarga(void *dados, int resultado) {
+    CacheBlocos *cache = dados;
+    for (size_t i = 0; i < cache->num_sujos; i++) {
+        ShardCacheBlocos *shard = shard_do_bloco(cache, cache->sujos[i].bloco);
+        EntradaCacheBlocos *entrada = &shard->entradas[cache->sujos[i].entrada];
+        pthread_mutex_lock(&shard->trava);
+        entrada->descarregando = 0;
+        if (resultado == 0) {
+            entrada->suja = 0;
+            shard->num_sujas--;
+        }
+        pthread_cond_broadcast(&shard->sinal_descarga);
+        pthread_mutex_unlock(&shard->trava);
+    }
+    cache->num_sujos = 0;
+    pthread_mutex_unlock(&cache->trava_descarga);
+}
+
+int cache_blocos_descarregar_em_lote(CacheBlocos *cache, LoteIO *lote) {
+    if (cache->num_shards == 0) {
+        return 0;
+    }
+    int resultado = 0;
+    pthread_mutex_lock(&cache->trava_descarga);
+    cache->num_sujos = 0;
+    for (size_t i = 0; i < cache->num_shards; i++) {
+        ShardCacheBlocos *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->trava);
+        if (resultado == 0 && shard->num_sujas > 0) {
+            resultado = descarregar_shard(cache, shard, lote);
+        }
+        pthread_mutex_unlock(&shard->trava);
+    }
+    if (fila_io_marcar(lote, concluir_descarga, cache) < 0) {
+        concluir_descarga(cache, -ENOMEM);
+        return -ENOMEM;
+    }
+    return resultado;
+}
+
+int cache_blocos_descarregar(CacheBlocos *cache) {
+    if (cache->num_shards == 0) {
+        return 0;
+    }
+    LoteIO lote;
+    fila_io_lote(&lote, cache->fila);
+    int resultado = cache_blocos_descarregar_em_lote(cache, &lote);
+    int resultado_lote = fila_io_executar(&lote);
+    return resultado < 0 ? resultado : resultado_lote;
+}
+
+void cache_blocos_contadores(CacheBlocos *cache, uint64_t *acertos, uint64_t *falhas) {
+    *acertos = 0;
+    *falhas = 0;
+    for (size_t i = 0; i < cache->num_shards; i++) {
+        ShardCacheBlocos *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->trava);
+        *acertos += shard->acertos;
+        *falhas += shard->falhas;
+        pthread_mutex_unlock(&shard->trava);
+    }
+}
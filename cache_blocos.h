@@ -0,0 +1,67 @@
+#ifndef CACHE_BLOCOS_H
+#define CACHE_BLOCOS_H
+
+#include "fila_io.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define CACHE_BLOCOS_SHARDS 16
+#define CACHE_BLOCOS_AGRUPAMENTO 8
+#define CACHE_BLOCOS_LIMITE_DIRETO 64
+#define CACHE_BLOCOS_MAX_VETORES 256
+
+typedef struct {
+    uint32_t bloco;
+    int32_t proxima;
+    uint8_t valida;
+    uint8_t referenciada;
+    uint8_t suja;
+    uint8_t descarregando;
+} EntradaCacheBlocos;
+
+typedef struct {
+    pthread_mutex_t trava;
+    pthread_cond_t sinal_descarga;
+    EntradaCacheBlocos *entradas;
+    char *dados;
+    int32_t *baldes;
+    size_t capacidade;
+    size_t mascara_baldes;
+    size_t ponteiro;
+    size_t num_sujas;
+    uint64_t acertos;
+    uint64_t falhas;
+} ShardCacheBlocos;
+
+typedef struct {
+    uint32_t bloco;
+    int32_t entrada;
+} BlocoSujo;
+
+typedef struct {
+    int fd;
+    FilaIO *fila;
+    off_t base;
+    size_t tamanho_bloco;
+    size_t num_shards;
+    ShardCacheBlocos *shards;
+    pthread_mutex_t trava_descarga;
+    BlocoSujo *sujos;
+    size_t num_sujos;
+    struct iovec *vetores;
+} CacheBlocos;
+
+int cache_blocos_iniciar(CacheBlocos *cache, FilaIO *fila, off_t base, size_t tamanho_bloco, size_t capacidade_bytes);
+void cache_blocos_destruir(CacheBlocos *cache);
+int cache_blocos_ler(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos, char *buffer);
+int cache_blocos_escrever(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos, const char *buffer);
+int cache_blocos_descarregar(CacheBlocos *cache);
+int cache_blocos_descarregar_em_lote(CacheBlocos *cache, LoteIO *lote);
+int cache_blocos_descarregar_intervalo(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos);
+void cache_blocos_invalidar(CacheBlocos *cache, uint32_t bloco_inicio, size_t num_blocos);
+void cache_blocos_contadores(CacheBlocos *cache, uint64_t *acertos, uint64_t *falhas);
+
+#endif
@@ -0,0 +1,105 @@
+#include "cache_dentries.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t hash_caminho(const char *caminho, size_t *tamanho) {
+    uint32_t hash = 2166136261u;
+    const char *inicio = caminho;
+    while (*caminho) {
+        hash ^= (uint8_t)*caminho++;
+        hash *= 16777619u;
+    }
+    *tamanho = caminho - inicio;
+    return hash;
+}
+
+static ShardCacheDentries *shard_do_hash(CacheDentries *cache, uint32_t hash) {
+    return &cache->shards[hash % CACHE_DENTRIES_SHARDS];
+}
+
+static EntradaCacheDentries *entrada_do_hash(ShardCacheDentries *shard, uint32_t hash) {
+    return &shard->entradas[(hash / CACHE_DENTRIES_SHARDS) & shard->mascara];
+}
+
+int cache_dentries_iniciar(CacheDentries *cache, size_t capacidade) {
+    size_t por_shard = 16;
+    while (por_shard * CACHE_DENTRIES_SHARDS < capacidade) {
+        por_shard *= 2;
+    }
+    memset(cache, 0, sizeof(CacheDentries));
+    cache->geracao = 1;
+    for (size_t i = 0; i < CACHE_DENTRIES_SHARDS; i++) {
+        ShardCacheDentries *shard = &cache->shards[i];
+        shard->entradas = calloc(por_shard, sizeof(EntradaCacheDentries));
+        if (!shard->entradas) {
+            cache_dentries_destruir(cache);
+            return -ENOMEM;
+        }
+        shard->mascara = por_shard - 1;
+        pthread_mutex_init(&shard->trava, NULL);
+    }
+    return 0;
+}
+
+void cache_dentries_destruir(CacheDentries *cache) {
+    for (size_t i = 0; i < CACHE_DENTRIES_SHARDS; i++) {
+        if (cache->shards[i].entradas) {
+            pthread_mutex_destroy(&cache->shards[i].trava);
+            free(cache->shards[i].entradas);
+        }
+    }
+    memset(cache, 0, sizeof(CacheDentries));
+}
+
+int32_t cache_dentries_buscar(CacheDentries *cache, const char *caminho) {
+    size_t tamanho;
+    uint32_t hash = hash_caminho(caminho, &tamanho);
+    if (tamanho >= CACHE_DENTRIES_MAX_CAMINHO || !cache->shards[0].entradas) {
+        return -1;
+    }
+    ShardCacheDentries *shard = shard_do_hash(cache, hash);
+    pthread_mutex_lock(&shard->trava);
+    EntradaCacheDentries *entrada = entrada_do_hash(shard, hash);
+    int32_t slot = -1;
+    if (entrada->geracao == cache->geracao && entrada->hash == hash && strcmp(entrada->caminho, caminho) == 0) {
+        slot = entrada->slot;
+    }
+    pthread_mutex_unlock(&shard->trava);
+    return slot;
+}
+
+void cache_dentries_inserir(CacheDentries *cache, const char *caminho, int32_t slot) {
+    size_t tamanho;
+    uint32_t hash = hash_caminho(caminho, &tamanho);
+    if (tamanho >= CACHE_DENTRIES_MAX_CAMINHO || !cache->shards[0].entradas) {
+        return;
+    }
+    ShardCacheDentries *shard = shard_do_hash(cache, hash);
+    pthread_mutex_lock(&shard->trava);
+    EntradaCacheDentries *entrada = entrada_do_hash(shard, hash);
+    entrada->geracao = cache->geracao;
+    entrada->hash = hash;
+    entrada->slot = slot;
+    memcpy(entrada->caminho, caminho, tamanho + 1);
+    pthread_mutex_unlock(&shard->trava);
+}
+
+void cache_dentries_remover(CacheDentries *cache, const char *caminho) {
+    size_t tamanho;
+    uint32_t hash = hash_caminho(caminho, &tamanho);
+    if (tamanho >= CACHE_DENTRIES_MAX_CAMINHO || !cache->shards[0].entradas) {
+        return;
+    }
+    ShardCacheDentries *shard = shard_do_hash(cache, hash);
+    pthread_mutex_lock(&shard->trava);
+    EntradaCacheDentries *entrada = entrada_do_hash(shard, hash);
+    if (entrada->hash == hash && strcmp(entrada->caminho, caminho) == 0) {
+        entrada->geracao = 0;
+    }
+    pthread_mutex_unlock(&shard->trava);
+}
+
+void cache_dentries_invalidar(CacheDentries *cache) {
+    cache->geracao++;
+}
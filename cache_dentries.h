@@ -0,0 +1,36 @@
+#ifndef CACHE_DENTRIES_H
+#define CACHE_DENTRIES_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_DENTRIES_SHARDS 16
+#define CACHE_DENTRIES_MAX_CAMINHO 120
+
+typedef struct {
+    uint64_t geracao;
+    uint32_t hash;
+    int32_t slot;
+    char caminho[CACHE_DENTRIES_MAX_CAMINHO];
+} EntradaCacheDentries;
+
+typedef struct {
+    pthread_mutex_t trava;
+    EntradaCacheDentries *entradas;
+    size_t mascara;
+} ShardCacheDentries;
+
+typedef struct {
+    ShardCacheDentries shards[CACHE_DENTRIES_SHARDS];
+    uint64_t geracao;
+} CacheDentries;
+
+int cache_dentries_iniciar(CacheDentries *cache, size_t capacidade);
+void cache_dentries_destruir(CacheDentries *cache);
+int32_t cache_dentries_buscar(CacheDentries *cache, const char *caminho);
+void cache_dentries_inserir(CacheDentries *cache, const char *caminho, int32_t slot);
+void cache_dentries_remover(CacheDentries *cache, const char *caminho);
+void cache_dentries_invalidar(CacheDentries *cache);
+
+#endif
@@ -0,0 +1,363 @@
+#include "espaco_livre.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { POR_INICIO = 0, POR_TAMANHO = 1 };
+
+struct NoEspacoLivre {
+    uint32_t inicio;
+    uint32_t tamanho;
+    NoEspacoLivre *filhos[2][2];
+    int altura[2];
+};
+
+void bitmap_marcar(uint8_t *bitmap, size_t inicio, size_t quantidade, int ocupado) {
+    size_t fim = inicio + quantidade;
+    while (inicio < fim && (inicio % 8) != 0) {
+        if (ocupado) {
+            bitmap[inicio / 8] |= (uint8_t)(1u << (inicio % 8));
+        } else {
+            bitmap[inicio / 8] &= (uint8_t)~(1u << (inicio % 8));
+        }
+        inicio++;
+    }
+    if (fim - inicio >= 8) {
+        memset(bitmap + inicio / 8, ocupado ? 0xFF : 0x00, (fim - inicio) / 8);
+        inicio += ((fim - inicio) / 8) * 8;
+    }
+    while (inicio < fim) {
+        if (ocupado) {
+            bitmap[inicio / 8] |= (uint8_t)(1u << (inicio % 8));
+        } else {
+            bitmap[inicio / 8] &= (uint8_t)~(1u << (inicio % 8));
+        }
+        inicio++;
+    }
+}
+
+size_t bitmap_proximo(const uint8_t *bitmap, size_t total_bits, size_t inicio, int ocupado) {
+    while (inicio < total_bits) {
+        if ((inicio % 64) == 0 && inicio + 64 <= total_bits) {
+            uint64_t palavra;
+            memcpy(&palavra, bitmap + inicio / 8, sizeof(palavra));
+            if (!ocupado) {
+                palavra = ~palavra;
+            }
+            if (palavra == 0) {
+                inicio += 64;
+                continue;
+            }
+            return inicio + __builtin_ctzll(palavra);
+        }
+        int bit = (bitmap[inicio / 8] >> (inicio % 8)) & 1;
+        if (bit == (ocupado ? 1 : 0)) {
+            return inicio;
+        }
+        inicio++;
+    }
+    return total_bits;
+}
+
+static int comparar(int arvore, const NoEspacoLivre *a, const NoEspacoLivre *b) {
+    if (arvore == POR_TAMANHO && a->tamanho != b->tamanho) {
+        return a->tamanho < b->tamanho ? -1 : 1;
+    }
+    if (a->inicio != b->inicio) {
+        return a->inicio < b->inicio ? -1 : 1;
+    }
+    return 0;
+}
+
+static int altura(int arvore, const NoEspacoLivre *no) {
+    return no ? no->altura[arvore] : 0;
+}
+
+static void atualizar_altura(int arvore, NoEspacoLivre *no) {
+    int esquerda = altura(arvore, no->filhos[arvore][0]);
+    int direita = altura(arvore, no->filhos[arvore][1]);
+    no->altura[arvore] = 1 + (esquerda > direita ? esquerda : direita);
+}
+
+static NoEspacoLivre *rotacionar(int arvore, NoEspacoLivre *no, int lado) {
+    NoEspacoLivre *filho = no->filhos[arvore][lado];
+    no->filhos[arvore][lado] = filho->filhos[arvore][!lado];
+    filho->filhos[arvore][!lado] = no;
+    atualizar_altura(arvore, no);
+    atualizar_altura(arvore, filho);
+    return filho;
+}
+
+static NoEspacoLivre *balancear(int arvore, NoEspacoLivre *no) {
+    atualizar_altura(arvore, no);
+    int fator = altura(arvore, no->filhos[arvore][0]) - altura(arvore, no->filhos[arvore][1]);
+    if (fator > 1) {
+        NoEspacoLivre *filho = no->filhos[arvore][0];
+        if (altura(arvore, filho->filhos[arvore][0]) < altura(arvore, filho->filhos[arvore][1])) {
+            no->filhos[arvore][0] = rotacionar(arvore, filho, 1);
+        }
+        return rotacionar(arvore, no, 0);
+    }
+    if (fator < -1) {
+        NoEspacoLivre *filho = no->filhos[arvore][1];
+        if (altura(arvore, filho->filhos[arvore][1]) < altura(arvore, filho->filhos[arvore][0])) {
+            no->filhos[arvore][1] = rotacionar(arvore, filho, 0);
+        }
+        return rotacionar(arvore, no, 1);
+    }
+    return no;
+}
+
+static NoEspacoLivre *inserir(int arvore, NoEspacoLivre *raiz, NoEspacoLivre *no) {
+    if (!raiz) {
+        no->filhos[arvore][0] = NULL;
+        no->filhos[arvore][1] = NULL;
+        no->altura[arvore] = 1;
+        return no;
+    }
+    int lado = comparar(arvore, no, raiz) > 0;
+    raiz->filhos[arvore][lado] = inserir(arvore, raiz->filhos[arvore][lado], no);
+    return balancear(arvore, raiz);
+}
+
+static NoEspacoLivre *remover_minimo(int arvore, NoEspacoLivre *raiz, NoEspacoLivre **minimo) {
+    if (!raiz->filhos[arvore][0]) {
+        *minimo = raiz;
+        return raiz->filhos[arvore][1];
+    }
+    raiz->filhos[arvore][0] = remover_minimo(arvore, raiz->filhos[arvore][0], minimo);
+    return balancear(arvore, raiz);
+}
+
+static NoEspacoLivre *remover(int arvore, NoEspacoLivre *raiz, NoEspacoLivre *no) {
+    if (!raiz) {
+        return NULL;
+    }
+    int comparacao = comparar(arvore, no, raiz);
+    if (comparacao != 0) {
+        int lado = comparacao > 0;
+        raiz->filhos[arvore][lado] = remover(arvore, raiz->filhos[arvore][lado], no);
+        return balancear(arvore, raiz);
+    }
+    NoEspacoLivre *esquerda = raiz->filhos[arvore][0];
+    NoEspacoLivre *direita = raiz->filhos[arvore][1];
+    if (!direita) {
+        return esquerda;
+    }
+    NoEspacoLivre *sucessor;
+    direita = remover_minimo(arvore, direita, &sucessor);
+    sucessor->filhos[arvore][0] = esquerda;
+    sucessor->filhos[arvore][1] = direita;
+    return balancear(arvore, sucessor);
+}
+
+static void inserir_no(IndiceLivre *indice, NoEspacoLivre *no) {
+    indice->raiz_inicio = inserir(POR_INICIO, indice->raiz_inicio, no);
+    indice->raiz_tamanho = inserir(POR_TAMANHO, indice->raiz_tamanho, no);
+}
+
+static void remover_no(IndiceLivre *indice, NoEspacoLivre *no) {
+    indice->raiz_inicio = remover(POR_INICIO, indice->raiz_inicio, no);
+    indice->raiz_tamanho = remover(POR_TAMANHO, indice->raiz_tamanho, no);
+}
+
+static NoEspacoLivre *buscar_inicio(const IndiceLivre *indice, uint32_t inicio) {
+    NoEspacoLivre *no = indice->raiz_inicio;
+    while (no && no->inicio != inicio) {
+        no = no->filhos[POR_INICIO][inicio > no->inicio];
+    }
+    return no;
+}
+
+static NoEspacoLivre *buscar_anterior(const IndiceLivre *indice, uint32_t inicio) {
+    NoEspacoLivre *no = indice->raiz_inicio;
+    NoEspacoLivre *candidato = NULL;
+    while (no) {
+        if (no->inicio < inicio) {
+            candidato = no;
+            no = no->filhos[POR_INICIO][1];
+        } else {
+            no = no->filhos[POR_INICIO][0];
+        }
+    }
+    return candidato;
+}
+
+static NoEspacoLivre *buscar_melhor_encaixe(IndiceLivre *indice, size_t desejados) {
+    NoEspacoLivre *no = indice->raiz_tamanho;
+    NoEspacoLivre *candidato = NULL;
+    uint64_t passos = 0;
+    while (no) {
+        passos++;
+        if (no->tamanho >= desejados) {
+            candidato = no;
+            no = no->filhos[POR_TAMANHO][0];
+        } else {
+            no = no->filhos[POR_TAMANHO][1];
+        }
+    }
+    indice->buscas++;
+    indice->passos_busca += passos;
+    if (passos > indice->maior_busca) {
+        indice->maior_busca = passos;
+    }
+    return candidato;
+}
+
+static NoEspacoLivre *buscar_maior(const IndiceLivre *indice) {
+    NoEspacoLivre *no = indice->raiz_tamanho;
+    while (no && no->filhos[POR_TAMANHO][1]) {
+        no = no->filhos[POR_TAMANHO][1];
+    }
+    return no;
+}
+
+static NoEspacoLivre *buscar_primeiro_encaixe(NoEspacoLivre *no, size_t desejados, uint32_t limite) {
+    if (!no) {
+        return NULL;
+    }
+    NoEspacoLivre *candidato = buscar_primeiro_encaixe(no->filhos[POR_INICIO][0], desejados, limite);
+    if (candidato || no->inicio >= limite) {
+        return candidato;
+    }
+    if (no->tamanho >= desejados) {
+        return no;
+    }
+    return buscar_primeiro_encaixe(no->filhos[POR_INICIO][1], desejados, limite);
+}
+
+static void contar_faixas(const NoEspacoLivre *no, size_t *contagens, size_t num_faixas) {
+    if (!no) {
+        return;
+    }
+    size_t faixa = 31 - (size_t)__builtin_clz(no->tamanho);
+    contagens[faixa < num_faixas ? faixa : num_faixas - 1]++;
+    contar_faixas(no->filhos[POR_INICIO][0], contagens, num_faixas);
+    contar_faixas(no->filhos[POR_INICIO][1], contagens, num_faixas);
+}
+
+static void consumir_inicio(IndiceLivre *indice, NoEspacoLivre *no, size_t quantidade) {
+    remover_no(indice, no);
+    indice->blocos_livres -= quantidade;
+    if (quantidade == no->tamanho) {
+        indice->num_extents--;
+        free(no);
+        return;
+    }
+    no->inicio += quantidade;
+    no->tamanho -= quantidade;
+    inserir_no(indice, no);
+}
+
+static void destruir_arvore(NoEspacoLivre *no) {
+    if (!no) {
+        return;
+    }
+    destruir_arvore(no->filhos[POR_INICIO][0]);
+    destruir_arvore(no->filhos[POR_INICIO][1]);
+    free(no);
+}
+
+int indice_livre_construir(IndiceLivre *indice, const uint8_t *bitmap, size_t total_blocos) {
+    memset(indice, 0, sizeof(IndiceLivre));
+    size_t bloco = 0;
+    while (bloco < total_blocos) {
+        bloco = bitmap_proximo(bitmap, total_blocos, bloco, 0);
+        if (bloco >= total_blocos) {
+            break;
+        }
+        size_t fim = bitmap_proximo(bitmap, total_blocos, bloco, 1);
+        if (indice_livre_devolver(indice, bloco, fim - bloco) < 0) {
+            indice_livre_destruir(indice);
+            return -ENOMEM;
+        }
+        bloco = fim;
+    }
+    return 0;
+}
+
+void indice_livre_destruir(IndiceLivre *indice) {
+    destruir_arvore(indice->raiz_inicio);
+    memset(indice, 0, sizeof(IndiceLivre));
+}
+
+uint32_t indice_livre_alocar(IndiceLivre *indice, size_t desejados, size_t *obtidos) {
+    NoEspacoLivre *no = buscar_melhor_encaixe(indice, desejados);
+    if (!no) {
+        no = buscar_maior(indice);
+    }
+    if (!no || desejados == 0) {
+        *obtidos = 0;
+        return UINT32_MAX;
+    }
+    uint32_t inicio = no->inicio;
+    *obtidos = no->tamanho < desejados ? no->tamanho : desejados;
+    consumir_inicio(indice, no, *obtidos);
+    return inicio;
+}
+
+size_t indice_livre_estender(IndiceLivre *indice, uint32_t inicio, size_t desejados) {
+    NoEspacoLivre *no = buscar_inicio(indice, inicio);
+    if (!no || desejados == 0) {
+        return 0;
+    }
+    size_t obtidos = no->tamanho < desejados ? no->tamanho : desejados;
+    consumir_inicio(indice, no, obtidos);
+    return obtidos;
+}
+
+int indice_livre_devolver(IndiceLivre *indice, uint32_t inicio, size_t quantidade) {
+    if (quantidade == 0) {
+        return 0;
+    }
+    NoEspacoLivre *anterior = buscar_anterior(indice, inicio);
+    if (anterior && anterior->inicio + anterior->tamanho != inicio) {
+        anterior = NULL;
+    }
+    NoEspacoLivre *posterior = buscar_inicio(indice, inicio + quantidade);
+    if (anterior && posterior) {
+        remover_no(indice, anterior);
+        remover_no(indice, posterior);
+        anterior->tamanho += quantidade + posterior->tamanho;
+        free(posterior);
+        indice->num_extents--;
+        inserir_no(indice, anterior);
+    } else if (anterior) {
+        remover_no(indice, anterior);
+        anterior->tamanho += quantidade;
+        inserir_no(indice, anterior);
+    } else if (posterior) {
+        remover_no(indice, posterior);
+        posterior->inicio = inicio;
+        posterior->tamanho += quantidade;
+        inserir_no(indice, posterior);
+    } else {
+        NoEspacoLivre *no = calloc(1, sizeof(NoEspacoLivre));
+        if (!no) {
+            return -ENOMEM;
+        }
+        no->inicio = inicio;
+        no->tamanho = quantidade;
+        inserir_no(indice, no);
+        indice->num_extents++;
+    }
+    indice->blocos_livres += quantidade;
+    return 0;
+}
+
+size_t indice_livre_maior(const IndiceLivre *indice) {
+    NoEspacoLivre *no = buscar_maior(indice);
+    return no ? no->tamanho : 0;
+}
+
+uint32_t indice_livre_primeiro_encaixe(const IndiceLivre *indice, size_t desejados, uint32_t limite) {
+    NoEspacoLivre *no = buscar_primeiro_encaixe(indice->raiz_inicio, desejados, limite);
+    return no ? no->inicio : UINT32_MAX;
+}
+
+void indice_livre_histograma(const IndiceLivre *indice, size_t *contagens, size_t num_faixas) {
+    memset(contagens, 0, num_faixas * sizeof(size_t));
+    if (num_faixas > 0) {
+        contar_faixas(indice->raiz_inicio, contagens, num_faixas);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef ESPACO_LIVRE_H
+#define ESPACO_LIVRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct NoEspacoLivre NoEspacoLivre;
+
+typedef struct {
+    NoEspacoLivre *raiz_inicio;
+    NoEspacoLivre *raiz_tamanho;
+    size_t num_extents;
+    size_t blocos_livres;
+    uint64_t buscas;
+    uint64_t passos_busca;
+    uint64_t maior_busca;
+} IndiceLivre;
+
+void bitmap_marcar(uint8_t *bitmap, size_t inicio, size_t quantidade, int ocupado);
+size_t bitmap_proximo(const uint8_t *bitmap, size_t total_bits, size_t inicio, int ocupado);
+
+int indice_livre_construir(IndiceLivre *indice, const uint8_t *bitmap, size_t total_blocos);
+void indice_livre_destruir(IndiceLivre *indice);
+uint32_t indice_livre_alocar(IndiceLivre *indice, size_t desejados, size_t *obtidos);
+size_t indice_livre_estender(IndiceLivre *indice, uint32_t inicio, size_t desejados);
+int indice_livre_devolver(IndiceLivre *indice, uint32_t inicio, size_t quantidade);
+size_t indice_livre_maior(const IndiceLivre *indice);
+uint32_t indice_livre_primeiro_encaixe(const IndiceLivre *indice, size_t desejados, uint32_t limite);
+void indice_livre_histograma(const IndiceLivre *indice, size_t *contagens, size_t num_faixas);
+
+#endif
@@ -0,0 +1,208 @@
+#include "estatisticas.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct BlocoEstatisticas {
+    Estatisticas dados;
+    struct BlocoEstatisticas *anterior;
+    struct BlocoEstatisticas *proximo;
+} BlocoEstatisticas;
+
+static const char *nomes_operacoes[ESTATISTICAS_NUM_OPERACOES] = {
+    "getattr", "readdir", "create", "unlink", "read", "write", "read_buf", "write_buf", "open", "truncate",
+    "utimens", "fsync", "flush", "release", "mkdir", "rmdir", "rename", "lseek", "fallocate", "lookup",
+    "forget", "setattr", "readdirplus",
+};
+
+static const char *nomes_contadores[ESTATISTICAS_NUM_CONTADORES] = {
+    "bytes_lidos", "bytes_escritos", "leituras_sem_copia", "escritas_sem_copia", "descargas_buffer",
+    "confirmacoes_metadados", "falhas_metadados", "checkpoints_journal",
+};
+
+static pthread_key_t chave_estatisticas;
+static pthread_once_t estatisticas_iniciadas = PTHREAD_ONCE_INIT;
+static pthread_mutex_t trava_blocos = PTHREAD_MUTEX_INITIALIZER;
+static BlocoEstatisticas *blocos;
+static Estatisticas encerradas;
+
+static void incrementar(uint64_t *contador, uint64_t valor) {
+    __atomic_store_n(contador, __atomic_load_n(contador, __ATOMIC_RELAXED) + valor, __ATOMIC_RELAXED);
+}
+
+static void somar(Estatisticas *destino, const Estatisticas *origem) {
+    for (int op = 0; op < ESTATISTICAS_NUM_OPERACOES; op++) {
+        SerieLatencia *serie = &destino->operacoes[op];
+        const SerieLatencia *parcial = &origem->operacoes[op];
+        serie->chamadas += __atomic_load_n(&parcial->chamadas, __ATOMIC_RELAXED);
+        serie->erros += __atomic_load_n(&parcial->erros, __ATOMIC_RELAXED);
+        serie->ns_total += __atomic_load_n(&parcial->ns_total, __ATOMIC_RELAXED);
+        uint64_t maximo = __atomic_load_n(&parcial->ns_maximo, __ATOMIC_RELAXED);
+        if (maximo > serie->ns_maximo) {
+            serie->ns_maximo = maximo;
+        }
+        for (int faixa = 0; faixa < ESTATISTICAS_FAIXAS; faixa++) {
+            serie->faixas[faixa] += __atomic_load_n(&parcial->faixas[faixa], __ATOMIC_RELAXED);
+        }
+    }
+    for (int contador = 0; contador < ESTATISTICAS_NUM_CONTADORES; contador++) {
+        destino->contadores[contador] += __atomic_load_n(&origem->contadores[contador], __ATOMIC_RELAXED);
+    }
+}
+
+static void encerrar_bloco(void *dados) {
+    BlocoEstatisticas *bloco = dados;
+    pthread_mutex_lock(&trava_blocos);
+    somar(&encerradas, &bloco->dados);
+    if (bloco->anterior) {
+        bloco->anterior->proximo = bloco->proximo;
+    } else {
+        blocos = bloco->proximo;
+    }
+    if (bloco->proximo) {
+        bloco->proximo->anterior = bloco->anterior;
+    }
+    pthread_mutex_unlock(&trava_blocos);
+    free(bloco);
+}
+
+static void criar_chave_estatisticas(void) {
+    pthread_key_create(&chave_estatisticas, encerrar_bloco);
+}
+
+static Estatisticas *estatisticas_thread(void) {
+    pthread_once(&estatisticas_iniciadas, criar_chave_estatisticas);
+    BlocoEstatisticas *bloco = pthread_getspecific(chave_estatisticas);
+    if (bloco) {
+        return &bloco->dados;
+    }
+    bloco = calloc(1, sizeof(BlocoEstatisticas));
+    if (!bloco || pthread_setspecific(chave_estatisticas, bloco) != 0) {
+        free(bloco);
+        return NULL;
+    }
+    pthread_mutex_lock(&trava_blocos);
+    bloco->proximo = blocos;
+    if (blocos) {
+        blocos->anterior = bloco;
+    }
+    blocos = bloco;
+    pthread_mutex_unlock(&trava_blocos);
+    return &bloco->dados;
+}
+
+static int faixa_latencia(uint64_t ns) {
+    if (ns < (UINT64_C(1) << ESTATISTICAS_BITS_SUBFAIXA)) {
+        return (int)ns;
+    }
+    int magnitude = 63 - __builtin_clzll(ns);
+    int subfaixa = (int)(ns >> (magnitude - ESTATISTICAS_BITS_SUBFAIXA)) & ((1 << ESTATISTICAS_BITS_SUBFAIXA) - 1);
+    int faixa = ((magnitude - ESTATISTICAS_BITS_SUBFAIXA + 1) << ESTATISTICAS_BITS_SUBFAIXA) + subfaixa;
+    return faixa < ESTATISTICAS_FAIXAS ? faixa : ESTATISTICAS_FAIXAS - 1;
+}
+
+static uint64_t inicio_faixa(int faixa) {
+    if (faixa < (1 << ESTATISTICAS_BITS_SUBFAIXA)) {
+        return (uint64_t)faixa;
+    }
+    int magnitude = (faixa >> ESTATISTICAS_BITS_SUBFAIXA) + ESTATISTICAS_BITS_SUBFAIXA - 1;
+    uint64_t subfaixa = (uint64_t)(faixa & ((1 << ESTATISTICAS_BITS_SUBFAIXA) - 1));
+    return ((UINT64_C(1) << ESTATISTICAS_BITS_SUBFAIXA) + subfaixa) << (magnitude - ESTATISTICAS_BITS_SUBFAIXA);
+}
+
+uint64_t estatisticas_relogio(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void estatisticas_registrar(SerieLatencia *serie, uint64_t decorrido, int erro) {
+    incrementar(&serie->chamadas, 1);
+    if (erro) {
+        incrementar(&serie->erros, 1);
+    }
+    incrementar(&serie->ns_total, decorrido);
+    if (decorrido > serie->ns_maximo) {
+        __atomic_store_n(&serie->ns_maximo, decorrido, __ATOMIC_RELAXED);
+    }
+    incrementar(&serie->faixas[faixa_latencia(decorrido)], 1);
+}
+
+void estatisticas_operacao(int operacao, uint64_t inicio, int64_t resultado) {
+    uint64_t decorrido = estatisticas_relogio() - inicio;
+    Estatisticas *estatisticas = estatisticas_thread();
+    if (estatisticas) {
+        estatisticas_registrar(&estatisticas->operacoes[operacao], decorrido, resultado < 0);
+    }
+}
+
+void estatisticas_contar(int contador, uint64_t valor) {
+    Estatisticas *estatisticas = estatisticas_thread();
+    if (estatisticas) {
+        incrementar(&estatisticas->contadores[contador], valor);
+    }
+}
+
+void estatisticas_coletar(Estatisticas *total) {
+    memset(total, 0, sizeof(Estatisticas));
+    pthread_mutex_lock(&trava_blocos);
+    somar(total, &encerradas);
+    for (BlocoEstatisticas *bloco = blocos; bloco; bloco = bloco->proximo) {
+        somar(total, &bloco->dados);
+    }
+    pthread_mutex_unlock(&trava_blocos);
+}
+
+uint64_t estatisticas_percentil(const SerieLatencia *serie, double fracao) {
+    uint64_t amostras = 0;
+    for (int faixa = 0; faixa < ESTATISTICAS_FAIXAS; faixa++) {
+        amostras += serie->faixas[faixa];
+    }
+    if (amostras == 0) {
+        return 0;
+    }
+    uint64_t alvo = (uint64_t)(fracao * (double)amostras + 0.5);
+    alvo = alvo == 0 ? 1 : alvo;
+    uint64_t acumuladas = 0;
+    for (int faixa = 0; faixa < ESTATISTICAS_FAIXAS - 1; faixa++) {
+        acumuladas += serie->faixas[faixa];
+        if (acumuladas >= alvo) {
+            uint64_t limite = inicio_faixa(faixa + 1) - 1;
+            return limite < serie->ns_maximo ? limite : serie->ns_maximo;
+        }
+    }
+    return serie->ns_maximo;
+}
+
+void estatisticas_escrever_json(FILE *saida, const Estatisticas *total) {
+    fprintf(saida, "  \"operacoes\": {");
+    for (int op = 0; op < ESTATISTICAS_NUM_OPERACOES; op++) {
+        const SerieLatencia *serie = &total->operacoes[op];
+        fprintf(saida,
+                "%s\n    \"%s\": {\"chamadas\": %llu, \"erros\": %llu, \"ns_total\": %llu, \"ns_medio\": %llu, "
+                "\"ns_maximo\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"histograma\": [",
+                op ? "," : "", nomes_operacoes[op], (unsigned long long)serie->chamadas,
+                (unsigned long long)serie->erros, (unsigned long long)serie->ns_total,
+                (unsigned long long)(serie->chamadas ? serie->ns_total / serie->chamadas : 0),
+                (unsigned long long)serie->ns_maximo, (unsigned long long)estatisticas_percentil(serie, 0.5),
+                (unsigned long long)estatisticas_percentil(serie, 0.9),
+                (unsigned long long)estatisticas_percentil(serie, 0.99),
+                (unsigned long long)estatisticas_percentil(serie, 0.999));
+        int primeira = 1;
+        for (int faixa = 0; faixa < ESTATISTICAS_FAIXAS; faixa++) {
+            if (serie->faixas[faixa]) {
+                fprintf(saida, "%s[%llu, %llu]", primeira ? "" : ", ", (unsigned long long)inicio_faixa(faixa),
+                        (unsigned long long)serie->faixas[faixa]);
+                primeira = 0;
+            }
+        }
+        fprintf(saida, "]}");
+    }
+    fprintf(saida, "\n  },\n  \"contadores\": {");
+    for (int contador = 0; contador < ESTATISTICAS_NUM_CONTADORES; contador++) {
+        fprintf(saida, "%s\n    \"%s\": %llu", contador ? "," : "", nomes_contadores[contador],
+                (unsigned long long)total->contadores[contador]);
+    }
+    fprintf(saida, "\n  }");
+}
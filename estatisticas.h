@@ -0,0 +1,71 @@
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ESTATISTICAS_BITS_SUBFAIXA 3
+#define ESTATISTICAS_MAGNITUDE_MAXIMA 40
+#define ESTATISTICAS_FAIXAS ((ESTATISTICAS_MAGNITUDE_MAXIMA - ESTATISTICAS_BITS_SUBFAIXA + 2) << ESTATISTICAS_BITS_SUBFAIXA)
+
+enum {
+    ESTATISTICAS_OP_GETATTR,
+    ESTATISTICAS_OP_READDIR,
+    ESTATISTICAS_OP_CREATE,
+    ESTATISTICAS_OP_UNLINK,
+    ESTATISTICAS_OP_READ,
+    ESTATISTICAS_OP_WRITE,
+    ESTATISTICAS_OP_READ_BUF,
+    ESTATISTICAS_OP_WRITE_BUF,
+    ESTATISTICAS_OP_OPEN,
+    ESTATISTICAS_OP_TRUNCATE,
+    ESTATISTICAS_OP_UTIMENS,
+    ESTATISTICAS_OP_FSYNC,
+    ESTATISTICAS_OP_FLUSH,
+    ESTATISTICAS_OP_RELEASE,
+    ESTATISTICAS_OP_MKDIR,
+    ESTATISTICAS_OP_RMDIR,
+    ESTATISTICAS_OP_RENAME,
+    ESTATISTICAS_OP_LSEEK,
+    ESTATISTICAS_OP_FALLOCATE,
+    ESTATISTICAS_OP_LOOKUP,
+    ESTATISTICAS_OP_FORGET,
+    ESTATISTICAS_OP_SETATTR,
+    ESTATISTICAS_OP_READDIRPLUS,
+    ESTATISTICAS_NUM_OPERACOES
+};
+
+enum {
+    ESTATISTICAS_BYTES_LIDOS,
+    ESTATISTICAS_BYTES_ESCRITOS,
+    ESTATISTICAS_LEITURAS_SEM_COPIA,
+    ESTATISTICAS_ESCRITAS_SEM_COPIA,
+    ESTATISTICAS_DESCARGAS_BUFFER,
+    ESTATISTICAS_CONFIRMACOES_METADADOS,
+    ESTATISTICAS_FALHAS_METADADOS,
+    ESTATISTICAS_CHECKPOINTS_JOURNAL,
+    ESTATISTICAS_NUM_CONTADORES
+};
+
+typedef struct {
+    uint64_t chamadas;
+    uint64_t erros;
+    uint64_t ns_total;
+    uint64_t ns_maximo;
+    uint64_t faixas[ESTATISTICAS_FAIXAS];
+} SerieLatencia;
+
+typedef struct {
+    SerieLatencia operacoes[ESTATISTICAS_NUM_OPERACOES];
+    uint64_t contadores[ESTATISTICAS_NUM_CONTADORES];
+} Estatisticas;
+
+uint64_t estatisticas_relogio(void);
+void estatisticas_registrar(SerieLatencia *serie, uint64_t decorrido, int erro);
+void estatisticas_operacao(int operacao, uint64_t inicio, int64_t resultado);
+void estatisticas_contar(int contador, uint64_t valor);
+void estatisticas_coletar(Estatisticas *total);
+uint64_t estatisticas_percentil(const SerieLatencia *serie, double fracao);
+void estatisticas_escrever_json(FILE *saida, const Estatisticas *total);
+
+#endif
@@ -0,0 +1,449 @@
+#include "fila_io.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef BMPFS_IO_URING
+#define BMPFS_IO_URING 0
+#endif
+
+#if BMPFS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define FILA_IO_PENDENTE INT64_MIN
+
+static int escrever_completo(int fd, const void *buffer, size_t tamanho, off_t offset) {
+    const char *origem = buffer;
+    while (tamanho > 0) {
+        ssize_t escritos = pwrite(fd, origem, tamanho, offset);
+        if (escritos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (escritos <= 0) {
+            return -EIO;
+        }
+        origem += escritos;
+        tamanho -= escritos;
+        offset += escritos;
+    }
+    return 0;
+}
+
+static int escrever_sincrono(LoteIO *lote, const OperacaoIO *operacao) {
+    const struct iovec *vetores = &lote->vetores[operacao->primeiro_vetor];
+    ssize_t escritos = pwritev(lote->fila->fd, vetores, operacao->num_vetores, operacao->offset);
+    if (escritos == (ssize_t)operacao->tamanho) {
+        return 0;
+    }
+    off_t offset = operacao->offset;
+    for (int i = 0; i < operacao->num_vetores; i++) {
+        if (escrever_completo(lote->fila->fd, vetores[i].iov_base, vetores[i].iov_len, offset) < 0) {
+            return -EIO;
+        }
+        offset += (off_t)vetores[i].iov_len;
+    }
+    return 0;
+}
+
+static int sincronizar_sincrono(LoteIO *lote, const OperacaoIO *operacao) {
+    int resultado = operacao->datasync ? fdatasync(lote->fila->fd) : fsync(lote->fila->fd);
+    return resultado == 0 ? 0 : -EIO;
+}
+
+static void processar_sincrono(LoteIO *lote, OperacaoIO *operacao) {
+    if (operacao->tipo == FILA_IO_MARCO) {
+        operacao->conclusao(operacao->dados, lote->erro);
+    } else if (lote->erro == 0) {
+        lote->erro = operacao->tipo == FILA_IO_ESCRITA ? escrever_sincrono(lote, operacao)
+                                                       : sincronizar_sincrono(lote, operacao);
+    }
+}
+
+#if BMPFS_IO_URING
+static int repetivel(int64_t resultado) {
+    return resultado == -ECANCELED || resultado == -EINTR || resultado == -EAGAIN;
+}
+
+static void finalizar_operacao(LoteIO *lote, OperacaoIO *operacao) {
+    if (operacao->tipo == FILA_IO_MARCO) {
+        operacao->conclusao(operacao->dados, lote->erro);
+        return;
+    }
+    if (lote->erro != 0) {
+        return;
+    }
+    if (operacao->tipo == FILA_IO_ESCRITA) {
+        if (operacao->resultado == (int64_t)operacao->tamanho) {
+            return;
+        }
+        lote->erro = operacao->resultado >= 0 || repetivel(operacao->resultado) ? escrever_sincrono(lote, operacao)
+                                                                               : -EIO;
+        return;
+    }
+    if (operacao->resultado != 0) {
+        lote->erro = repetivel(operacao->resultado) ? sincronizar_sincrono(lote, operacao) : -EIO;
+    }
+}
+
+static int iniciar_anel(FilaIO *fila, unsigned int profundidade) {
+    struct io_uring_params parametros;
+    memset(&parametros, 0, sizeof(parametros));
+    int anel = (int)syscall(__NR_io_uring_setup, profundidade, &parametros);
+    if (anel < 0) {
+        return -errno;
+    }
+    fila->tamanho_mapa_submissao = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned int);
+    fila->tamanho_mapa_conclusao = parametros.cq_off.cqes + parametros.cq_entries * sizeof(struct io_uring_cqe);
+    int mapa_unico = (parametros.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (mapa_unico && fila->tamanho_mapa_conclusao > fila->tamanho_mapa_submissao) {
+        fila->tamanho_mapa_submissao = fila->tamanho_mapa_conclusao;
+    }
+    fila->tamanho_entradas = parametros.sq_entries * sizeof(struct io_uring_sqe);
+    void *submissao = mmap(NULL, fila->tamanho_mapa_submissao, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           anel, IORING_OFF_SQ_RING);
+    void *conclusao = mapa_unico ? submissao
+                                 : mmap(NULL, fila->tamanho_mapa_conclusao, PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, anel, IORING_OFF_CQ_RING);
+    void *entradas = mmap(NULL, fila->tamanho_entradas, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, anel,
+                          IORING_OFF_SQES);
+    if (submissao == MAP_FAILED || conclusao == MAP_FAILED || entradas == MAP_FAILED) {
+        if (entradas != MAP_FAILED) {
+            munmap(entradas, fila->tamanho_entradas);
+        }
+        if (!mapa_unico && conclusao != MAP_FAILED) {
+            munmap(conclusao, fila->tamanho_mapa_conclusao);
+        }
+        if (submissao != MAP_FAILED) {
+            munmap(submissao, fila->tamanho_mapa_submissao);
+        }
+        close(anel);
+        return -ENOMEM;
+    }
+    fila->mapa_submissao = submissao;
+    fila->mapa_conclusao = mapa_unico ? NULL : conclusao;
+    fila->entradas = entradas;
+    fila->submissao_cauda = (unsigned int *)((char *)submissao + parametros.sq_off.tail);
+    fila->submissao_mascara = (unsigned int *)((char *)submissao + parametros.sq_off.ring_mask);
+    fila->submissao_indices = (unsigned int *)((char *)submissao + parametros.sq_off.array);
+    fila->conclusao_cabeca = (unsigned int *)((char *)conclusao + parametros.cq_off.head);
+    fila->conclusao_cauda = (unsigned int *)((char *)conclusao + parametros.cq_off.tail);
+    fila->conclusao_mascara = (unsigned int *)((char *)conclusao + parametros.cq_off.ring_mask);
+    fila->conclusoes = (char *)conclusao + parametros.cq_off.cqes;
+    fila->profundidade = parametros.sq_entries;
+    fila->entradas_conclusao = parametros.cq_entries;
+    fila->anel = anel;
+    return 0;
+}
+
+static void encerrar_anel(FilaIO *fila) {
+    munmap(fila->entradas, fila->tamanho_entradas);
+    if (fila->mapa_conclusao) {
+        munmap(fila->mapa_conclusao, fila->tamanho_mapa_conclusao);
+    }
+    munmap(fila->mapa_submissao, fila->tamanho_mapa_submissao);
+    close(fila->anel);
+}
+
+static size_t colher(FilaIO *fila) {
+    unsigned int cabeca = *fila->conclusao_cabeca;
+    unsigned int cauda = __atomic_load_n(fila->conclusao_cauda, __ATOMIC_ACQUIRE);
+    size_t colhidas = 0;
+    while (cabeca != cauda) {
+        struct io_uring_cqe *conclusao = &((struct io_uring_cqe *)fila->conclusoes)[cabeca & *fila->conclusao_mascara];
+        OperacaoIO *operacao = (OperacaoIO *)(uintptr_t)conclusao->user_data;
+        operacao->resultado = conclusao->res;
+        cabeca++;
+        colhidas++;
+    }
+    __atomic_store_n(fila->conclusao_cabeca, cabeca, __ATOMIC_RELEASE);
+    fila->em_voo -= (unsigned int)colhidas;
+    return colhidas;
+}
+
+static void aguardar_progresso(FilaIO *fila) {
+    if (fila->colhendo) {
+        pthread_cond_wait(&fila->progresso, &fila->trava);
+        return;
+    }
+    fila->colhendo = 1;
+    if (colher(fila) == 0 && fila->em_voo > 0) {
+        pthread_mutex_unlock(&fila->trava);
+        syscall(__NR_io_uring_enter, fila->anel, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        pthread_mutex_lock(&fila->trava);
+        colher(fila);
+    }
+    fila->colhendo = 0;
+    pthread_cond_broadcast(&fila->progresso);
+}
+
+static void preparar_entrada(FilaIO *fila, LoteIO *lote, OperacaoIO *operacao, int ligar) {
+    unsigned int cauda = *fila->submissao_cauda;
+    unsigned int indice = cauda & *fila->submissao_mascara;
+    struct io_uring_sqe *entrada = &((struct io_uring_sqe *)fila->entradas)[indice];
+    memset(entrada, 0, sizeof(struct io_uring_sqe));
+    entrada->fd = fila->fd;
+    if (operacao->tipo == FILA_IO_ESCRITA) {
+        entrada->opcode = IORING_OP_WRITEV;
+        entrada->addr = (uintptr_t)&lote->vetores[operacao->primeiro_vetor];
+        entrada->len = (unsigned int)operacao->num_vetores;
+        entrada->off = (uint64_t)operacao->offset;
+    } else {
+        entrada->opcode = IORING_OP_FSYNC;
+        entrada->fsync_flags = operacao->datasync ? IORING_FSYNC_DATASYNC : 0;
+    }
+    entrada->flags = ligar ? IOSQE_IO_LINK : 0;
+    entrada->user_data = (uintptr_t)operacao;
+    operacao->resultado = FILA_IO_PENDENTE;
+    fila->submissao_indices[indice] = indice;
+    __atomic_store_n(fila->submissao_cauda, cauda + 1, __ATOMIC_RELEASE);
+}
+
+static size_t submeter(LoteIO *lote, size_t inicio) {
+    FilaIO *fila = lote->fila;
+    size_t fim = inicio;
+    unsigned int quantidade = 0;
+    while (fim < lote->quantidade && quantidade < fila->profundidade) {
+        quantidade += lote->operacoes[fim].tipo != FILA_IO_MARCO;
+        fim++;
+    }
+    if (quantidade == 0) {
+        return fim;
+    }
+    pthread_mutex_lock(&fila->trava);
+    while (fila->em_voo + quantidade > fila->entradas_conclusao) {
+        aguardar_progresso(fila);
+    }
+    unsigned int restantes = quantidade;
+    for (size_t i = inicio; i < fim; i++) {
+        if (lote->operacoes[i].tipo != FILA_IO_MARCO) {
+            preparar_entrada(fila, lote, &lote->operacoes[i], --restantes > 0);
+        }
+    }
+    unsigned int submetidas = 0;
+    while (submetidas < quantidade) {
+        int resultado = (int)syscall(__NR_io_uring_enter, fila->anel, quantidade - submetidas, 0, 0, NULL, 0);
+        if (resultado < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            continue;
+        }
+        if (resultado <= 0) {
+            break;
+        }
+        submetidas += (unsigned int)resultado;
+    }
+    *fila->submissao_cauda -= quantidade - submetidas;
+    fila->em_voo += submetidas;
+    fila->submissoes++;
+    fila->operacoes += submetidas;
+    unsigned int ignoradas = 0;
+    for (size_t i = inicio; i < fim; i++) {
+        if (lote->operacoes[i].tipo != FILA_IO_MARCO && ++ignoradas > submetidas) {
+            lote->operacoes[i].resultado = -ECANCELED;
+        }
+    }
+    pthread_mutex_unlock(&fila->trava);
+    return fim;
+}
+
+static void aguardar_operacao(FilaIO *fila, OperacaoIO *operacao) {
+    pthread_mutex_lock(&fila->trava);
+    while (operacao->resultado == FILA_IO_PENDENTE) {
+        aguardar_progresso(fila);
+    }
+    pthread_mutex_unlock(&fila->trava);
+}
+
+static void executar_anel(LoteIO *lote) {
+    size_t proxima = 0;
+    for (size_t i = 0; i < lote->quantidade; i++) {
+        if (i == proxima) {
+            proxima = submeter(lote, i);
+        }
+        OperacaoIO *operacao = &lote->operacoes[i];
+        if (operacao->tipo != FILA_IO_MARCO) {
+            aguardar_operacao(lote->fila, operacao);
+        }
+        finalizar_operacao(lote, operacao);
+    }
+}
+#endif
+
+int fila_io_iniciar(FilaIO *fila, int fd, unsigned int profundidade) {
+    memset(fila, 0, sizeof(FilaIO));
+    fila->fd = fd;
+    fila->anel = -1;
+    pthread_mutex_init(&fila->trava, NULL);
+    pthread_cond_init(&fila->progresso, NULL);
+    if (profundidade == 0) {
+        return 0;
+    }
+#if BMPFS_IO_URING
+    return iniciar_anel(fila, profundidade > FILA_IO_PROFUNDIDADE_MAXIMA ? FILA_IO_PROFUNDIDADE_MAXIMA : profundidade);
+#else
+    return -ENOSYS;
+#endif
+}
+
+void fila_io_destruir(FilaIO *fila) {
+#if BMPFS_IO_URING
+    if (fila->anel >= 0) {
+        encerrar_anel(fila);
+    }
+#endif
+    fila->anel = -1;
+    pthread_cond_destroy(&fila->progresso);
+    pthread_mutex_destroy(&fila->trava);
+}
+
+int fila_io_assincrona(const FilaIO *fila) {
+    return fila->anel >= 0;
+}
+
+void fila_io_contadores(FilaIO *fila, uint64_t *submissoes, uint64_t *operacoes) {
+    pthread_mutex_lock(&fila->trava);
+    *submissoes = fila->submissoes;
+    *operacoes = fila->operacoes;
+    pthread_mutex_unlock(&fila->trava);
+}
+
+void fila_io_lote(LoteIO *lote, FilaIO *fila) {
+    memset(lote, 0, sizeof(LoteIO));
+    lote->fila = fila;
+}
+
+static OperacaoIO *nova_operacao(LoteIO *lote, int tipo) {
+    if (lote->quantidade == lote->capacidade) {
+        size_t capacidade = lote->capacidade ? lote->capacidade * 2 : 16;
+        OperacaoIO *operacoes = realloc(lote->operacoes, capacidade * sizeof(OperacaoIO));
+        if (!operacoes) {
+            lote->erro = -ENOMEM;
+            return NULL;
+        }
+        lote->operacoes = operacoes;
+        lote->capacidade = capacidade;
+    }
+    OperacaoIO *operacao = &lote->operacoes[lote->quantidade++];
+    memset(operacao, 0, sizeof(OperacaoIO));
+    operacao->tipo = tipo;
+    operacao->lote = lote;
+    return operacao;
+}
+
+int fila_io_escrever(LoteIO *lote, const void *dados, size_t tamanho, off_t offset) {
+    struct iovec vetor = { (void *)dados, tamanho };
+    return fila_io_escrever_vetor(lote, &vetor, 1, offset);
+}
+
+int fila_io_escrever_vetor(LoteIO *lote, const struct iovec *vetores, int quantidade, off_t offset) {
+    if (quantidade <= 0) {
+        return 0;
+    }
+    size_t necessario = lote->num_vetores + (size_t)quantidade;
+    if (necessario > lote->capacidade_vetores) {
+        size_t capacidade = lote->capacidade_vetores ? lote->capacidade_vetores : 16;
+        while (capacidade < necessario) {
+            capacidade *= 2;
+        }
+        struct iovec *novos = realloc(lote->vetores, capacidade * sizeof(struct iovec));
+        if (!novos) {
+            lote->erro = -ENOMEM;
+            return -ENOMEM;
+        }
+        lote->vetores = novos;
+        lote->capacidade_vetores = capacidade;
+    }
+    OperacaoIO *operacao = nova_operacao(lote, FILA_IO_ESCRITA);
+    if (!operacao) {
+        return -ENOMEM;
+    }
+    operacao->primeiro_vetor = lote->num_vetores;
+    operacao->num_vetores = quantidade;
+    operacao->offset = offset;
+    for (int i = 0; i < quantidade; i++) {
+        lote->vetores[lote->num_vetores++] = vetores[i];
+        operacao->tamanho += vetores[i].iov_len;
+    }
+    return 0;
+}
+
+int fila_io_sincronizar(LoteIO *lote, int datasync) {
+    for (size_t i = lote->quantidade; i > 0; i--) {
+        OperacaoIO *anterior = &lote->operacoes[i - 1];
+        if (anterior->tipo == FILA_IO_MARCO) {
+            continue;
+        }
+        if (anterior->tipo == FILA_IO_SINCRONIZACAO && (!anterior->datasync || datasync)) {
+            return 0;
+        }
+        break;
+    }
+    OperacaoIO *operacao = nova_operacao(lote, FILA_IO_SINCRONIZACAO);
+    if (!operacao) {
+        return -ENOMEM;
+    }
+    operacao->datasync = datasync;
+    return 0;
+}
+
+int fila_io_marcar(LoteIO *lote, ConclusaoMarcoIO conclusao, void *dados) {
+    OperacaoIO *operacao = nova_operacao(lote, FILA_IO_MARCO);
+    if (!operacao) {
+        return -ENOMEM;
+    }
+    operacao->conclusao = conclusao;
+    operacao->dados = dados;
+    return 0;
+}
+
+int fila_io_adotar(LoteIO *lote, void *buffer) {
+    if (lote->num_adotados == lote->capacidade_adotados) {
+        size_t capacidade = lote->capacidade_adotados ? lote->capacidade_adotados * 2 : 16;
+        void **adotados = realloc(lote->adotados, capacidade * sizeof(void *));
+        if (!adotados) {
+            free(buffer);
+            lote->erro = -ENOMEM;
+            return -ENOMEM;
+        }
+        lote->adotados = adotados;
+        lote->capacidade_adotados = capacidade;
+    }
+    lote->adotados[lote->num_adotados++] = buffer;
+    return 0;
+}
+
+int fila_io_executar(LoteIO *lote) {
+#if BMPFS_IO_URING
+    if (fila_io_assincrona(lote->fila) && lote->erro == 0) {
+        executar_anel(lote);
+    } else
+#endif
+    {
+        for (size_t i = 0; i < lote->quantidade; i++) {
+            processar_sincrono(lote, &lote->operacoes[i]);
+        }
+    }
+    int resultado = lote->erro;
+    fila_io_descartar(lote);
+    return resultado;
+}
+
+void fila_io_descartar(LoteIO *lote) {
+    for (size_t i = 0; i < lote->num_adotados; i++) {
+        free(lote->adotados[i]);
+    }
+    free(lote->operacoes);
+    free(lote->vetores);
+    free(lote->adotados);
+    lote->operacoes = NULL;
+    lote->vetores = NULL;
+    lote->adotados = NULL;
+    lote->num_adotados = 0;
+    lote->capacidade_adotados = 0;
+    lote->quantidade = 0;
+    lote->capacidade = 0;
+    lote->num_vetores = 0;
+    lote->capacidade_vetores = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef FILA_IO_H
+#define FILA_IO_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define FILA_IO_PROFUNDIDADE_MAXIMA 4096
+
+enum {
+    FILA_IO_ESCRITA,
+    FILA_IO_SINCRONIZACAO,
+    FILA_IO_MARCO
+};
+
+typedef void (*ConclusaoMarcoIO)(void *dados, int resultado);
+
+typedef struct LoteIO LoteIO;
+
+typedef struct {
+    int tipo;
+    int datasync;
+    size_t primeiro_vetor;
+    int num_vetores;
+    off_t offset;
+    size_t tamanho;
+    int64_t resultado;
+    ConclusaoMarcoIO conclusao;
+    void *dados;
+    LoteIO *lote;
+} OperacaoIO;
+
+typedef struct {
+    int fd;
+    int anel;
+    unsigned int profundidade;
+    unsigned int entradas_conclusao;
+    unsigned int em_voo;
+    int colhendo;
+    pthread_mutex_t trava;
+    pthread_cond_t progresso;
+    void *mapa_submissao;
+    size_t tamanho_mapa_submissao;
+    void *mapa_conclusao;
+    size_t tamanho_mapa_conclusao;
+    void *entradas;
+    size_t tamanho_entradas;
+    unsigned int *submissao_cauda;
+    unsigned int *submissao_mascara;
+    unsigned int *submissao_indices;
+    unsigned int *conclusao_cabeca;
+    unsigned int *conclusao_cauda;
+    unsigned int *conclusao_mascara;
+    void *conclusoes;
+    uint64_t submissoes;
+    uint64_t operacoes;
+} FilaIO;
+
+struct LoteIO {
+    FilaIO *fila;
+    OperacaoIO *operacoes;
+    size_t quantidade;
+    size_t capacidade;
+    struct iovec *vetores;
+    size_t num_vetores;
+    size_t capacidade_vetores;
+    void **adotados;
+    size_t num_adotados;
+    size_t capacidade_adotados;
+    int erro;
+};
+
+int fila_io_iniciar(FilaIO *fila, int fd, unsigned int profundidade);
+void fila_io_destruir(FilaIO *fila);
+int fila_io_assincrona(const FilaIO *fila);
+void fila_io_contadores(FilaIO *fila, uint64_t *submissoes, uint64_t *operacoes);
+
+void fila_io_lote(LoteIO *lote, FilaIO *fila);
+int fila_io_escrever(LoteIO *lote, const void *dados, size_t tamanho, off_t offset);
+int fila_io_escrever_vetor(LoteIO *lote, const struct iovec *vetores, int quantidade, off_t offset);
+int fila_io_sincronizar(LoteIO *lote, int datasync);
+int fila_io_marcar(LoteIO *lote, ConclusaoMarcoIO conclusao, void *dados);
+int fila_io_adotar(LoteIO *lote, void *buffer);
+int fila_io_executar(LoteIO *lote);
+void fila_io_descartar(LoteIO *lote);
+
+#endif
@@ -0,0 +1,223 @@
+#include "formato.h"
+#include "journal.h"
+#include "lsb.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/random.h>
+#include <unistd.h>
+
+static uint64_t alinhar(uint64_t valor, uint64_t alinhamento) {
+    return (valor + alinhamento - 1) / alinhamento * alinhamento;
+}
+
+static int potencia_de_dois(uint32_t valor) {
+    return valor != 0 && (valor & (valor - 1)) == 0;
+}
+
+static uint64_t gerar_identificador(void) {
+    uint64_t identificador = 0;
+    if (getrandom(&identificador, sizeof(identificador), 0) != (ssize_t)sizeof(identificador)) {
+        struct timespec agora;
+        clock_gettime(CLOCK_REALTIME, &agora);
+        identificador = ((uint64_t)agora.tv_sec << 32) ^ (uint64_t)agora.tv_nsec ^ ((uint64_t)getpid() << 16);
+    }
+    return identificador ? identificador : 1;
+}
+
+_Static_assert(sizeof(SuperblocoBMPFS) <= BMPFS_TAMANHO_SUPERBLOCO, "superbloco excede a área reservada");
+
+int formato_calcular(SuperblocoBMPFS *superbloco, size_t deslocamento_dados, size_t tamanho_dados,
+                     uint32_t tamanho_bloco, uint32_t max_arquivos, uint32_t bits_lsb) {
+    if (!potencia_de_dois(tamanho_bloco) || tamanho_bloco < BMPFS_BLOCO_MINIMO || tamanho_bloco > BMPFS_BLOCO_MAXIMO ||
+        max_arquivos == 0 || (bits_lsb != 0 && !lsb_bits_validos(bits_lsb))) {
+        return -EINVAL;
+    }
+    memset(superbloco, 0, sizeof(SuperblocoBMPFS));
+    superbloco->bits_lsb = bits_lsb;
+    uint64_t fator = formato_fator_portadora(superbloco);
+    uint64_t tamanho_portadora = (uint64_t)tamanho_bloco * fator;
+    uint64_t tamanho_journal = (tamanho_dados / 16 / fator) & ~(uint64_t)(BMPFS_ALINHAMENTO_AREAS - 1);
+    if (tamanho_journal > BMPFS_TAMANHO_JOURNAL) {
+        tamanho_journal = BMPFS_TAMANHO_JOURNAL;
+    }
+    if (tamanho_journal <= JOURNAL_TAMANHO_CABECALHO * 2) {
+        return -ENOSPC;
+    }
+    uint64_t total_blocos = tamanho_dados / tamanho_portadora;
+    if (total_blocos >= UINT32_MAX) {
+        total_blocos = UINT32_MAX - 1;
+    }
+    for (;;) {
+        if (total_blocos == 0) {
+            return -ENOSPC;
+        }
+        superbloco->offset_bitmap = BMPFS_TAMANHO_SUPERBLOCO;
+        superbloco->offset_tabela = alinhar(superbloco->offset_bitmap + (total_blocos + 7) / 8, 8);
+        superbloco->offset_journal = alinhar(superbloco->offset_tabela + (uint64_t)max_arquivos * sizeof(MetadadosArquivo),
+                                             BMPFS_ALINHAMENTO_AREAS);
+        uint64_t fim_metadados = deslocamento_dados + (superbloco->offset_journal + tamanho_journal) * fator;
+        superbloco->offset_dados = alinhar(fim_metadados, BMPFS_ALINHAMENTO_AREAS) - deslocamento_dados;
+        if (superbloco->offset_dados >= tamanho_dados) {
+            return -ENOSPC;
+        }
+        uint64_t cabem = (tamanho_dados - superbloco->offset_dados) / tamanho_portadora;
+        if (cabem >= total_blocos) {
+            break;
+        }
+        total_blocos = cabem;
+    }
+    superbloco->magico = BMPFS_MAGICO;
+    superbloco->versao = BMPFS_VERSAO;
+    superbloco->tamanho_bloco = tamanho_bloco;
+    superbloco->max_arquivos = max_arquivos;
+    superbloco->total_blocos = total_blocos;
+    superbloco->tamanho_journal = tamanho_journal;
+    superbloco->tamanho_dados = tamanho_dados;
+    superbloco->criado = time(NULL);
+    superbloco->identificador = gerar_identificador();
+    superbloco->entradas_por_grupo = BMPFS_GRUPO_INODES_MINIMO;
+    while (superbloco->entradas_por_grupo < BMPFS_GRUPO_INODES_MAXIMO &&
+           (uint64_t)superbloco->entradas_por_grupo * BMPFS_MAX_GRUPOS_INODES < total_blocos) {
+        superbloco->entradas_por_grupo *= 2;
+    }
+    return 0;
+}
+
+uint64_t formato_fator_portadora(const SuperblocoBMPFS *superbloco) {
+    return superbloco->bits_lsb ? 8 / superbloco->bits_lsb : 1;
+}
+
+uint32_t formato_blocos_grupo_inodes(const SuperblocoBMPFS *superbloco) {
+    uint64_t bytes = (uint64_t)superbloco->entradas_por_grupo * sizeof(MetadadosArquivo);
+    return (uint32_t)((bytes + superbloco->tamanho_bloco - 1) / superbloco->tamanho_bloco);
+}
+
+uint64_t formato_capacidade_inodes(const SuperblocoBMPFS *superbloco) {
+    if (superbloco->bits_lsb) {
+        return superbloco->max_arquivos + (uint64_t)superbloco->num_grupos_inodes * superbloco->entradas_por_grupo;
+    }
+    uint64_t grupos = superbloco->total_blocos / formato_blocos_grupo_inodes(superbloco);
+    if (grupos > BMPFS_MAX_GRUPOS_INODES) {
+        grupos = BMPFS_MAX_GRUPOS_INODES;
+    }
+    if (grupos < superbloco->num_grupos_inodes) {
+        grupos = superbloco->num_grupos_inodes;
+    }
+    return superbloco->max_arquivos + grupos * superbloco->entradas_por_grupo;
+}
+
+uint64_t formato_deslocamento_entrada(const SuperblocoBMPFS *superbloco, uint64_t idx) {
+    if (idx < superbloco->max_arquivos) {
+        return superbloco->offset_tabela + idx * sizeof(MetadadosArquivo);
+    }
+    uint64_t relativo = idx - superbloco->max_arquivos;
+    uint32_t bloco = superbloco->grupos_inodes[relativo / superbloco->entradas_por_grupo];
+    return superbloco->offset_dados + (uint64_t)bloco * superbloco->tamanho_bloco * formato_fator_portadora(superbloco) +
+           (relativo % superbloco->entradas_por_grupo) * sizeof(MetadadosArquivo);
+}
+
+uint64_t formato_entradas_contiguas(const SuperblocoBMPFS *superbloco, uint64_t idx) {
+    if (idx < superbloco->max_arquivos) {
+        return superbloco->max_arquivos - idx;
+    }
+    return superbloco->entradas_por_grupo - (idx - superbloco->max_arquivos) % superbloco->entradas_por_grupo;
+}
+
+int formato_validar(const SuperblocoBMPFS *superbloco, size_t tamanho_dados) {
+    if (superbloco->magico != BMPFS_MAGICO) {
+        return -EINVAL;
+    }
+    if (superbloco->versao != BMPFS_VERSAO) {
+        return -EPROTONOSUPPORT;
+    }
+    if (!potencia_de_dois(superbloco->tamanho_bloco) || superbloco->tamanho_bloco < BMPFS_BLOCO_MINIMO ||
+        superbloco->tamanho_bloco > BMPFS_BLOCO_MAXIMO || superbloco->max_arquivos == 0 ||
+        superbloco->tamanho_dados > tamanho_dados || superbloco->total_blocos == 0 ||
+        superbloco->total_blocos >= UINT32_MAX ||
+        (superbloco->bits_lsb != 0 && !lsb_bits_validos(superbloco->bits_lsb)) ||
+        superbloco->entradas_por_grupo < BMPFS_GRUPO_INODES_MINIMO ||
+        superbloco->entradas_por_grupo > BMPFS_GRUPO_INODES_MAXIMO ||
+        superbloco->num_grupos_inodes > BMPFS_MAX_GRUPOS_INODES) {
+        return -EUCLEAN;
+    }
+    if (superbloco->offset_bitmap < BMPFS_TAMANHO_SUPERBLOCO ||
+        superbloco->offset_tabela < superbloco->offset_bitmap + (superbloco->total_blocos + 7) / 8 ||
+        superbloco->offset_journal < superbloco->offset_tabela + (uint64_t)superbloco->max_arquivos * sizeof(MetadadosArquivo) ||
+        superbloco->offset_dados < (superbloco->offset_journal + superbloco->tamanho_journal) *
+                                   formato_fator_portadora(superbloco) ||
+        superbloco->offset_dados + superbloco->total_blocos * superbloco->tamanho_bloco *
+                                   formato_fator_portadora(superbloco) > superbloco->tamanho_dados) {
+        return -EUCLEAN;
+    }
+    uint32_t blocos_grupo = formato_blocos_grupo_inodes(superbloco);
+    for (uint32_t g = 0; g < superbloco->num_grupos_inodes; g++) {
+        if ((uint64_t)superbloco->grupos_inodes[g] + blocos_grupo > superbloco->total_blocos) {
+            return -EUCLEAN;
+        }
+    }
+    return 0;
+}
+
+int formato_ler_superbloco(int fd, off_t deslocamento_dados, size_t tamanho_dados, SuperblocoBMPFS *superbloco) {
+    static const unsigned int bits_possiveis[] = {1, 2, 4};
+    for (size_t i = 0; i < sizeof(bits_possiveis) / sizeof(bits_possiveis[0]); i++) {
+        unsigned int bits = bits_possiveis[i];
+        if (lsb_tamanho_portadora(sizeof(SuperblocoBMPFS), bits) <= tamanho_dados &&
+            lsb_ler_portadora(fd, superbloco, sizeof(SuperblocoBMPFS), deslocamento_dados, bits) == 0 &&
+            superbloco->magico == BMPFS_MAGICO && superbloco->bits_lsb == bits) {
+            return formato_validar(superbloco, tamanho_dados);
+        }
+    }
+    ssize_t lidos = pread(fd, superbloco, sizeof(SuperblocoBMPFS), deslocamento_dados);
+    if (lidos < 0) {
+        return -errno;
+    }
+    if ((size_t)lidos != sizeof(SuperblocoBMPFS)) {
+        return -EINVAL;
+    }
+    return formato_validar(superbloco, tamanho_dados);
+}
+
+static int escrever_zeros(int fd, off_t offset, uint64_t tamanho, unsigned int bits_lsb) {
+    static const char zeros[64 * 1024];
+    while (tamanho > 0) {
+        size_t parte = tamanho < sizeof(zeros) ? tamanho : sizeof(zeros);
+        if (bits_lsb) {
+            if (lsb_escrever_portadora(fd, zeros, parte, offset, bits_lsb) < 0) {
+                return -EIO;
+            }
+            offset += (off_t)lsb_tamanho_portadora(parte, bits_lsb);
+            tamanho -= parte;
+            continue;
+        }
+        ssize_t escritos = pwrite(fd, zeros, parte, offset);
+        if (escritos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (escritos <= 0) {
+            return -EIO;
+        }
+        offset += escritos;
+        tamanho -= escritos;
+    }
+    return 0;
+}
+
+int formato_escrever(int fd, off_t deslocamento_dados, const SuperblocoBMPFS *superbloco) {
+    uint64_t fim_zeros = superbloco->offset_journal + superbloco->tamanho_journal;
+    unsigned int bits = superbloco->bits_lsb;
+    if (escrever_zeros(fd, deslocamento_dados, fim_zeros, bits) < 0 || fdatasync(fd) != 0) {
+        return -EIO;
+    }
+    int resultado;
+    if (bits) {
+        resultado = lsb_escrever_portadora(fd, superbloco, sizeof(SuperblocoBMPFS), deslocamento_dados, bits);
+    } else {
+        resultado = pwrite(fd, superbloco, sizeof(SuperblocoBMPFS), deslocamento_dados) ==
+                    (ssize_t)sizeof(SuperblocoBMPFS) ? 0 : -EIO;
+    }
+    if (resultado < 0 || fdatasync(fd) != 0) {
+        return -EIO;
+    }
+    return 0;
+}
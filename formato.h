@@ -0,0 +1,99 @@
+#ifndef FORMATO_H
+#define FORMATO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define BMPFS_MAGICO 0x53465042u
+#define BMPFS_VERSAO 8
+#define BMPFS_TAMANHO_SUPERBLOCO 4096
+#define BMPFS_ALINHAMENTO_AREAS 4096
+#define BMPFS_BLOCO_MINIMO 512
+#define BMPFS_BLOCO_MAXIMO (1024 * 1024)
+#define BMPFS_TAMANHO_BLOCO_PADRAO 4096
+#define BMPFS_MAX_ARQUIVOS_PADRAO 1000
+#define BMPFS_TAMANHO_JOURNAL (1024 * 1024)
+#define BMPFS_EXTENTS_INLINE 4
+#define BMPFS_TAMANHO_INLINE 128
+#define BMPFS_PAI_RAIZ UINT32_MAX
+#define BMPFS_PAI_ORFAO (UINT32_MAX - 1)
+#define BMPFS_BURACO UINT32_MAX
+#define BMPFS_EXTENT_NAO_ESCRITO 0x1u
+#define BMPFS_MAX_GRUPOS_INODES 960
+#define BMPFS_GRUPO_INODES_MINIMO 256
+#define BMPFS_GRUPO_INODES_MAXIMO 65536
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t magico;
+    uint32_t versao;
+    uint32_t tamanho_bloco;
+    uint32_t max_arquivos;
+    uint64_t total_blocos;
+    uint64_t offset_bitmap;
+    uint64_t offset_tabela;
+    uint64_t offset_journal;
+    uint64_t tamanho_journal;
+    uint64_t offset_dados;
+    uint64_t tamanho_dados;
+    int64_t criado;
+    uint64_t identificador;
+    uint32_t bits_lsb;
+    uint32_t entradas_por_grupo;
+    uint32_t num_grupos_inodes;
+    uint32_t grupos_inodes[BMPFS_MAX_GRUPOS_INODES];
+} SuperblocoBMPFS;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t bloco_inicio;
+    uint32_t num_blocos;
+    uint32_t sinalizadores;
+} ExtentArquivo;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t proximo_bloco;
+    uint32_t quantidade;
+} CabecalhoBlocoExtents;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct {
+    char nome_arquivo[256];
+    size_t tamanho;
+    time_t criado;
+    time_t modificado;
+    time_t acessado;
+    union {
+        ExtentArquivo extents[BMPFS_EXTENTS_INLINE];
+        char dados_inline[BMPFS_TAMANHO_INLINE];
+    };
+    uint32_t num_extents;
+    uint32_t bloco_extents;
+    uint32_t num_blocos;
+    mode_t modo;
+    uid_t uid;
+    gid_t gid;
+    uint8_t eh_diretorio;
+    uint32_t pai;
+    uint8_t em_linha;
+} MetadadosArquivo;
+#pragma pack(pop)
+
+int formato_calcular(SuperblocoBMPFS *superbloco, size_t deslocamento_dados, size_t tamanho_dados,
+                     uint32_t tamanho_bloco, uint32_t max_arquivos, uint32_t bits_lsb);
+uint64_t formato_fator_portadora(const SuperblocoBMPFS *superbloco);
+uint32_t formato_blocos_grupo_inodes(const SuperblocoBMPFS *superbloco);
+uint64_t formato_capacidade_inodes(const SuperblocoBMPFS *superbloco);
+uint64_t formato_deslocamento_entrada(const SuperblocoBMPFS *superbloco, uint64_t idx);
+uint64_t formato_entradas_contiguas(const SuperblocoBMPFS *superbloco, uint64_t idx);
+int formato_validar(const SuperblocoBMPFS *superbloco, size_t tamanho_dados);
+int formato_ler_superbloco(int fd, off_t deslocamento_dados, size_t tamanho_dados, SuperblocoBMPFS *superbloco);
+int formato_escrever(int fd, off_t deslocamento_dados, const SuperblocoBMPFS *superbloco);
+
+#endif
@@ -0,0 +1,128 @@
+#include "indice_nomes.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_VAZIO (-1)
+#define SLOT_REMOVIDO (-2)
+
+uint32_t indice_nomes_hash(const char *nome) {
+    uint32_t hash = 2166136261u;
+    while (*nome) {
+        hash ^= (uint8_t)*nome++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static EntradaIndiceNomes *alocar_entradas(size_t capacidade) {
+    EntradaIndiceNomes *entradas = malloc(capacidade * sizeof(EntradaIndiceNomes));
+    if (!entradas) {
+        return NULL;
+    }
+    for (size_t i = 0; i < capacidade; i++) {
+        entradas[i].hash = 0;
+        entradas[i].slot = SLOT_VAZIO;
+    }
+    return entradas;
+}
+
+int indice_nomes_inicializar(IndiceNomes *indice, size_t capacidade_minima) {
+    size_t capacidade = 16;
+    while (capacidade < capacidade_minima * 2) {
+        capacidade *= 2;
+    }
+    indice->entradas = alocar_entradas(capacidade);
+    if (!indice->entradas) {
+        return -ENOMEM;
+    }
+    indice->capacidade = capacidade;
+    indice->ocupados = 0;
+    indice->removidos = 0;
+    return 0;
+}
+
+void indice_nomes_destruir(IndiceNomes *indice) {
+    free(indice->entradas);
+    memset(indice, 0, sizeof(IndiceNomes));
+}
+
+static void inserir_sem_verificar(EntradaIndiceNomes *entradas, size_t capacidade, uint32_t hash, int32_t slot) {
+    size_t mascara = capacidade - 1;
+    size_t posicao = hash & mascara;
+    while (entradas[posicao].slot >= 0) {
+        posicao = (posicao + 1) & mascara;
+    }
+    entradas[posicao].hash = hash;
+    entradas[posicao].slot = slot;
+}
+
+static int redimensionar(IndiceNomes *indice, size_t capacidade) {
+    EntradaIndiceNomes *entradas = alocar_entradas(capacidade);
+    if (!entradas) {
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < indice->capacidade; i++) {
+        if (indice->entradas[i].slot >= 0) {
+            inserir_sem_verificar(entradas, capacidade, indice->entradas[i].hash, indice->entradas[i].slot);
+        }
+    }
+    free(indice->entradas);
+    indice->entradas = entradas;
+    indice->capacidade = capacidade;
+    indice->removidos = 0;
+    return 0;
+}
+
+int32_t indice_nomes_buscar(const IndiceNomes *indice, uint32_t hash, const char *nome,
+                            comparar_nome_fn comparar, void *contexto) {
+    size_t mascara = indice->capacidade - 1;
+    size_t posicao = hash & mascara;
+    while (indice->entradas[posicao].slot != SLOT_VAZIO) {
+        const EntradaIndiceNomes *entrada = &indice->entradas[posicao];
+        if (entrada->slot >= 0 && entrada->hash == hash && comparar(contexto, entrada->slot, nome) == 0) {
+            return entrada->slot;
+        }
+        posicao = (posicao + 1) & mascara;
+    }
+    return -1;
+}
+
+int indice_nomes_inserir(IndiceNomes *indice, uint32_t hash, int32_t slot) {
+    if ((indice->ocupados + indice->removidos + 1) * 2 > indice->capacidade) {
+        size_t capacidade = indice->capacidade;
+        if ((indice->ocupados + 1) * 2 > capacidade / 2) {
+            capacidade *= 2;
+        }
+        int resultado = redimensionar(indice, capacidade);
+        if (resultado < 0) {
+            return resultado;
+        }
+    }
+    size_t mascara = indice->capacidade - 1;
+    size_t posicao = hash & mascara;
+    while (indice->entradas[posicao].slot >= 0) {
+        posicao = (posicao + 1) & mascara;
+    }
+    if (indice->entradas[posicao].slot == SLOT_REMOVIDO) {
+        indice->removidos--;
+    }
+    indice->entradas[posicao].hash = hash;
+    indice->entradas[posicao].slot = slot;
+    indice->ocupados++;
+    return 0;
+}
+
+void indice_nomes_remover(IndiceNomes *indice, uint32_t hash, int32_t slot) {
+    size_t mascara = indice->capacidade - 1;
+    size_t posicao = hash & mascara;
+    while (indice->entradas[posicao].slot != SLOT_VAZIO) {
+        if (indice->entradas[posicao].slot == slot && indice->entradas[posicao].hash == hash) {
+            indice->entradas[posicao].slot = SLOT_REMOVIDO;
+            indice->ocupados--;
+            indice->removidos++;
+            return;
+        }
+        posicao = (posicao + 1) & mascara;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef INDICE_NOMES_H
+#define INDICE_NOMES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int (*comparar_nome_fn)(void *contexto, int32_t slot, const char *nome);
+
+typedef struct {
+    uint32_t hash;
+    int32_t slot;
+} EntradaIndiceNomes;
+
+typedef struct {
+    EntradaIndiceNomes *entradas;
+    size_t capacidade;
+    size_t ocupados;
+    size_t removidos;
+} IndiceNomes;
+
+uint32_t indice_nomes_hash(const char *nome);
+int indice_nomes_inicializar(IndiceNomes *indice, size_t capacidade_minima);
+void indice_nomes_destruir(IndiceNomes *indice);
+int32_t indice_nomes_buscar(const IndiceNomes *indice, uint32_t hash, const char *nome,
+                            comparar_nome_fn comparar, void *contexto);
+int indice_nomes_inserir(IndiceNomes *indice, uint32_t hash, int32_t slot);
+void indice_nomes_remover(IndiceNomes *indice, uint32_t hash, int32_t slot);
+
+#endif
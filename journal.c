@@ -0,0 +1,412 @@
+#include "journal.h"
+#include "lsb.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t tabela_crc[256];
+
+static void preparar_tabela_crc(void) {
+    if (tabela_crc[1] != 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t valor = i;
+        for (int bit = 0; bit < 8; bit++) {
+            valor = (valor & 1) ? (valor >> 1) ^ 0xEDB88320u : valor >> 1;
+        }
+        tabela_crc[i] = valor;
+    }
+}
+
+static uint32_t calcular_crc(const void *dados, size_t tamanho) {
+    const uint8_t *bytes = dados;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < tamanho; i++) {
+        crc = tabela_crc[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static int ler_completo(int fd, void *buffer, size_t tamanho, off_t offset) {
+    char *destino = buffer;
+    while (tamanho > 0) {
+        ssize_t lidos = pread(fd, destino, tamanho, offset);
+        if (lidos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (lidos <= 0) {
+            return -EIO;
+        }
+        destino += lidos;
+        tamanho -= lidos;
+        offset += lidos;
+    }
+    return 0;
+}
+
+static uint64_t posicao_log(const Journal *journal, uint64_t posicao) {
+    return journal->inicio_regiao + JOURNAL_TAMANHO_CABECALHO + posicao;
+}
+
+static off_t deslocamento_fisico(const Journal *journal, uint64_t deslocamento) {
+    if (journal->bits_lsb) {
+        deslocamento = lsb_tamanho_portadora(deslocamento, journal->bits_lsb);
+    }
+    return journal->base_home + (off_t)deslocamento;
+}
+
+static int ler_regiao(Journal *journal, void *destino, size_t tamanho, uint64_t deslocamento) {
+    off_t offset = deslocamento_fisico(journal, deslocamento);
+    if (journal->bits_lsb) {
+        return lsb_ler_portadora(journal->fd, destino, tamanho, offset, journal->bits_lsb);
+    }
+    return ler_completo(journal->fd, destino, tamanho, offset);
+}
+
+static int escrever_regiao(Journal *journal, LoteIO *lote, const void *dados, size_t tamanho, uint64_t deslocamento) {
+    off_t offset = deslocamento_fisico(journal, deslocamento);
+    if (!journal->bits_lsb) {
+        return fila_io_escrever(lote, dados, tamanho, offset);
+    }
+    size_t tamanho_portadora = lsb_tamanho_portadora(tamanho, journal->bits_lsb);
+    uint8_t *portadora = malloc(tamanho_portadora ? tamanho_portadora : 1);
+    if (!portadora) {
+        return -ENOMEM;
+    }
+    if (lsb_preparar_portadora(journal->fd, portadora, dados, tamanho, offset, journal->bits_lsb) < 0) {
+        free(portadora);
+        return -EIO;
+    }
+    if (fila_io_adotar(lote, portadora) < 0) {
+        return -ENOMEM;
+    }
+    return fila_io_escrever(lote, portadora, tamanho_portadora, offset);
+}
+
+static int gravar_cabecalho(Journal *journal, LoteIO *lote, uint64_t seq_inicio, uint64_t posicao_inicio) {
+    CabecalhoJournal *cabecalho = &journal->cabecalho;
+    cabecalho->magico = JOURNAL_MAGICO;
+    cabecalho->versao = JOURNAL_VERSAO;
+    cabecalho->seq_inicio = seq_inicio;
+    cabecalho->posicao_inicio = posicao_inicio;
+    cabecalho->identificador = journal->identificador;
+    cabecalho->crc = calcular_crc(cabecalho, offsetof(CabecalhoJournal, crc));
+    int resultado = escrever_regiao(journal, lote, cabecalho, sizeof(CabecalhoJournal), journal->inicio_regiao);
+    if (resultado < 0) {
+        return resultado;
+    }
+    return fila_io_sincronizar(lote, 1);
+}
+
+static int enfileirar_registros(Journal *journal, LoteIO *lote, const char *dados, size_t tamanho) {
+    size_t posicao = 0;
+    while (posicao + sizeof(RegistroJournal) <= tamanho) {
+        RegistroJournal registro;
+        memcpy(&registro, dados + posicao, sizeof(registro));
+        posicao += sizeof(registro);
+        if (registro.tamanho > tamanho - posicao) {
+            return -EIO;
+        }
+        int resultado = escrever_regiao(journal, lote, dados + posicao, registro.tamanho, registro.deslocamento);
+        if (resultado < 0) {
+            return resultado;
+        }
+        posicao += registro.tamanho;
+    }
+    return 0;
+}
+
+static int ler_transacao(Journal *journal, uint64_t posicao, uint64_t seq, char **dados, size_t *tamanho) {
+    CabecalhoTransacao cabecalho;
+    if (posicao + sizeof(cabecalho) > journal->tamanho_log ||
+        ler_regiao(journal, &cabecalho, sizeof(cabecalho), posicao_log(journal, posicao)) < 0) {
+        return -1;
+    }
+    if (cabecalho.magico != JOURNAL_MAGICO_TRANSACAO || cabecalho.seq != seq ||
+        cabecalho.identificador != journal->identificador ||
+        cabecalho.tamanho > journal->tamanho_log - posicao - sizeof(cabecalho)) {
+        return -1;
+    }
+    char *buffer = malloc(cabecalho.tamanho ? cabecalho.tamanho : 1);
+    if (!buffer) {
+        return -1;
+    }
+    if (ler_regiao(journal, buffer, cabecalho.tamanho, posicao_log(journal, posicao + sizeof(cabecalho))) < 0 ||
+        calcular_crc(buffer, cabecalho.tamanho) != cabecalho.crc) {
+        free(buffer);
+        return -1;
+    }
+    *dados = buffer;
+    *tamanho = cabecalho.tamanho;
+    return 0;
+}
+
+static int reproduzir(Journal *journal, uint64_t seq, uint64_t posicao) {
+    int aplicadas = 0;
+    for (;;) {
+        char *dados;
+        size_t tamanho;
+        if (ler_transacao(journal, posicao, seq, &dados, &tamanho) < 0) {
+            if (posicao == 0 || ler_transacao(journal, 0, seq, &dados, &tamanho) < 0) {
+                break;
+            }
+            posicao = 0;
+        }
+        LoteIO lote;
+        fila_io_lote(&lote, journal->fila);
+        int resultado = enfileirar_registros(journal, &lote, dados, tamanho);
+        if (resultado == 0) {
+            resultado = fila_io_executar(&lote);
+        } else {
+            fila_io_descartar(&lote);
+        }
+        free(dados);
+        if (resultado < 0) {
+            return resultado;
+        }
+        posicao += sizeof(CabecalhoTransacao) + tamanho;
+        seq++;
+        aplicadas++;
+    }
+    journal->proxima_seq = seq;
+    return aplicadas;
+}
+
+int journal_abrir(Journal *journal, FilaIO *fila, off_t base_home, uint64_t inicio_regiao, size_t tamanho_regiao,
+                  uint64_t identificador, unsigned int bits_lsb) {
+    preparar_tabela_crc();
+    memset(journal, 0, sizeof(Journal));
+    if (tamanho_regiao <= JOURNAL_TAMANHO_CABECALHO * 2) {
+        return -EINVAL;
+    }
+    journal->fd = fila->fd;
+    journal->fila = fila;
+    journal->inicio_regiao = inicio_regiao;
+    journal->tamanho_log = tamanho_regiao - JOURNAL_TAMANHO_CABECALHO;
+    journal->base_home = base_home;
+    journal->identificador = identificador;
+    journal->bits_lsb = bits_lsb;
+    journal->proxima_seq = 1;
+    CabecalhoJournal cabecalho;
+    if (ler_regiao(journal, &cabecalho, sizeof(cabecalho), inicio_regiao) < 0) {
+        return -EIO;
+    }
+    int aplicadas = 0;
+    if (cabecalho.magico == JOURNAL_MAGICO && cabecalho.versao == JOURNAL_VERSAO &&
+        cabecalho.crc == calcular_crc(&cabecalho, offsetof(CabecalhoJournal, crc)) &&
+        cabecalho.identificador == identificador &&
+        cabecalho.posicao_inicio < journal->tamanho_log) {
+        aplicadas = reproduzir(journal, cabecalho.seq_inicio, cabecalho.posicao_inicio);
+        if (aplicadas < 0) {
+            return aplicadas;
+        }
+    }
+    LoteIO lote;
+    fila_io_lote(&lote, fila);
+    if (aplicadas > 0) {
+        fila_io_sincronizar(&lote, 1);
+    }
+    gravar_cabecalho(journal, &lote, journal->proxima_seq, 0);
+    return fila_io_executar(&lote) < 0 ? -EIO : 0;
+}
+
+void journal_fechar(Journal *journal) {
+    journal_checkpoint(journal);
+    free(journal->transacao);
+    journal->transacao = NULL;
+    journal->capacidade_transacao = 0;
+    journal->tamanho_transacao = 0;
+}
+
+static int garantir_capacidade(Journal *journal, size_t adicional) {
+    size_t necessario = journal->tamanho_transacao + adicional;
+    if (journal->tamanho_transacao == 0) {
+        necessario += sizeof(CabecalhoTransacao);
+    }
+    if (necessario <= journal->capacidade_transacao) {
+        return 0;
+    }
+    size_t capacidade = journal->capacidade_transacao ? journal->capacidade_transacao : 4096;
+    while (capacidade < necessario) {
+        capacidade *= 2;
+    }
+    char *transacao = realloc(journal->transacao, capacidade);
+    if (!transacao) {
+        return -ENOMEM;
+    }
+    journal->transacao = transacao;
+    journal->capacidade_transacao = capacidade;
+    return 0;
+}
+
+int journal_adicionar(Journal *journal, uint64_t deslocamento, const void *dados, size_t tamanho) {
+    if (garantir_capacidade(journal, sizeof(RegistroJournal) + tamanho) < 0) {
+        return -ENOMEM;
+    }
+    if (journal->tamanho_transacao == 0) {
+        journal->tamanho_transacao = sizeof(CabecalhoTransacao);
+    }
+    RegistroJournal registro = { .deslocamento = deslocamento, .tamanho = tamanho };
+    memcpy(journal->transacao + journal->tamanho_transacao, &registro, sizeof(registro));
+    journal->tamanho_transacao += sizeof(registro);
+    memcpy(journal->transacao + journal->tamanho_transacao, dados, tamanho);
+    journal->tamanho_transacao += tamanho;
+    journal->registros_transacao++;
+    return 0;
+}
+
+void journal_descartar(Journal *journal) {
+    journal->tamanho_transacao = 0;
+    journal->registros_transacao = 0;
+}
+
+size_t journal_espaco_transacao(const Journal *journal) {
+    size_t atual = journal->tamanho_transacao ? journal->tamanho_transacao : sizeof(CabecalhoTransacao);
+    size_t limite = journal->tamanho_log / 2;
+    return atual + sizeof(RegistroJournal) < limite ? limite - 1 - atual - sizeof(RegistroJournal) : 0;
+}
+
+static int reservar_espaco(Journal *journal, size_t tamanho, uint64_t *posicao) {
+    if (tamanho >= journal->tamanho_log / 2) {
+        return -E2BIG;
+    }
+    if (!journal->pendentes) {
+        *posicao = journal->cabeca + tamanho <= journal->tamanho_log ? journal->cabeca : 0;
+        return 0;
+    }
+    uint64_t cauda = journal->pendentes->posicao;
+    if (journal->cabeca > cauda) {
+        if (journal->cabeca + tamanho <= journal->tamanho_log) {
+            *posicao = journal->cabeca;
+            return 0;
+        }
+        if (tamanho < cauda) {
+            *posicao = 0;
+            return 0;
+        }
+        return -ENOSPC;
+    }
+    if (journal->cabeca + tamanho < cauda) {
+        *posicao = journal->cabeca;
+        return 0;
+    }
+    return -ENOSPC;
+}
+
+static void concluir_transacao(void *dados, int resultado) {
+    Journal *journal = dados;
+    TransacaoPendente *pendente = journal->confirmando;
+    journal->confirmando = NULL;
+    if (resultado < 0 || !pendente) {
+        free(pendente);
+        journal_descartar(journal);
+        return;
+    }
+    pendente->dados = journal->transacao;
+    pendente->tamanho = journal->tamanho_transacao;
+    pendente->proxima = NULL;
+    if (journal->ultima_pendente) {
+        journal->ultima_pendente->proxima = pendente;
+    } else {
+        journal->pendentes = pendente;
+    }
+    journal->ultima_pendente = pendente;
+    journal->bytes_pendentes += journal->tamanho_transacao;
+    journal->cabeca = pendente->posicao + journal->tamanho_transacao;
+    journal->proxima_seq++;
+    journal->transacao = NULL;
+    journal->capacidade_transacao = 0;
+    journal_descartar(journal);
+}
+
+int journal_confirmar_em_lote(Journal *journal, LoteIO *lote) {
+    if (journal->registros_transacao == 0) {
+        return 0;
+    }
+    size_t tamanho_dados = journal->tamanho_transacao - sizeof(CabecalhoTransacao);
+    uint64_t posicao;
+    int resultado = reservar_espaco(journal, journal->tamanho_transacao, &posicao);
+    if (resultado == -ENOSPC) {
+        resultado = journal_checkpoint(journal);
+        if (resultado == 0) {
+            resultado = reservar_espaco(journal, journal->tamanho_transacao, &posicao);
+        }
+    }
+    if (resultado < 0) {
+        journal_descartar(journal);
+        return resultado;
+    }
+    CabecalhoTransacao cabecalho = {
+        .magico = JOURNAL_MAGICO_TRANSACAO,
+        .num_registros = journal->registros_transacao,
+        .seq = journal->proxima_seq,
+        .tamanho = tamanho_dados,
+        .identificador = journal->identificador,
+        .crc = calcular_crc(journal->transacao + sizeof(CabecalhoTransacao), tamanho_dados)
+    };
+    memcpy(journal->transacao, &cabecalho, sizeof(cabecalho));
+    TransacaoPendente *pendente = malloc(sizeof(TransacaoPendente));
+    if (!pendente) {
+        journal_descartar(journal);
+        return -ENOMEM;
+    }
+    pendente->posicao = posicao;
+    resultado = escrever_regiao(journal, lote, journal->transacao, journal->tamanho_transacao,
+                                posicao_log(journal, posicao));
+    if (resultado == 0 && (fila_io_sincronizar(lote, 1) < 0 || fila_io_marcar(lote, concluir_transacao, journal) < 0)) {
+        resultado = -ENOMEM;
+    }
+    if (resultado < 0) {
+        free(pendente);
+        journal_descartar(journal);
+        return resultado;
+    }
+    journal->confirmando = pendente;
+    return 0;
+}
+
+int journal_confirmar(Journal *journal) {
+    LoteIO lote;
+    fila_io_lote(&lote, journal->fila);
+    int resultado = journal_confirmar_em_lote(journal, &lote);
+    int resultado_lote = fila_io_executar(&lote);
+    return resultado < 0 ? resultado : resultado_lote;
+}
+
+int journal_checkpoint(Journal *journal) {
+    if (!journal->pendentes) {
+        return 0;
+    }
+    LoteIO lote;
+    fila_io_lote(&lote, journal->fila);
+    int resultado = 0;
+    for (TransacaoPendente *pendente = journal->pendentes; pendente && resultado == 0; pendente = pendente->proxima) {
+        resultado = enfileirar_registros(journal, &lote, pendente->dados + sizeof(CabecalhoTransacao),
+                                         pendente->tamanho - sizeof(CabecalhoTransacao));
+    }
+    if (resultado == 0) {
+        resultado = fila_io_sincronizar(&lote, 1);
+    }
+    if (resultado == 0) {
+        resultado = gravar_cabecalho(journal, &lote, journal->proxima_seq, journal->cabeca);
+    }
+    if (resultado < 0) {
+        fila_io_descartar(&lote);
+        return resultado;
+    }
+    resultado = fila_io_executar(&lote);
+    if (resultado < 0) {
+        return -EIO;
+    }
+    while (journal->pendentes) {
+        TransacaoPendente *pendente = journal->pendentes;
+        journal->pendentes = pendente->proxima;
+        free(pendente->dados);
+        free(pendente);
+    }
+    journal->ultima_pendente = NULL;
+    journal->bytes_pendentes = 0;
+    return 0;
+}
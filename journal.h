@@ -0,0 +1,81 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "fila_io.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define JOURNAL_MAGICO 0x4C4E524Au
+#define JOURNAL_MAGICO_TRANSACAO 0x5852544Au
+#define JOURNAL_VERSAO 2
+#define JOURNAL_TAMANHO_CABECALHO 4096
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t magico;
+    uint32_t versao;
+    uint64_t seq_inicio;
+    uint64_t posicao_inicio;
+    uint64_t identificador;
+    uint32_t crc;
+} CabecalhoJournal;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t magico;
+    uint32_t num_registros;
+    uint64_t seq;
+    uint64_t tamanho;
+    uint64_t identificador;
+    uint32_t crc;
+} CabecalhoTransacao;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct {
+    uint64_t deslocamento;
+    uint32_t tamanho;
+} RegistroJournal;
+#pragma pack(pop)
+
+typedef struct TransacaoPendente {
+    uint64_t posicao;
+    char *dados;
+    size_t tamanho;
+    struct TransacaoPendente *proxima;
+} TransacaoPendente;
+
+typedef struct {
+    int fd;
+    FilaIO *fila;
+    uint64_t inicio_regiao;
+    size_t tamanho_log;
+    off_t base_home;
+    uint64_t identificador;
+    unsigned int bits_lsb;
+    uint64_t cabeca;
+    uint64_t proxima_seq;
+    TransacaoPendente *pendentes;
+    TransacaoPendente *ultima_pendente;
+    size_t bytes_pendentes;
+    char *transacao;
+    size_t tamanho_transacao;
+    size_t capacidade_transacao;
+    uint32_t registros_transacao;
+    TransacaoPendente *confirmando;
+    CabecalhoJournal cabecalho;
+} Journal;
+
+int journal_abrir(Journal *journal, FilaIO *fila, off_t base_home, uint64_t inicio_regiao, size_t tamanho_regiao,
+                  uint64_t identificador, unsigned int bits_lsb);
+void journal_fechar(Journal *journal);
+int journal_adicionar(Journal *journal, uint64_t deslocamento, const void *dados, size_t tamanho);
+void journal_descartar(Journal *journal);
+size_t journal_espaco_transacao(const Journal *journal);
+int journal_confirmar(Journal *journal);
+int journal_confirmar_em_lote(Journal *journal, LoteIO *lote);
+int journal_checkpoint(Journal *journal);
+
+#endif
@@ -0,0 +1,213 @@
+#include "libbmpfs.h"
+#include "bmp.h"
+#include "bmpfs.h"
+#include "formato.h"
+#include "lsb.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIBBMPFS_MAXIMO_TRANSFERENCIA (1u << 30)
+
+typedef struct {
+    VisitanteBmpfs visitante;
+    void *dados;
+} ListagemBmpfs;
+
+static pthread_mutex_t trava_montagem = PTHREAD_MUTEX_INITIALIZER;
+static void *dados_montagem;
+static int montado;
+
+void bmpfs_opcoes_formatacao_padrao(OpcoesFormatacaoBmpfs *opcoes) {
+    opcoes->tamanho_bloco = BMPFS_TAMANHO_BLOCO_PADRAO;
+    opcoes->max_arquivos = BMPFS_MAX_ARQUIVOS_PADRAO;
+    opcoes->bits_lsb = 0;
+}
+
+void bmpfs_opcoes_montagem_padrao(OpcoesMontagemBmpfs *opcoes) {
+    opcoes->atraso_metadados_ms = BMPFS_ATRASO_METADADOS_PADRAO;
+    opcoes->cache_mb = BMPFS_CACHE_MB_PADRAO;
+    opcoes->profundidade_io = BMPFS_PROFUNDIDADE_IO_PADRAO;
+    opcoes->usar_mmap = 0;
+    opcoes->desfragmentacao_mb_s = 0;
+    opcoes->ocioso_desfragmentacao_s = BMPFS_OCIOSO_DESFRAGMENTACAO_PADRAO;
+    opcoes->nivel_log = BMPFS_LOG_ERRO;
+}
+
+int bmpfs_formatar(const char *imagem, size_t largura, size_t altura, const OpcoesFormatacaoBmpfs *opcoes) {
+    OpcoesFormatacaoBmpfs padrao;
+    if (!opcoes) {
+        bmpfs_opcoes_formatacao_padrao(&padrao);
+        opcoes = &padrao;
+    }
+    if (!imagem || (largura == 0) != (altura == 0) || opcoes->max_arquivos == 0 ||
+        (opcoes->bits_lsb != 0 && !lsb_bits_validos(opcoes->bits_lsb))) {
+        return -EINVAL;
+    }
+    int resultado = largura ? criar_arquivo_bmp(imagem, largura, altura, 24) : 0;
+    if (resultado < 0) {
+        return resultado;
+    }
+    FILE *f = fopen(imagem, "r+b");
+    if (!f) {
+        return -errno;
+    }
+    CabeçalhoBMP cabecalho;
+    InfoCabecalhoBMP info;
+    SuperblocoBMPFS superbloco;
+    resultado = ler_cabecalho_bmp(f, &cabecalho, &info);
+    if (resultado == 0) {
+        resultado = formato_calcular(&superbloco, cabecalho.deslocamento_dados, calcular_tamanho_pixels(&info),
+                                     opcoes->tamanho_bloco, opcoes->max_arquivos, opcoes->bits_lsb);
+    }
+    if (resultado == 0) {
+        resultado = formato_escrever(fileno(f), cabecalho.deslocamento_dados, &superbloco);
+    }
+    if (fclose(f) != 0 && resultado == 0) {
+        resultado = -errno;
+    }
+    return resultado < 0 ? resultado : 0;
+}
+
+int bmpfs_abrir(const char *imagem, const OpcoesMontagemBmpfs *opcoes) {
+    OpcoesMontagemBmpfs padrao;
+    if (!opcoes) {
+        bmpfs_opcoes_montagem_padrao(&padrao);
+        opcoes = &padrao;
+    }
+    if (!imagem) {
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&trava_montagem);
+    if (montado) {
+        pthread_mutex_unlock(&trava_montagem);
+        return -EBUSY;
+    }
+    config_bmpfs.atraso_metadados_ms = opcoes->atraso_metadados_ms;
+    config_bmpfs.cache_mb = opcoes->cache_mb;
+    config_bmpfs.profundidade_io = opcoes->profundidade_io;
+    config_bmpfs.usar_mmap = opcoes->usar_mmap;
+    config_bmpfs.desfragmentacao_mb_s = opcoes->desfragmentacao_mb_s;
+    config_bmpfs.ocioso_desfragmentacao_s = opcoes->ocioso_desfragmentacao_s;
+    config_bmpfs.nivel_log = opcoes->nivel_log;
+    estado_sistema_bmpfs.caminho_imagem = strdup(imagem);
+    if (!estado_sistema_bmpfs.caminho_imagem) {
+        pthread_mutex_unlock(&trava_montagem);
+        return -ENOMEM;
+    }
+    struct fuse_conn_info conexao;
+    struct fuse_config configuracao;
+    memset(&conexao, 0, sizeof(conexao));
+    memset(&configuracao, 0, sizeof(configuracao));
+    dados_montagem = operacoes_bmpfs.init(&conexao, &configuracao);
+    if (!dados_montagem) {
+        free(estado_sistema_bmpfs.caminho_imagem);
+        estado_sistema_bmpfs.caminho_imagem = NULL;
+        pthread_mutex_unlock(&trava_montagem);
+        return -EIO;
+    }
+    montado = 1;
+    pthread_mutex_unlock(&trava_montagem);
+    return 0;
+}
+
+int bmpfs_fechar(void) {
+    pthread_mutex_lock(&trava_montagem);
+    if (!montado) {
+        pthread_mutex_unlock(&trava_montagem);
+        return -EINVAL;
+    }
+    int resultado = operacoes_bmpfs.fsync(NULL, 0, NULL);
+    operacoes_bmpfs.destroy(dados_montagem);
+    dados_montagem = NULL;
+    montado = 0;
+    pthread_mutex_unlock(&trava_montagem);
+    return resultado;
+}
+
+int bmpfs_consultar(const char *caminho, struct stat *st) {
+    memset(st, 0, sizeof(struct stat));
+    return operacoes_bmpfs.getattr(caminho, st, NULL);
+}
+
+static int preencher_listagem(void *buf, const char *nome, const struct stat *st, off_t offset,
+                              enum fuse_fill_dir_flags flags) {
+    (void) offset;
+    (void) flags;
+    ListagemBmpfs *listagem = buf;
+    return listagem->visitante(listagem->dados, nome, st) != 0;
+}
+
+int bmpfs_listar(const char *caminho, VisitanteBmpfs visitante, void *dados) {
+    ListagemBmpfs listagem = {visitante, dados};
+    return operacoes_bmpfs.readdir(caminho, &listagem, preencher_listagem, 0, NULL, 0);
+}
+
+int bmpfs_criar(const char *caminho, mode_t modo) {
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    return operacoes_bmpfs.create(caminho, modo, &fi);
+}
+
+int bmpfs_criar_diretorio(const char *caminho, mode_t modo) {
+    return operacoes_bmpfs.mkdir(caminho, modo);
+}
+
+ssize_t bmpfs_ler(const char *caminho, void *buf, size_t tamanho, off_t offset) {
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    size_t lidos = 0;
+    while (lidos < tamanho) {
+        size_t parte = tamanho - lidos < LIBBMPFS_MAXIMO_TRANSFERENCIA ? tamanho - lidos : LIBBMPFS_MAXIMO_TRANSFERENCIA;
+        int resultado = operacoes_bmpfs.read(caminho, (char *)buf + lidos, parte, offset + (off_t)lidos, &fi);
+        if (resultado < 0) {
+            return lidos ? (ssize_t)lidos : resultado;
+        }
+        lidos += (size_t)resultado;
+        if ((size_t)resultado < parte) {
+            break;
+        }
+    }
+    return (ssize_t)lidos;
+}
+
+ssize_t bmpfs_escrever(const char *caminho, const void *buf, size_t tamanho, off_t offset) {
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    size_t escritos = 0;
+    while (escritos < tamanho) {
+        size_t parte = tamanho - escritos < LIBBMPFS_MAXIMO_TRANSFERENCIA ? tamanho - escritos
+                                                                          : LIBBMPFS_MAXIMO_TRANSFERENCIA;
+        int resultado = operacoes_bmpfs.write(caminho, (const char *)buf + escritos, parte, offset + (off_t)escritos,
+                                              &fi);
+        if (resultado < 0) {
+            return escritos ? (ssize_t)escritos : resultado;
+        }
+        escritos += (size_t)resultado;
+        if ((size_t)resultado < parte) {
+            break;
+        }
+    }
+    return (ssize_t)escritos;
+}
+
+int bmpfs_truncar(const char *caminho, off_t tamanho) {
+    return operacoes_bmpfs.truncate(caminho, tamanho, NULL);
+}
+
+int bmpfs_excluir(const char *caminho) {
+    return operacoes_bmpfs.unlink(caminho);
+}
+
+int bmpfs_remover_diretorio(const char *caminho) {
+    return operacoes_bmpfs.rmdir(caminho);
+}
+
+int bmpfs_renomear(const char *origem, const char *destino) {
+    return operacoes_bmpfs.rename(origem, destino, 0);
+}
+
+int bmpfs_sincronizar(const char *caminho) {
+    return operacoes_bmpfs.fsync(caminho, 0, NULL);
+}
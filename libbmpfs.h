@@ -0,0 +1,46 @@
+#ifndef LIBBMPFS_H
+#define LIBBMPFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+typedef struct {
+    uint32_t tamanho_bloco;
+    uint32_t max_arquivos;
+    uint32_t bits_lsb;
+} OpcoesFormatacaoBmpfs;
+
+typedef struct {
+    unsigned int atraso_metadados_ms;
+    unsigned int cache_mb;
+    unsigned int profundidade_io;
+    int usar_mmap;
+    unsigned int desfragmentacao_mb_s;
+    unsigned int ocioso_desfragmentacao_s;
+    unsigned int nivel_log;
+} OpcoesMontagemBmpfs;
+
+typedef int (*VisitanteBmpfs)(void *dados, const char *nome, const struct stat *st);
+
+void bmpfs_opcoes_formatacao_padrao(OpcoesFormatacaoBmpfs *opcoes);
+void bmpfs_opcoes_montagem_padrao(OpcoesMontagemBmpfs *opcoes);
+int bmpfs_formatar(const char *imagem, size_t largura, size_t altura, const OpcoesFormatacaoBmpfs *opcoes);
+
+int bmpfs_abrir(const char *imagem, const OpcoesMontagemBmpfs *opcoes);
+int bmpfs_fechar(void);
+
+int bmpfs_consultar(const char *caminho, struct stat *st);
+int bmpfs_listar(const char *caminho, VisitanteBmpfs visitante, void *dados);
+int bmpfs_criar(const char *caminho, mode_t modo);
+int bmpfs_criar_diretorio(const char *caminho, mode_t modo);
+ssize_t bmpfs_ler(const char *caminho, void *buf, size_t tamanho, off_t offset);
+ssize_t bmpfs_escrever(const char *caminho, const void *buf, size_t tamanho, off_t offset);
+int bmpfs_truncar(const char *caminho, off_t tamanho);
+int bmpfs_excluir(const char *caminho);
+int bmpfs_remover_diretorio(const char *caminho);
+int bmpfs_renomear(const char *origem, const char *destino);
+int bmpfs_sincronizar(const char *caminho);
+
+#endif
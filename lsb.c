@@ -0,0 +1,419 @@
+#include "lsb.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LSB_X86 1
+#endif
+
+static const uint64_t mascaras_lsb[5] = {
+    0, UINT64_C(0x0101010101010101), UINT64_C(0x0303030303030303), 0, UINT64_C(0x0F0F0F0F0F0F0F0F)
+};
+
+static uint64_t carregar64(const uint8_t *origem) {
+    uint64_t valor;
+    memcpy(&valor, origem, sizeof(valor));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    valor = __builtin_bswap64(valor);
+#endif
+    return valor;
+}
+
+static void armazenar64(uint8_t *destino, uint64_t valor) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    valor = __builtin_bswap64(valor);
+#endif
+    memcpy(destino, &valor, sizeof(valor));
+}
+
+static uint64_t espalhar_bits(uint64_t valor, unsigned int bits) {
+    switch (bits) {
+        case 1:
+            valor = (valor | valor << 28) & UINT64_C(0x0000000F0000000F);
+            valor = (valor | valor << 14) & UINT64_C(0x0003000300030003);
+            return (valor | valor << 7) & UINT64_C(0x0101010101010101);
+        case 2:
+            valor = (valor | valor << 24) & UINT64_C(0x000000FF000000FF);
+            valor = (valor | valor << 12) & UINT64_C(0x000F000F000F000F);
+            return (valor | valor << 6) & UINT64_C(0x0303030303030303);
+        default:
+            valor = (valor | valor << 16) & UINT64_C(0x0000FFFF0000FFFF);
+            valor = (valor | valor << 8) & UINT64_C(0x00FF00FF00FF00FF);
+            return (valor | valor << 4) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+    }
+}
+
+static uint64_t juntar_bits(uint64_t valor, unsigned int bits) {
+    switch (bits) {
+        case 1:
+            valor &= UINT64_C(0x0101010101010101);
+            valor = (valor | valor >> 7) & UINT64_C(0x0003000300030003);
+            valor = (valor | valor >> 14) & UINT64_C(0x0000000F0000000F);
+            return (valor | valor >> 28) & UINT64_C(0xFF);
+        case 2:
+            valor &= UINT64_C(0x0303030303030303);
+            valor = (valor | valor >> 6) & UINT64_C(0x000F000F000F000F);
+            valor = (valor | valor >> 12) & UINT64_C(0x000000FF000000FF);
+            return (valor | valor >> 24) & UINT64_C(0xFFFF);
+        default:
+            valor &= UINT64_C(0x0F0F0F0F0F0F0F0F);
+            valor = (valor | valor >> 4) & UINT64_C(0x00FF00FF00FF00FF);
+            valor = (valor | valor >> 8) & UINT64_C(0x0000FFFF0000FFFF);
+            return (valor | valor >> 16) & UINT64_C(0xFFFFFFFF);
+    }
+}
+
+static void embutir_byte(uint8_t *portadora, uint8_t valor, unsigned int bits) {
+    uint8_t mascara = (uint8_t)((1u << bits) - 1);
+    for (unsigned int j = 0; j < 8 / bits; j++) {
+        portadora[j] = (uint8_t)((portadora[j] & ~mascara) | (valor & mascara));
+        valor >>= bits;
+    }
+}
+
+static uint8_t extrair_byte(const uint8_t *portadora, unsigned int bits) {
+    uint8_t mascara = (uint8_t)((1u << bits) - 1);
+    unsigned int valor = 0;
+    for (unsigned int j = 0; j < 8 / bits; j++) {
+        valor |= (unsigned int)(portadora[j] & mascara) << (j * bits);
+    }
+    return (uint8_t)valor;
+}
+
+static void embutir_escalar(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits) {
+    uint64_t mascara = mascaras_lsb[bits];
+    size_t i = 0;
+    for (; i + bits <= tamanho; i += bits) {
+        uint64_t valor = 0;
+        for (unsigned int k = 0; k < bits; k++) {
+            valor |= (uint64_t)dados[i + k] << (8 * k);
+        }
+        uint64_t atual = carregar64(portadora);
+        armazenar64(portadora, (atual & ~mascara) | espalhar_bits(valor, bits));
+        portadora += 8;
+    }
+    for (; i < tamanho; i++) {
+        embutir_byte(portadora, dados[i], bits);
+        portadora += 8 / bits;
+    }
+}
+
+static void extrair_escalar(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits) {
+    size_t i = 0;
+    for (; i + bits <= tamanho; i += bits) {
+        uint64_t valor = juntar_bits(carregar64(portadora), bits);
+        for (unsigned int k = 0; k < bits; k++) {
+            dados[i + k] = (uint8_t)(valor >> (8 * k));
+        }
+        portadora += 8;
+    }
+    for (; i < tamanho; i++) {
+        dados[i] = extrair_byte(portadora, bits);
+        portadora += 8 / bits;
+    }
+}
+
+static int sempre_suportado(void) {
+    return 1;
+}
+
+#ifdef LSB_X86
+__attribute__((target("sse4.1")))
+static void embutir_sse4(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits) {
+    const __m128i mascara = _mm_set1_epi8((char)((1u << bits) - 1));
+    size_t i = 0;
+    if (bits == 1) {
+        const __m128i indices = _mm_set_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i selecao = _mm_set1_epi64x((long long)UINT64_C(0x8040201008040201));
+        for (; i + 2 <= tamanho; i += 2) {
+            uint16_t par;
+            memcpy(&par, dados + i, sizeof(par));
+            __m128i espalhado = _mm_shuffle_epi8(_mm_cvtsi32_si128(par), indices);
+            __m128i bits_dados = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(espalhado, selecao), selecao), mascara);
+            __m128i atual = _mm_loadu_si128((const __m128i *)portadora);
+            _mm_storeu_si128((__m128i *)portadora, _mm_or_si128(_mm_andnot_si128(mascara, atual), bits_dados));
+            portadora += 16;
+        }
+    } else if (bits == 2) {
+        for (; i + 4 <= tamanho; i += 4) {
+            uint32_t quatro;
+            memcpy(&quatro, dados + i, sizeof(quatro));
+            __m128i x = _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)quatro));
+            __m128i espalhado = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(x, _mm_set1_epi32(0x03)),
+                             _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x0C)), 6)),
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x30)), 12),
+                             _mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0xC0)), 18)));
+            __m128i atual = _mm_loadu_si128((const __m128i *)portadora);
+            _mm_storeu_si128((__m128i *)portadora, _mm_or_si128(_mm_andnot_si128(mascara, atual), espalhado));
+            portadora += 16;
+        }
+    } else {
+        for (; i + 8 <= tamanho; i += 8) {
+            __m128i x = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(dados + i)));
+            __m128i espalhado = _mm_or_si128(_mm_and_si128(x, _mm_set1_epi16(0x0F)),
+                                             _mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0xF0)), 4));
+            __m128i atual = _mm_loadu_si128((const __m128i *)portadora);
+            _mm_storeu_si128((__m128i *)portadora, _mm_or_si128(_mm_andnot_si128(mascara, atual), espalhado));
+            portadora += 16;
+        }
+    }
+    embutir_escalar(portadora, dados + i, tamanho - i, bits);
+}
+
+__attribute__((target("sse4.1")))
+static void extrair_sse4(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits) {
+    size_t i = 0;
+    if (bits == 1) {
+        for (; i + 2 <= tamanho; i += 2) {
+            __m128i v = _mm_loadu_si128((const __m128i *)portadora);
+            uint16_t par = (uint16_t)_mm_movemask_epi8(_mm_slli_epi16(v, 7));
+            memcpy(dados + i, &par, sizeof(par));
+            portadora += 16;
+        }
+    } else if (bits == 2) {
+        const __m128i mascara = _mm_set1_epi8(0x03);
+        const __m128i pares = _mm_set1_epi16(0x0401);
+        const __m128i quartetos = _mm_set1_epi32(0x00100001);
+        for (; i + 16 <= tamanho; i += 16) {
+            __m128i r[4];
+            for (int k = 0; k < 4; k++) {
+                __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(portadora + 16 * k)), mascara);
+                r[k] = _mm_madd_epi16(_mm_maddubs_epi16(v, pares), quartetos);
+            }
+            __m128i juntos = _mm_packus_epi16(_mm_packus_epi32(r[0], r[1]), _mm_packus_epi32(r[2], r[3]));
+            _mm_storeu_si128((__m128i *)(dados + i), juntos);
+            portadora += 64;
+        }
+    } else {
+        const __m128i mascara = _mm_set1_epi8(0x0F);
+        const __m128i pares = _mm_set1_epi16(0x1001);
+        for (; i + 16 <= tamanho; i += 16) {
+            __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)portadora), mascara);
+            __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(portadora + 16)), mascara);
+            __m128i juntos = _mm_packus_epi16(_mm_maddubs_epi16(a, pares), _mm_maddubs_epi16(b, pares));
+            _mm_storeu_si128((__m128i *)(dados + i), juntos);
+            portadora += 32;
+        }
+    }
+    extrair_escalar(dados + i, portadora, tamanho - i, bits);
+}
+
+__attribute__((target("avx2")))
+static void embutir_avx2(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits) {
+    const __m256i mascara = _mm256_set1_epi8((char)((1u << bits) - 1));
+    size_t i = 0;
+    if (bits == 1) {
+        const __m256i indices = _mm256_set_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                                1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i selecao = _mm256_set1_epi64x((long long)UINT64_C(0x8040201008040201));
+        for (; i + 4 <= tamanho; i += 4) {
+            uint32_t quatro;
+            memcpy(&quatro, dados + i, sizeof(quatro));
+            __m256i espalhado = _mm256_shuffle_epi8(_mm256_set1_epi32((int)quatro), indices);
+            __m256i bits_dados =
+                _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(espalhado, selecao), selecao), mascara);
+            __m256i atual = _mm256_loadu_si256((const __m256i *)portadora);
+            _mm256_storeu_si256((__m256i *)portadora, _mm256_or_si256(_mm256_andnot_si256(mascara, atual), bits_dados));
+            portadora += 32;
+        }
+    } else if (bits == 2) {
+        for (; i + 8 <= tamanho; i += 8) {
+            __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(dados + i)));
+            __m256i espalhado = _mm256_or_si256(
+                _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi32(0x03)),
+                                _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x0C)), 6)),
+                _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0x30)), 12),
+                                _mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xC0)), 18)));
+            __m256i atual = _mm256_loadu_si256((const __m256i *)portadora);
+            _mm256_storeu_si256((__m256i *)portadora, _mm256_or_si256(_mm256_andnot_si256(mascara, atual), espalhado));
+            portadora += 32;
+        }
+    } else {
+        for (; i + 16 <= tamanho; i += 16) {
+            __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(dados + i)));
+            __m256i espalhado = _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi16(0x0F)),
+                                                _mm256_slli_epi16(_mm256_and_si256(x, _mm256_set1_epi16(0xF0)), 4));
+            __m256i atual = _mm256_loadu_si256((const __m256i *)portadora);
+            _mm256_storeu_si256((__m256i *)portadora, _mm256_or_si256(_mm256_andnot_si256(mascara, atual), espalhado));
+            portadora += 32;
+        }
+    }
+    embutir_escalar(portadora, dados + i, tamanho - i, bits);
+}
+
+__attribute__((target("avx2")))
+static void extrair_avx2(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits) {
+    size_t i = 0;
+    if (bits == 1) {
+        for (; i + 4 <= tamanho; i += 4) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)portadora);
+            uint32_t quatro = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(v, 7));
+            memcpy(dados + i, &quatro, sizeof(quatro));
+            portadora += 32;
+        }
+    } else if (bits == 2) {
+        const __m256i mascara = _mm256_set1_epi8(0x03);
+        const __m256i pares = _mm256_set1_epi16(0x0401);
+        const __m256i quartetos = _mm256_set1_epi32(0x00100001);
+        const __m256i ordem = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; i + 32 <= tamanho; i += 32) {
+            __m256i r[4];
+            for (int k = 0; k < 4; k++) {
+                __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(portadora + 32 * k)), mascara);
+                r[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(v, pares), quartetos);
+            }
+            __m256i juntos = _mm256_packus_epi16(_mm256_packus_epi32(r[0], r[1]), _mm256_packus_epi32(r[2], r[3]));
+            _mm256_storeu_si256((__m256i *)(dados + i), _mm256_permutevar8x32_epi32(juntos, ordem));
+            portadora += 128;
+        }
+    } else {
+        const __m256i mascara = _mm256_set1_epi8(0x0F);
+        const __m256i pares = _mm256_set1_epi16(0x1001);
+        for (; i + 32 <= tamanho; i += 32) {
+            __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)portadora), mascara);
+            __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(portadora + 32)), mascara);
+            __m256i juntos = _mm256_packus_epi16(_mm256_maddubs_epi16(a, pares), _mm256_maddubs_epi16(b, pares));
+            _mm256_storeu_si256((__m256i *)(dados + i), _mm256_permute4x64_epi64(juntos, 0xD8));
+            portadora += 64;
+        }
+    }
+    extrair_escalar(dados + i, portadora, tamanho - i, bits);
+}
+
+static int suporta_sse4(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+static int suporta_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+const KernelLSB kernels_lsb[] = {
+#ifdef LSB_X86
+    { "avx2", suporta_avx2, embutir_avx2, extrair_avx2 },
+    { "sse4", suporta_sse4, embutir_sse4, extrair_sse4 },
+#endif
+    { "escalar", sempre_suportado, embutir_escalar, extrair_escalar },
+};
+
+const size_t num_kernels_lsb = sizeof(kernels_lsb) / sizeof(kernels_lsb[0]);
+
+static const KernelLSB *kernel_ativo;
+static pthread_once_t kernel_escolhido = PTHREAD_ONCE_INIT;
+
+static void escolher_kernel(void) {
+    for (size_t i = 0; i < num_kernels_lsb; i++) {
+        if (kernels_lsb[i].suportado()) {
+            kernel_ativo = &kernels_lsb[i];
+            return;
+        }
+    }
+}
+
+int lsb_bits_validos(unsigned int bits) {
+    return bits == 1 || bits == 2 || bits == 4;
+}
+
+size_t lsb_tamanho_portadora(size_t tamanho, unsigned int bits) {
+    return tamanho * (8 / bits);
+}
+
+const KernelLSB *lsb_melhor_kernel(void) {
+    pthread_once(&kernel_escolhido, escolher_kernel);
+    return kernel_ativo;
+}
+
+void lsb_embutir(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits) {
+    lsb_melhor_kernel()->embutir(portadora, dados, tamanho, bits);
+}
+
+void lsb_extrair(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits) {
+    lsb_melhor_kernel()->extrair(dados, portadora, tamanho, bits);
+}
+
+static int ler_completo(int fd, void *destino, size_t tamanho, off_t offset) {
+    uint8_t *cursor = destino;
+    while (tamanho > 0) {
+        ssize_t lidos = pread(fd, cursor, tamanho, offset);
+        if (lidos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (lidos <= 0) {
+            return -EIO;
+        }
+        cursor += lidos;
+        tamanho -= lidos;
+        offset += lidos;
+    }
+    return 0;
+}
+
+static int escrever_completo(int fd, const void *origem, size_t tamanho, off_t offset) {
+    const uint8_t *cursor = origem;
+    while (tamanho > 0) {
+        ssize_t escritos = pwrite(fd, cursor, tamanho, offset);
+        if (escritos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (escritos <= 0) {
+            return -EIO;
+        }
+        cursor += escritos;
+        tamanho -= escritos;
+        offset += escritos;
+    }
+    return 0;
+}
+
+int lsb_preparar_portadora(int fd, uint8_t *portadora, const void *dados, size_t tamanho, off_t offset,
+                           unsigned int bits) {
+    int resultado = ler_completo(fd, portadora, lsb_tamanho_portadora(tamanho, bits), offset);
+    if (resultado == 0) {
+        lsb_embutir(portadora, dados, tamanho, bits);
+    }
+    return resultado;
+}
+
+static int transferir_portadora(int fd, uint8_t *destino, const uint8_t *origem, size_t tamanho, off_t offset,
+                                unsigned int bits) {
+    uint8_t *portadora = malloc(LSB_TRECHO_PORTADORA);
+    if (!portadora) {
+        return -ENOMEM;
+    }
+    size_t por_vez = LSB_TRECHO_PORTADORA / lsb_tamanho_portadora(1, bits);
+    int resultado = 0;
+    for (size_t feitos = 0; feitos < tamanho && resultado == 0; feitos += por_vez) {
+        size_t parte = tamanho - feitos < por_vez ? tamanho - feitos : por_vez;
+        size_t tamanho_portadora = lsb_tamanho_portadora(parte, bits);
+        off_t offset_portadora = offset + (off_t)lsb_tamanho_portadora(feitos, bits);
+        if (origem) {
+            resultado = lsb_preparar_portadora(fd, portadora, origem + feitos, parte, offset_portadora, bits);
+            if (resultado == 0) {
+                resultado = escrever_completo(fd, portadora, tamanho_portadora, offset_portadora);
+            }
+        } else {
+            resultado = ler_completo(fd, portadora, tamanho_portadora, offset_portadora);
+            if (resultado == 0) {
+                lsb_extrair(destino + feitos, portadora, parte, bits);
+            }
+        }
+    }
+    free(portadora);
+    return resultado;
+}
+
+int lsb_ler_portadora(int fd, void *dados, size_t tamanho, off_t offset, unsigned int bits) {
+    return transferir_portadora(fd, dados, NULL, tamanho, offset, bits);
+}
+
+int lsb_escrever_portadora(int fd, const void *dados, size_t tamanho, off_t offset, unsigned int bits) {
+    return transferir_portadora(fd, NULL, dados, tamanho, offset, bits);
+}
@@ -0,0 +1,33 @@
+#ifndef LSB_H
+#define LSB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LSB_TRECHO_PORTADORA (256 * 1024)
+
+typedef void (*FuncaoEmbutirLSB)(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits);
+typedef void (*FuncaoExtrairLSB)(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits);
+
+typedef struct {
+    const char *nome;
+    int (*suportado)(void);
+    FuncaoEmbutirLSB embutir;
+    FuncaoExtrairLSB extrair;
+} KernelLSB;
+
+extern const KernelLSB kernels_lsb[];
+extern const size_t num_kernels_lsb;
+
+int lsb_bits_validos(unsigned int bits);
+size_t lsb_tamanho_portadora(size_t tamanho, unsigned int bits);
+const KernelLSB *lsb_melhor_kernel(void);
+void lsb_embutir(uint8_t *portadora, const uint8_t *dados, size_t tamanho, unsigned int bits);
+void lsb_extrair(uint8_t *dados, const uint8_t *portadora, size_t tamanho, unsigned int bits);
+int lsb_preparar_portadora(int fd, uint8_t *portadora, const void *dados, size_t tamanho, off_t offset,
+                           unsigned int bits);
+int lsb_ler_portadora(int fd, void *dados, size_t tamanho, off_t offset, unsigned int bits);
+int lsb_escrever_portadora(int fd, const void *dados, size_t tamanho, off_t offset, unsigned int bits);
+
+#endif
@@ -1,19 +1,65 @@
 #include "bmpfs.h"
 #include <fuse3/fuse.h>
+#include <fuse3/fuse_lowlevel.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+static int executar_baixo_nivel(struct fuse_args *args) {
+    struct fuse_cmdline_opts opcoes;
+    if (fuse_parse_cmdline(args, &opcoes) != 0) {
+        return 1;
+    }
+    if (opcoes.show_help) {
+        fuse_cmdline_help();
+        fuse_lowlevel_help();
+        free(opcoes.mountpoint);
+        return 0;
+    }
+    if (opcoes.show_version) {
+        fuse_lowlevel_version();
+        free(opcoes.mountpoint);
+        return 0;
+    }
+    if (!opcoes.mountpoint) {
+        fprintf(stderr, "Ponto de montagem não informado\n");
+        return 1;
+    }
+
+    int retorno = 1;
+    struct fuse_session *sessao = NULL;
+    sessao = fuse_session_new(args, &operacoes_baixo_nivel_bmpfs, sizeof(operacoes_baixo_nivel_bmpfs), &sessao);
+    if (sessao) {
+        if (fuse_set_signal_handlers(sessao) == 0) {
+            if (fuse_session_mount(sessao, opcoes.mountpoint) == 0) {
+                fuse_daemonize(opcoes.foreground);
+                retorno = opcoes.singlethread ? fuse_session_loop(sessao)
+                                              : fuse_session_loop_mt(sessao, opcoes.clone_fd);
+                fuse_session_unmount(sessao);
+            }
+            fuse_remove_signal_handlers(sessao);
+        }
+        fuse_session_destroy(sessao);
+    }
+    free(opcoes.mountpoint);
+    return retorno ? 1 : 0;
+}
+
 int main(int argc, char *argv[]) {
     struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
     config_bmpfs.configuracao_caminho_imagem = NULL;
+    config_bmpfs.atraso_metadados_ms = BMPFS_ATRASO_METADADOS_PADRAO;
+    config_bmpfs.cache_mb = BMPFS_CACHE_MB_PADRAO;
+    config_bmpfs.profundidade_io = BMPFS_PROFUNDIDADE_IO_PADRAO;
+    config_bmpfs.ocioso_desfragmentacao_s = BMPFS_OCIOSO_DESFRAGMENTACAO_PADRAO;
+    config_bmpfs.nivel_log = BMPFS_LOG_INFO;
 
     if (fuse_opt_parse(&args, &config_bmpfs, opcoes_bmpfs, NULL) == -1) {
         return 1;
     }
 
     if (config_bmpfs.configuracao_caminho_imagem == NULL) {
-        fprintf(stderr, "Uso: %s [Opções FUSE] ponto_de_montagem -o imagem=<arquivo_imagem.bmp>\n", argv[0]);
+        fprintf(stderr, "Uso: %s [Opções FUSE] ponto_de_montagem -o imagem=<arquivo_imagem.bmp>[,atraso_metadados=<ms>][,cache_mb=<MB>][,profundidade_io=<n>][,mmap][,desfragmentar=<MB/s>][,ocioso_desfragmentacao=<s>][,log=<0-3>][,baixo_nivel]\n", argv[0]);
         fuse_opt_free_args(&args);
         return 1;
     }
@@ -25,7 +71,8 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    int retorno = fuse_main(args.argc, args.argv, &operacoes_bmpfs, NULL);
+    int retorno = config_bmpfs.baixo_nivel ? executar_baixo_nivel(&args)
+                                           : fuse_main(args.argc, args.argv, &operacoes_bmpfs, NULL);
 
     fuse_opt_free_args(&args);
     return retorno;
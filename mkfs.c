@@ -0,0 +1,139 @@
+#include "bmp.h"
+#include "formato.h"
+#include "lsb.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void mostrar_uso(const char *programa) {
+    fprintf(stderr,
+            "Uso: %s [-l largura -a altura [-p bpp] [-f]] [-b tamanho_bloco] [-n max_arquivos] [-s bits] [-r] imagem.bmp\n"
+            "  -l, -a  cria uma nova imagem com as dimensões dadas (sem -l/-a, formata a imagem existente)\n"
+            "  -p      bits por pixel da nova imagem: 16, 24 ou 32 (padrão 24)\n"
+            "  -f      sobrescreve a imagem se ela já existir\n"
+            "  -b      tamanho do bloco em bytes (padrão %u)\n"
+            "  -n      número inicial de entradas da tabela de arquivos (padrão %u); a tabela cresce sob demanda\n"
+            "  -s      guarda os dados nos 1, 2 ou 4 bits menos significativos de cada byte de pixel\n"
+            "  -r      reserva o espaço da área de pixels com fallocate\n",
+            programa, BMPFS_TAMANHO_BLOCO_PADRAO, BMPFS_MAX_ARQUIVOS_PADRAO);
+}
+
+static int ler_numero(const char *texto, unsigned long long *valor) {
+    char *fim;
+    errno = 0;
+    *valor = strtoull(texto, &fim, 10);
+    return errno == 0 && fim != texto && *fim == '\0' ? 0 : -EINVAL;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long largura = 0, altura = 0, bpp = 24, bits_lsb = 0;
+    unsigned long long tamanho_bloco = BMPFS_TAMANHO_BLOCO_PADRAO, max_arquivos = BMPFS_MAX_ARQUIVOS_PADRAO;
+    int sobrescrever = 0, reservar = 0, opcao;
+    while ((opcao = getopt(argc, argv, "l:a:p:b:n:s:fr")) != -1) {
+        int resultado = 0;
+        switch (opcao) {
+            case 'l': resultado = ler_numero(optarg, &largura); break;
+            case 'a': resultado = ler_numero(optarg, &altura); break;
+            case 'p': resultado = ler_numero(optarg, &bpp); break;
+            case 'b': resultado = ler_numero(optarg, &tamanho_bloco); break;
+            case 'n': resultado = ler_numero(optarg, &max_arquivos); break;
+            case 's': resultado = ler_numero(optarg, &bits_lsb); break;
+            case 'f': sobrescrever = 1; break;
+            case 'r': reservar = 1; break;
+            default: mostrar_uso(argv[0]); return 1;
+        }
+        if (resultado < 0) {
+            fprintf(stderr, "Valor inválido para -%c: %s\n", opcao, optarg);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || (largura == 0) != (altura == 0) || tamanho_bloco > UINT32_MAX ||
+        max_arquivos == 0 || max_arquivos > UINT32_MAX || bpp > UINT16_MAX ||
+        (bits_lsb != 0 && !lsb_bits_validos(bits_lsb))) {
+        mostrar_uso(argv[0]);
+        return 1;
+    }
+    const char *caminho = argv[optind];
+
+    if (largura != 0) {
+        if (!sobrescrever && access(caminho, F_OK) == 0) {
+            fprintf(stderr, "%s já existe; use -f para sobrescrever ou omita -l/-a para formatá-la\n", caminho);
+            return 1;
+        }
+        int resultado = criar_arquivo_bmp(caminho, largura, altura, bpp);
+        if (resultado < 0) {
+            fprintf(stderr, "Falha ao criar %s: %s\n", caminho, strerror(-resultado));
+            return 1;
+        }
+    }
+
+    FILE *f = fopen(caminho, "r+b");
+    if (!f) {
+        fprintf(stderr, "Falha ao abrir %s: %s\n", caminho, strerror(errno));
+        return 1;
+    }
+    int fd = fileno(f);
+    CabeçalhoBMP cabecalho;
+    InfoCabecalhoBMP info;
+    if (ler_cabecalho_bmp(f, &cabecalho, &info) < 0) {
+        fprintf(stderr, "%s não é um arquivo BMP válido\n", caminho);
+        fclose(f);
+        return 1;
+    }
+    if (info.compressao != 0 && info.compressao != 3) {
+        fprintf(stderr, "%s usa compressão %u; apenas imagens sem compressão são suportadas\n", caminho, info.compressao);
+        fclose(f);
+        return 1;
+    }
+    size_t tamanho_pixels = calcular_tamanho_pixels(&info);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < (uint64_t)cabecalho.deslocamento_dados + tamanho_pixels) {
+        fprintf(stderr, "%s é menor que a área de pixels declarada no cabeçalho\n", caminho);
+        fclose(f);
+        return 1;
+    }
+    if (reservar) {
+        int resultado = posix_fallocate(fd, cabecalho.deslocamento_dados, tamanho_pixels);
+        if (resultado != 0) {
+            fprintf(stderr, "Falha ao reservar a área de pixels: %s\n", strerror(resultado));
+            fclose(f);
+            return 1;
+        }
+    }
+
+    SuperblocoBMPFS superbloco;
+    int resultado = formato_calcular(&superbloco, cabecalho.deslocamento_dados, tamanho_pixels, tamanho_bloco,
+                                     max_arquivos, bits_lsb);
+    if (resultado == -EINVAL) {
+        fprintf(stderr, "Tamanho de bloco inválido: deve ser potência de dois entre %u e %u bytes\n",
+                BMPFS_BLOCO_MINIMO, BMPFS_BLOCO_MAXIMO);
+        fclose(f);
+        return 1;
+    }
+    if (resultado < 0) {
+        fprintf(stderr, "Área de pixels de %zu bytes é pequena demais para %llu arquivos\n", tamanho_pixels,
+                max_arquivos);
+        fclose(f);
+        return 1;
+    }
+    resultado = formato_escrever(fd, cabecalho.deslocamento_dados, &superbloco);
+    if (resultado < 0) {
+        fprintf(stderr, "Falha ao gravar metadados em %s: %s\n", caminho, strerror(-resultado));
+        fclose(f);
+        return 1;
+    }
+    printf("%s: %llu blocos de %u bytes, até %llu arquivos (%u iniciais, grupos de %u), journal de %llu bytes", caminho,
+           (unsigned long long)superbloco.total_blocos, superbloco.tamanho_bloco,
+           (unsigned long long)formato_capacidade_inodes(&superbloco), superbloco.max_arquivos,
+           superbloco.entradas_por_grupo, (unsigned long long)superbloco.tamanho_journal);
+    if (superbloco.bits_lsb) {
+        printf(", modo LSB de %u bits", superbloco.bits_lsb);
+    }
+    printf("\n");
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include "libbmpfs.h"
+#include "bmpfs.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TESTES_LADO_IMAGEM 1024
+#define TESTES_ARQUIVOS_JOURNAL 16
+#define TESTES_TRECHO_JOURNAL 700
+#define TESTES_LIMITE_JOURNAL 20000
+
+static int falhas;
+
+#define VERIFICAR(condicao)                                                                   \
+    do {                                                                                      \
+        if (!(condicao)) {                                                                    \
+            fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #condicao);            \
+            falhas++;                                                                         \
+            return;                                                                           \
+        }                                                                                     \
+    } while (0)
+
+static int contar_entrada(void *dados, const char *nome, const struct stat *st) {
+    (void) st;
+    if (strcmp(nome, ".") != 0 && strcmp(nome, "..") != 0) {
+        (*(int *)dados)++;
+    }
+    return 0;
+}
+
+static int contar_raiz(void) {
+    int quantidade = 0;
+    int resultado = bmpfs_listar("/", contar_entrada, &quantidade);
+    return resultado < 0 ? resultado : quantidade;
+}
+
+static void escrever_passo_journal(int passo, char espelho[][TESTES_LIMITE_JOURNAL + TESTES_TRECHO_JOURNAL],
+                                   size_t *tamanhos, int aplicar) {
+    int arquivo = passo % TESTES_ARQUIVOS_JOURNAL;
+    char caminho[32];
+    snprintf(caminho, sizeof(caminho), "/r%d", arquivo);
+    if (passo % 37 == 36) {
+        tamanhos[arquivo] /= 2;
+        if (aplicar) {
+            bmpfs_truncar(caminho, (off_t)tamanhos[arquivo]);
+        }
+        return;
+    }
+    size_t offset = (size_t)passo / TESTES_ARQUIVOS_JOURNAL * TESTES_TRECHO_JOURNAL % TESTES_LIMITE_JOURNAL;
+    char *destino = espelho[arquivo];
+    if (offset > tamanhos[arquivo]) {
+        memset(destino + tamanhos[arquivo], 0, offset - tamanhos[arquivo]);
+    }
+    for (size_t i = 0; i < TESTES_TRECHO_JOURNAL; i++) {
+        destino[offset + i] = (char)(passo * 31 + i);
+    }
+    if (offset + TESTES_TRECHO_JOURNAL > tamanhos[arquivo]) {
+        tamanhos[arquivo] = offset + TESTES_TRECHO_JOURNAL;
+    }
+    if (aplicar) {
+        bmpfs_escrever(caminho, destino + offset, TESTES_TRECHO_JOURNAL, (off_t)offset);
+        bmpfs_sincronizar(caminho);
+    }
+}
+
+static int journal_deu_a_volta(void) {
+    Journal *journal = &estado_sistema_bmpfs.journal;
+    return journal->pendentes && journal->pendentes->posicao > 0 && journal->ultima_pendente->posicao == 0;
+}
+
+static void reproduzir_journal_circular(const char *imagem, const OpcoesFormatacaoBmpfs *formatacao,
+                                        const OpcoesMontagemBmpfs *montagem) {
+    static char espelho[TESTES_ARQUIVOS_JOURNAL][TESTES_LIMITE_JOURNAL + TESTES_TRECHO_JOURNAL];
+    size_t tamanhos[TESTES_ARQUIVOS_JOURNAL] = {0};
+    int canal[2];
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, formatacao) == 0);
+    VERIFICAR(pipe(canal) == 0);
+    pid_t filho = fork();
+    VERIFICAR(filho >= 0);
+    if (filho == 0) {
+        int passos = -1;
+        if (bmpfs_abrir(imagem, montagem) == 0) {
+            char caminho[32];
+            for (int i = 0; i < TESTES_ARQUIVOS_JOURNAL; i++) {
+                snprintf(caminho, sizeof(caminho), "/r%d", i);
+                bmpfs_criar(caminho, 0644);
+            }
+            for (int passo = 0; passo < 100000; passo++) {
+                escrever_passo_journal(passo, espelho, tamanhos, 1);
+                pthread_mutex_lock(&estado_sistema_bmpfs.trava_metadados);
+                if (journal_deu_a_volta()) {
+                    passos = passo + 1;
+                    break;
+                }
+                pthread_mutex_unlock(&estado_sistema_bmpfs.trava_metadados);
+            }
+        }
+        if (write(canal[1], &passos, sizeof(passos)) != sizeof(passos)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(canal[1]);
+    int passos = -1;
+    ssize_t lidos_canal = read(canal[0], &passos, sizeof(passos));
+    close(canal[0]);
+    int situacao;
+    waitpid(filho, &situacao, 0);
+    VERIFICAR(lidos_canal == sizeof(passos) && passos > 0);
+    for (int passo = 0; passo < passos; passo++) {
+        escrever_passo_journal(passo, espelho, tamanhos, 0);
+    }
+    static char lidos[TESTES_LIMITE_JOURNAL + TESTES_TRECHO_JOURNAL];
+    static char novos[256 * 1024];
+    memset(novos, 0x5a, sizeof(novos));
+    for (int montagens = 0; montagens < 2; montagens++) {
+        VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+        ssize_t escritos = sizeof(novos);
+        if (montagens == 0 && bmpfs_criar("/novo", 0644) == 0) {
+            escritos = bmpfs_escrever("/novo", novos, sizeof(novos), 0);
+        }
+        int divergente = -1;
+        for (int i = 0; i < TESTES_ARQUIVOS_JOURNAL && divergente < 0; i++) {
+            char caminho[32];
+            snprintf(caminho, sizeof(caminho), "/r%d", i);
+            struct stat st;
+            int consultado = bmpfs_consultar(caminho, &st);
+            ssize_t quantidade = bmpfs_ler(caminho, lidos, sizeof(lidos), 0);
+            if (consultado != 0 || (size_t)st.st_size != tamanhos[i] || quantidade != (ssize_t)tamanhos[i] ||
+                memcmp(lidos, espelho[i], tamanhos[i]) != 0) {
+                divergente = i;
+            }
+        }
+        VERIFICAR(bmpfs_fechar() == 0);
+        VERIFICAR(escritos == (ssize_t)sizeof(novos));
+        VERIFICAR(divergente < 0);
+    }
+}
+
+static void reformatar_descarta_journal(const char *imagem, const OpcoesMontagemBmpfs *montagem) {
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, NULL) == 0);
+    VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+    VERIFICAR(bmpfs_criar("/a", 0644) == 0);
+    VERIFICAR(bmpfs_criar("/b", 0644) == 0);
+    VERIFICAR(bmpfs_criar("/c", 0644) == 0);
+    VERIFICAR(bmpfs_escrever("/b", "conteudo", 8, 0) == 8);
+    VERIFICAR(bmpfs_fechar() == 0);
+    VERIFICAR(bmpfs_formatar(imagem, 0, 0, NULL) == 0);
+    for (int montagens = 0; montagens < 3; montagens++) {
+        VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+        int quantidade = contar_raiz();
+        VERIFICAR(bmpfs_fechar() == 0);
+        VERIFICAR(quantidade == 0);
+    }
+}
+
+static void lsb_nao_cresce_tabela(const char *imagem, const OpcoesMontagemBmpfs *montagem) {
+    OpcoesFormatacaoBmpfs formatacao;
+    bmpfs_opcoes_formatacao_padrao(&formatacao);
+    formatacao.max_arquivos = 8;
+    formatacao.bits_lsb = 2;
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, &formatacao) == 0);
+    VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+    int criados = 0;
+    int resultado = 0;
+    char caminho[32];
+    while (criados < 64) {
+        snprintf(caminho, sizeof(caminho), "/%d", criados);
+        resultado = bmpfs_criar(caminho, 0644);
+        if (resultado < 0) {
+            break;
+        }
+        criados++;
+    }
+    VERIFICAR(bmpfs_escrever("/0", "conteudo", 8, 0) == 8);
+    VERIFICAR(bmpfs_fechar() == 0);
+    VERIFICAR(resultado == -ENOSPC);
+    VERIFICAR(criados == (int)formatacao.max_arquivos);
+    VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+    char conteudo[8];
+    int quantidade = contar_raiz();
+    ssize_t lidos = bmpfs_ler("/0", conteudo, sizeof(conteudo), 0);
+    VERIFICAR(bmpfs_fechar() == 0);
+    VERIFICAR(quantidade == criados);
+    VERIFICAR(lidos == 8 && memcmp(conteudo, "conteudo", 8) == 0);
+}
+
+static void escrita_sem_copia_pendente(const char *imagem, const OpcoesMontagemBmpfs *montagem) {
+    static char dados[BMPFS_MINIMO_ZERO_COPIA];
+    for (size_t i = 0; i < sizeof(dados); i++) {
+        dados[i] = (char)(i * 7);
+    }
+    OpcoesMontagemBmpfs adiada = *montagem;
+    adiada.atraso_metadados_ms = 60000;
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, NULL) == 0);
+    VERIFICAR(bmpfs_abrir(imagem, &adiada) == 0);
+    VERIFICAR(bmpfs_criar("/z", 0644) == 0);
+    struct fuse_bufvec origem = FUSE_BUFVEC_INIT(sizeof(dados));
+    origem.buf[0].mem = dados;
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    int escritos = operacoes_bmpfs.write_buf("/z", &origem, 0, &fi);
+    int pendentes = __atomic_load_n(&estado_sistema_bmpfs.dados_pendentes, __ATOMIC_ACQUIRE);
+    VERIFICAR(bmpfs_fechar() == 0);
+    VERIFICAR(escritos == (int)sizeof(dados));
+    VERIFICAR(pendentes);
+    static char lidos[BMPFS_MINIMO_ZERO_COPIA];
+    VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+    ssize_t quantidade = bmpfs_ler("/z", lidos, sizeof(lidos), 0);
+    VERIFICAR(bmpfs_fechar() == 0);
+    VERIFICAR(quantidade == (ssize_t)sizeof(lidos) && memcmp(lidos, dados, sizeof(dados)) == 0);
+}
+
+static void escrita_sem_copia_curta(const char *imagem, const OpcoesMontagemBmpfs *montagem) {
+    static char dados[2 * BMPFS_MINIMO_ZERO_COPIA];
+    memset(dados, 0x55, sizeof(dados));
+    FILE *origem_arquivo = tmpfile();
+    VERIFICAR(origem_arquivo);
+    size_t disponiveis = BMPFS_MINIMO_ZERO_COPIA + 100;
+    size_t gravados = fwrite(dados, 1, disponiveis, origem_arquivo);
+    fflush(origem_arquivo);
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, NULL) == 0);
+    VERIFICAR(bmpfs_abrir(imagem, montagem) == 0);
+    VERIFICAR(bmpfs_criar("/antigo", 0644) == 0);
+    VERIFICAR(bmpfs_escrever("/antigo", dados, sizeof(dados), 0) == (ssize_t)sizeof(dados));
+    VERIFICAR(bmpfs_excluir("/antigo") == 0);
+    VERIFICAR(bmpfs_criar("/z", 0644) == 0);
+    struct fuse_bufvec origem = FUSE_BUFVEC_INIT(sizeof(dados));
+    origem.buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+    origem.buf[0].fd = fileno(origem_arquivo);
+    origem.buf[0].pos = 0;
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    int escritos = operacoes_bmpfs.write_buf("/z", &origem, 0, &fi);
+    int truncado = bmpfs_truncar("/z", sizeof(dados));
+    static char lidos[2 * BMPFS_MINIMO_ZERO_COPIA];
+    ssize_t quantidade = bmpfs_ler("/z", lidos, sizeof(lidos), 0);
+    VERIFICAR(bmpfs_fechar() == 0);
+    fclose(origem_arquivo);
+    VERIFICAR(gravados == disponiveis);
+    VERIFICAR(escritos == BMPFS_MINIMO_ZERO_COPIA);
+    VERIFICAR(truncado == 0 && quantidade == (ssize_t)sizeof(lidos));
+    for (size_t i = BMPFS_MINIMO_ZERO_COPIA; i < sizeof(lidos); i++) {
+        VERIFICAR(lidos[i] == 0);
+    }
+}
+
+static void lsb_preserva_pixels(const char *imagem, const OpcoesMontagemBmpfs *montagem) {
+    VERIFICAR(bmpfs_formatar(imagem, TESTES_LADO_IMAGEM, TESTES_LADO_IMAGEM, NULL) == 0);
+    FILE *arquivo = fopen(imagem, "r+b");
+    VERIFICAR(arquivo);
+    uint8_t cabecalho[14];
+    size_t lidos_cabecalho = fread(cabecalho, 1, sizeof(cabecalho), arquivo);
+    long inicio_pixels = (long)cabecalho[10] | (long)cabecalho[11] << 8 | (long)cabecalho[12] << 16 |
+                         (long)cabecalho[13] << 24;
+    size_t tamanho_pixels = (size_t)TESTES_LADO_IMAGEM * TESTES_LADO_IMAGEM * 3;
+    uint8_t *originais = malloc(tamanho_pixels);
+    uint8_t *finais = malloc(tamanho_pixels);
+    if (originais) {
+        for (size_t i = 0; i < tamanho_pixels; i++) {
+            originais[i] = (uint8_t)(i * 131 + i / 977);
+        }
+    }
+    size_t gravados = 0;
+    if (lidos_cabecalho == sizeof(cabecalho) && originais && fseek(arquivo, inicio_pixels, SEEK_SET) == 0) {
+        gravados = fwrite(originais, 1, tamanho_pixels, arquivo);
+    }
+    fclose(arquivo);
+    if (gravados != tamanho_pixels || !finais) {
+        free(originais);
+        free(finais);
+        VERIFICAR(!"falha ao preparar os pixels da imagem");
+    }
+    OpcoesFormatacaoBmpfs formatacao;
+    bmpfs_opcoes_formatacao_padrao(&formatacao);
+    formatacao.bits_lsb = 2;
+    static char dados[100000];
+    for (size_t i = 0; i < sizeof(dados); i++) {
+        dados[i] = (char)(i * 7 + 3);
+    }
+    static char lidos[sizeof(dados)];
+    ssize_t quantidade = -1;
+    if (bmpfs_formatar(imagem, 0, 0, &formatacao) == 0 && bmpfs_abrir(imagem, montagem) == 0) {
+        bmpfs_criar("/dados", 0644);
+        bmpfs_escrever("/dados", dados, sizeof(dados), 0);
+        bmpfs_fechar();
+        if (bmpfs_abrir(imagem, montagem) == 0) {
+            quantidade = bmpfs_ler("/dados", lidos, sizeof(lidos), 0);
+            bmpfs_fechar();
+        }
+    }
+    arquivo = fopen(imagem, "rb");
+    size_t lidos_pixels = 0;
+    if (arquivo && fseek(arquivo, inicio_pixels, SEEK_SET) == 0) {
+        lidos_pixels = fread(finais, 1, tamanho_pixels, arquivo);
+    }
+    if (arquivo) {
+        fclose(arquivo);
+    }
+    size_t alterados = 0;
+    for (size_t i = 0; i < lidos_pixels; i++) {
+        alterados += ((originais[i] ^ finais[i]) & ~3u) != 0;
+    }
+    free(originais);
+    free(finais);
+    VERIFICAR(quantidade == (ssize_t)sizeof(dados) && memcmp(lidos, dados, sizeof(dados)) == 0);
+    VERIFICAR(lidos_pixels == tamanho_pixels);
+    VERIFICAR(alterados == 0);
+}
+
+int main(void) {
+    const char *diretorio = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    char imagem[4096];
+    snprintf(imagem, sizeof(imagem), "%s/testes_bmpfs_%d.bmp", diretorio, (int)getpid());
+    OpcoesMontagemBmpfs montagem;
+    bmpfs_opcoes_montagem_padrao(&montagem);
+    reformatar_descarta_journal(imagem, &montagem);
+    montagem.atraso_metadados_ms = 0;
+    reformatar_descarta_journal(imagem, &montagem);
+    lsb_nao_cresce_tabela(imagem, &montagem);
+    escrita_sem_copia_pendente(imagem, &montagem);
+    escrita_sem_copia_curta(imagem, &montagem);
+    reproduzir_journal_circular(imagem, NULL, &montagem);
+    OpcoesFormatacaoBmpfs formatacao_lsb;
+    bmpfs_opcoes_formatacao_padrao(&formatacao_lsb);
+    formatacao_lsb.bits_lsb = 2;
+    formatacao_lsb.max_arquivos = 32;
+    reproduzir_journal_circular(imagem, &formatacao_lsb, &montagem);
+    lsb_preserva_pixels(imagem, &montagem);
+    unlink(imagem);
+    if (falhas) {
+        fprintf(stderr, "%d testes falharam\n", falhas);
+        return 1;
+    }
+    printf("Todos os testes passaram\n");
+    return 0;
+}